@@ -25,7 +25,8 @@ private:
 	void updateCameraVectors(void);
 
 public:
-	glm::vec3 Position, Front, Up, Right, WorldUp; // Camera Attributes
+	glm::dvec3 Position;                           // Camera position in the world, kept in double precision for real scale distances
+	glm::vec3 Front, Up, Right, WorldUp;           // Camera Attributes
 	float Yaw, Pitch;							   // Euler Angles
 	float MovementSpeed, MouseSensitivity, Zoom;   // Camera Options
 
@@ -33,6 +34,7 @@ public:
 	Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch);
 	
 	glm::mat4 GetViewMatrix(void);
+	void SetPose(const glm::dvec3& position, float yaw, float pitch, float zoom);
 	void ProcessKeyBoard(Camera_Movement direction, float deltaTime);
 	void ProcessMouseMovement(float xoffset, float yoffset, GLboolean constraintPitch = true);
 	void ProcessMouseScroll(float yoffset);
@@ -52,16 +54,27 @@ Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch):
 /* Constructor with scalar values */
 Camera::Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch)
 {
-	this->Position = glm::vec3(posX, posY, posZ);
+	this->Position = glm::dvec3(posX, posY, posZ);
 	this->WorldUp = glm::vec3(upX, upY, upZ);
 	this->Yaw = yaw;
 	this->Pitch = pitch;
 	this->updateCameraVectors();
 }
 
-/* Returns the view matrix calculated using Euler Anglesand the LookAt Matrix */
+/* Returns the view matrix calculated using Euler Anglesand the LookAt Matrix. The scene is rendered relative to the camera
+   (every model matrix already has the camera position subtracted), so the view matrix only rotates */
 glm::mat4 Camera::GetViewMatrix(void) {
-	return glm::lookAt(this->Position, this->Position + this->Front, this->Up);
+	return glm::lookAt(glm::vec3(0.0f), this->Front, this->Up);
+}
+
+/* Places and turns the camera directly, e.g. to replay a recorded camera path */
+void Camera::SetPose(const glm::dvec3& position, float yaw, float pitch, float zoom)
+{
+	this->Position = position;
+	this->Yaw = yaw;
+	this->Pitch = pitch;
+	this->Zoom = zoom;
+	this->updateCameraVectors();
 }
 
 /* Processes input received from a mouse input system. Expects the offset value in both the x and y direction. */
@@ -109,13 +122,13 @@ void Camera::updateCameraVectors(void)
 /* processes input received from any keyboard-like input system. Accepts input parameterin the form of camera defined ENUM (to abstract it from windowing systems) */
 void Camera::ProcessKeyBoard(Camera_Movement direction, float deltaTime)
 {
-	float velocity = this->MovementSpeed * deltaTime;
-	if (direction == FORWARD) this->Position += this->Front * velocity;
-	if (direction == BACKWARD) this->Position -= this->Front * velocity;
-	if (direction == LEFT) this->Position -= this->Right * velocity;
-	if (direction == RIGHT) this->Position += this->Right * velocity;
-	if (direction == UP) this->Position += this->WorldUp * velocity;
-	if (direction == DOWN) this->Position -= this->WorldUp * velocity;
+	double velocity = (double)this->MovementSpeed * deltaTime;
+	if (direction == FORWARD) this->Position += glm::dvec3(this->Front) * velocity;
+	if (direction == BACKWARD) this->Position -= glm::dvec3(this->Front) * velocity;
+	if (direction == LEFT) this->Position -= glm::dvec3(this->Right) * velocity;
+	if (direction == RIGHT) this->Position += glm::dvec3(this->Right) * velocity;
+	if (direction == UP) this->Position += glm::dvec3(this->WorldUp) * velocity;
+	if (direction == DOWN) this->Position -= glm::dvec3(this->WorldUp) * velocity;
 }
 
 #endif /* CAMERA_HEADER */
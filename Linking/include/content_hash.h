@@ -0,0 +1,51 @@
+/* Filename: content_hash.h */
+
+#ifndef CONTENT_HASH_HEADER
+#define CONTENT_HASH_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+static const uint64_t CONTENT_HASH_PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t CONTENT_HASH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+
+static inline uint64_t contentHashRotate(const uint64_t value, const unsigned int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+/* One round of a lane: the word is multiplied in, rotated and multiplied again */
+static inline uint64_t contentHashRound(const uint64_t lane, const uint64_t word) { return contentHashRotate(lane + word * CONTENT_HASH_PRIME2, 31) * CONTENT_HASH_PRIME1; }
+
+/* 64-bit hash of a block of bytes, for telling file contents apart (not for security). Four independent lanes take 8 bytes each
+   per step, so the multiplies overlap and a few MB hash in about a millisecond */
+uint64_t contentHash(const void* data, const size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t lanes[4] = { CONTENT_HASH_PRIME1 + CONTENT_HASH_PRIME2, CONTENT_HASH_PRIME2, 0, 0 - CONTENT_HASH_PRIME1 };
+
+    size_t offset = 0;
+    for (; offset + 32 <= size; offset += 32)
+        for (unsigned int lane = 0; lane < 4; lane++) {
+            uint64_t word;
+            std::memcpy(&word, bytes + offset + lane * 8, sizeof(word));
+            lanes[lane] = contentHashRound(lanes[lane], word);
+        }
+
+    uint64_t hash = contentHashRotate(lanes[0], 1) + contentHashRotate(lanes[1], 7) + contentHashRotate(lanes[2], 12) + contentHashRotate(lanes[3], 18);
+    hash ^= (uint64_t)size * CONTENT_HASH_PRIME1;
+
+    // The tail: whole words, then the last bytes
+    for (; offset + 8 <= size; offset += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + offset, sizeof(word));
+        hash = contentHashRound(hash, word);
+    }
+    for (; offset < size; offset++) hash = contentHashRotate(hash ^ (bytes[offset] * CONTENT_HASH_PRIME1), 11) * CONTENT_HASH_PRIME2;
+
+    // Final avalanche, every input bit reaches every output bit
+    hash ^= hash >> 33; hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33; hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+#endif /* CONTENT_HASH_HEADER */
@@ -0,0 +1,140 @@
+/* Filename: gl_resource.h */
+
+#ifndef GL_RESOURCE_HEADER
+#define GL_RESOURCE_HEADER
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/* The kinds of GL objects that get owned, each one has its own delete call */
+enum GLResourceKind {
+    GL_RESOURCE_BUFFER,
+    GL_RESOURCE_VERTEX_ARRAY,
+    GL_RESOURCE_TEXTURE,
+    GL_RESOURCE_PROGRAM,
+    GL_RESOURCE_KIND_COUNT
+};
+
+/* GL Deletion Queue Class. GL objects may only be deleted on the thread that owns the context, and not while a frame still
+   uses them, so owners never delete directly: they queue the names here, from any thread, and the render loop deletes the
+   whole batch once per frame */
+class GLDeletionQueue {
+private:
+    std::mutex mutex;
+    std::vector<GLuint> pending[GL_RESOURCE_KIND_COUNT];
+
+public:
+    static GLDeletionQueue& global(void); // The queue the render loop drains
+
+    void enqueue(const GLResourceKind kind, const GLuint name);
+    size_t drain(void);                   // Deletes every queued object, returns how many. Only call on the GL thread
+    size_t getPendingCount(void);
+};
+
+GLDeletionQueue& GLDeletionQueue::global(void)
+{
+    static GLDeletionQueue queue;
+    return queue;
+}
+
+void GLDeletionQueue::enqueue(const GLResourceKind kind, const GLuint name)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->pending[kind].push_back(name);
+}
+
+size_t GLDeletionQueue::drain(void)
+{
+    // Take the batch out first, so owners destroyed meanwhile on other threads never wait on the GL calls
+    std::vector<GLuint> batch[GL_RESOURCE_KIND_COUNT];
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (unsigned int kind = 0; kind < GL_RESOURCE_KIND_COUNT; kind++) batch[kind].swap(this->pending[kind]);
+    }
+
+    if (!batch[GL_RESOURCE_BUFFER].empty()) glDeleteBuffers((GLsizei)batch[GL_RESOURCE_BUFFER].size(), batch[GL_RESOURCE_BUFFER].data());
+    if (!batch[GL_RESOURCE_VERTEX_ARRAY].empty()) glDeleteVertexArrays((GLsizei)batch[GL_RESOURCE_VERTEX_ARRAY].size(), batch[GL_RESOURCE_VERTEX_ARRAY].data());
+    if (!batch[GL_RESOURCE_TEXTURE].empty()) glDeleteTextures((GLsizei)batch[GL_RESOURCE_TEXTURE].size(), batch[GL_RESOURCE_TEXTURE].data());
+    for (size_t i = 0; i < batch[GL_RESOURCE_PROGRAM].size(); i++) glDeleteProgram(batch[GL_RESOURCE_PROGRAM][i]);
+
+    size_t deleted = 0;
+    for (unsigned int kind = 0; kind < GL_RESOURCE_KIND_COUNT; kind++) deleted += batch[kind].size();
+    return deleted;
+}
+
+size_t GLDeletionQueue::getPendingCount(void)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    size_t count = 0;
+    for (unsigned int kind = 0; kind < GL_RESOURCE_KIND_COUNT; kind++) count += this->pending[kind].size();
+    return count;
+}
+
+/* GL Object Class. Sole owner of one GL object name: it can be moved but not copied, and it hands the name to the deletion
+   queue when it goes away. Name 0 means empty */
+template<GLResourceKind Kind>
+class GLObject {
+private:
+    GLuint name;
+
+public:
+    GLObject(void) : name(0) {}
+    explicit GLObject(const GLuint name) : name(name) {} // Takes ownership of an existing name
+    GLObject(GLObject&& other) noexcept : name(other.name) { other.name = 0; }
+    GLObject(const GLObject&) = delete;
+    ~GLObject(void) { reset(); }
+
+    GLObject& operator=(GLObject&& other) noexcept;
+    GLObject& operator=(const GLObject&) = delete;
+
+    static GLObject generate(void); // Creates a new GL object of this kind (on the GL thread)
+
+    void reset(void);     // Queues the object for deletion and becomes empty
+    GLuint release(void); // Gives up ownership without deleting, returns the name
+
+    GLuint inline get(void) const { return this->name; }
+    explicit operator bool(void) const { return this->name != 0; }
+};
+
+typedef GLObject<GL_RESOURCE_BUFFER> GLBuffer;
+typedef GLObject<GL_RESOURCE_VERTEX_ARRAY> GLVertexArray;
+typedef GLObject<GL_RESOURCE_TEXTURE> GLTexture;
+typedef GLObject<GL_RESOURCE_PROGRAM> GLProgram;
+
+template<GLResourceKind Kind>
+GLObject<Kind>& GLObject<Kind>::operator=(GLObject&& other) noexcept
+{
+    if (this != &other) {
+        this->reset();
+        this->name = other.name;
+        other.name = 0;
+    }
+
+    return *this;
+}
+
+template<> GLBuffer GLBuffer::generate(void) { GLuint name = 0; glGenBuffers(1, &name); return GLBuffer(name); }
+template<> GLVertexArray GLVertexArray::generate(void) { GLuint name = 0; glGenVertexArrays(1, &name); return GLVertexArray(name); }
+template<> GLTexture GLTexture::generate(void) { GLuint name = 0; glGenTextures(1, &name); return GLTexture(name); }
+template<> GLProgram GLProgram::generate(void) { return GLProgram(glCreateProgram()); }
+
+template<GLResourceKind Kind>
+void GLObject<Kind>::reset(void)
+{
+    if (this->name != 0) GLDeletionQueue::global().enqueue(Kind, this->name);
+    this->name = 0;
+}
+
+template<GLResourceKind Kind>
+GLuint GLObject<Kind>::release(void)
+{
+    const GLuint name = this->name;
+    this->name = 0;
+    return name;
+}
+
+#endif /* GL_RESOURCE_HEADER */
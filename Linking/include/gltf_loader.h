@@ -0,0 +1,426 @@
+/* Filename: gltf_loader.h */
+
+#ifndef GLTF_LOADER_HEADER
+#define GLTF_LOADER_HEADER
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <gl_resource.h>
+#include <json.h>
+#include <mapped_file.h>
+#include <vertex_layout.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* glTF extensions a file may require and still load natively. The specular-glossiness material only lends its diffuse texture */
+static const char* const GLTF_SUPPORTED_EXTENSIONS[] = { "KHR_mesh_quantization", "KHR_materials_pbrSpecularGlossiness" };
+
+/* A byte range of a glTF buffer, as mapped from the .bin file or the binary chunk of a .glb */
+typedef struct GltfBufferView {
+    const unsigned char* data = NULL;
+    size_t length = 0;
+    unsigned int stride = 0; // Bytes between vertices, 0 when they are tightly packed
+    bool used = false;       // Read by some primitive, so it goes to the GPU
+} GltfBufferView;
+
+/* How a primitive reads one attribute (or its indices) out of a buffer view. With KHR_mesh_quantization the components can be
+   integers, normalized or not: they go to GL as they are and the vertex fetch turns them into floats */
+typedef struct GltfAccessor {
+    int bufferView = -1;
+    size_t byteOffset = 0, count = 0;
+    GLenum componentType = 0;
+    unsigned int components = 0;
+    bool normalized = false, sparse = false;
+} GltfAccessor;
+
+/* One drawable part of a mesh: accessor indices of its attributes (-1 when missing) and its material */
+typedef struct GltfPrimitive {
+    int position = -1, normal = -1, texCoords = -1, indices = -1;
+    int material = -1;
+} GltfPrimitive;
+
+/* Everything a glTF file gives before anything touches GL. The buffers stay mapped until the GL buffers are made from them,
+   which is the only copy the vertices ever go through */
+typedef struct GltfAsset {
+    std::string directory;
+    std::vector<std::shared_ptr<MappedFile>> files; // The .gltf or .glb and the .bin files, kept mapped
+    std::vector<GltfBufferView> views;
+    std::vector<GltfAccessor> accessors;
+    std::vector<GltfPrimitive> primitives;
+    std::vector<std::string> materialDiffuse;       // Diffuse (base colour) texture file of each material relative to the directory, empty if none
+    glm::mat4 transform = glm::mat4(1.0f);          // Where the nodes place the meshes, the same for all of them
+    float boundingRadius = 0.0f;                    // Of the placed vertices, around the origin
+} GltfAsset;
+
+bool loadGltf(const std::string& path, GltfAsset& asset); // Parses a .gltf or .glb file and maps its buffers. False (with the reason printed) if the file needs ASSIMP instead
+std::vector<GLBuffer> uploadGltfBufferViews(const GltfAsset& asset); // One GL buffer per used buffer view, straight from the mapped bytes (an empty buffer for the others)
+GLVertexArray createGltfVertexArray(const GltfAsset& asset, const GltfPrimitive& primitive, const std::vector<GLBuffer>& buffers, VertexLayout& layout); // Points a vertex array at the accessors of a primitive
+
+static unsigned int gltfComponentSize(const GLenum componentType)
+{
+    switch (componentType) {
+    case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+    case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+    case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+    default: return 0;
+    }
+}
+
+static unsigned int gltfTypeComponents(const std::string& type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0; // Matrices never hold vertex attributes the shaders read
+}
+
+/* Reads one component the way the vertex fetch does: normalized integers map to [0, 1] or [-1, 1], the others convert as they are */
+static float readGltfComponent(const unsigned char* source, const GLenum componentType, const bool normalized)
+{
+    switch (componentType) {
+    case GL_BYTE: { int8_t value; std::memcpy(&value, source, 1); return normalized ? std::max(value / 127.0f, -1.0f) : (float)value; }
+    case GL_UNSIGNED_BYTE: { uint8_t value; std::memcpy(&value, source, 1); return normalized ? value / 255.0f : (float)value; }
+    case GL_SHORT: { int16_t value; std::memcpy(&value, source, 2); return normalized ? std::max(value / 32767.0f, -1.0f) : (float)value; }
+    case GL_UNSIGNED_SHORT: { uint16_t value; std::memcpy(&value, source, 2); return normalized ? value / 65535.0f : (float)value; }
+    case GL_UNSIGNED_INT: { uint32_t value; std::memcpy(&value, source, 4); return (float)value; }
+    default: { float value; std::memcpy(&value, source, 4); return value; }
+    }
+}
+
+static glm::vec3 gltfVec3(const JsonValue& array)
+{
+    return glm::vec3((float)array[0].getNumber(0.0), (float)array[1].getNumber(0.0), (float)array[2].getNumber(0.0));
+}
+
+/* A node's local transform, given as a column-major matrix or as translation, rotation and scale */
+static glm::mat4 gltfNodeMatrix(const JsonValue& node)
+{
+    const JsonValue& matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        float values[16];
+        for (unsigned int i = 0; i < 16; i++) values[i] = (float)matrix[i].getNumber(0.0);
+        return glm::make_mat4(values);
+    }
+
+    const JsonValue& translation = node["translation"];
+    const JsonValue& rotation = node["rotation"];
+    const JsonValue& scale = node["scale"];
+
+    glm::mat4 local(1.0f);
+    if (translation.size() == 3) local = glm::translate(local, gltfVec3(translation));
+    if (rotation.size() == 4) local = local * glm::mat4_cast(glm::quat((float)rotation[3].getNumber(1.0), gltfVec3(rotation)));
+    if (scale.size() == 3) local = glm::scale(local, gltfVec3(scale));
+    return local;
+}
+
+static bool sameGltfTransform(const glm::mat4& a, const glm::mat4& b)
+{
+    for (int column = 0; column < 4; column++)
+        for (int row = 0; row < 4; row++)
+            if (std::fabs(a[column][row] - b[column][row]) > 1e-5f * std::max(1.0f, std::fabs(a[column][row]))) return false;
+    return true;
+}
+
+/* URIs of relative files can escape characters, "%20" for a space */
+static std::string decodeGltfUri(const std::string& uri)
+{
+    std::string path;
+    for (size_t i = 0; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size()) {
+            const std::string digits = uri.substr(i + 1, 2);
+            char* end = NULL;
+            const long value = std::strtol(digits.c_str(), &end, 16);
+            if (end == digits.c_str() + 2) { path += (char)value; i += 2; continue; }
+        }
+        path += uri[i];
+    }
+    return path;
+}
+
+/* Checks that an accessor stays inside its buffer view, with a component type GL can fetch */
+static bool validGltfAccessor(const GltfAsset& asset, const GltfAccessor& accessor)
+{
+    if (accessor.sparse || accessor.bufferView < 0 || accessor.bufferView >= (int)asset.views.size() || accessor.count == 0) return false;
+
+    const unsigned int elementSize = gltfComponentSize(accessor.componentType) * accessor.components;
+    if (elementSize == 0) return false;
+
+    // Divided rather than multiplied out, so that no count or offset can wrap the check around
+    const GltfBufferView& view = asset.views[accessor.bufferView];
+    const size_t stride = view.stride != 0 ? view.stride : elementSize;
+    if (accessor.byteOffset > view.length || elementSize > view.length - accessor.byteOffset) return false;
+    return accessor.count <= (view.length - accessor.byteOffset - elementSize) / stride + 1;
+}
+
+static bool gltfFail(const std::string& path, const std::string& reason)
+{
+    std::cout << "ERROR::GLTF:: " << path << ": " << reason << ", importing it through ASSIMP instead" << std::endl;
+    return false;
+}
+
+bool loadGltf(const std::string& path, GltfAsset& asset)
+{
+    asset = GltfAsset();
+    asset.directory = path.substr(0, path.find_last_of('/'));
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(path)) return gltfFail(path, "cannot open the file");
+    asset.files.push_back(file);
+
+    // A .glb is a JSON chunk and an optional binary chunk (the first buffer) behind a 12 byte header
+    const unsigned char* json = file->getData();
+    size_t jsonLength = file->getSize();
+    const unsigned char* binary = NULL;
+    size_t binaryLength = 0;
+
+    uint32_t header[3] = { 0, 0, 0 };
+    if (file->getSize() >= 20) std::memcpy(header, file->getData(), sizeof(header));
+    if (header[0] == 0x46546C67) { // "glTF"
+        if (header[1] != 2 || header[2] > file->getSize()) return gltfFail(path, "not a glTF 2.0 binary");
+
+        size_t offset = 12;
+        for (unsigned int chunk = 0; offset + 8 <= header[2]; chunk++) {
+            uint32_t chunkHeader[2];
+            std::memcpy(chunkHeader, file->getData() + offset, sizeof(chunkHeader));
+            if (offset + 8 + chunkHeader[0] > header[2]) return gltfFail(path, "truncated chunk");
+
+            if (chunk == 0 && chunkHeader[1] == 0x4E4F534A) { json = file->getData() + offset + 8; jsonLength = chunkHeader[0]; }       // "JSON"
+            else if (chunk == 1 && chunkHeader[1] == 0x004E4942) { binary = file->getData() + offset + 8; binaryLength = chunkHeader[0]; } // "BIN\0"
+            else if (chunk == 0) return gltfFail(path, "the first chunk is not JSON");
+            offset += 8 + chunkHeader[0];
+        }
+    }
+
+    JsonValue root;
+    JsonParser parser;
+    if (!parser.parse((const char*)json, jsonLength, root)) return gltfFail(path, "malformed JSON, " + parser.getError());
+
+    if (root["asset"]["version"].getString().compare(0, 2, "2.") != 0) return gltfFail(path, "not glTF 2.0");
+
+    const JsonValue& required = root["extensionsRequired"];
+    for (size_t i = 0; i < required.size(); i++) {
+        const std::string& extension = required[i].getString();
+        if (std::find(std::begin(GLTF_SUPPORTED_EXTENSIONS), std::end(GLTF_SUPPORTED_EXTENSIONS), extension) == std::end(GLTF_SUPPORTED_EXTENSIONS))
+            return gltfFail(path, "requires " + extension);
+    }
+
+    /* Buffers: mapped whole, never read */
+    std::vector<std::pair<const unsigned char*, size_t>> buffers;
+    const JsonValue& bufferList = root["buffers"];
+    for (size_t i = 0; i < bufferList.size(); i++) {
+        const std::string& uri = bufferList[i]["uri"].getString();
+        size_t byteLength = 0;
+        if (!bufferList[i]["byteLength"].getSize(byteLength, 0)) return gltfFail(path, "buffer " + std::to_string(i) + " has a bad length");
+
+        if (uri.empty()) {
+            if (i != 0 || binary == NULL || binaryLength < byteLength) return gltfFail(path, "buffer " + std::to_string(i) + " has no data");
+            buffers.push_back(std::make_pair(binary, byteLength));
+            continue;
+        }
+        if (uri.compare(0, 5, "data:") == 0) return gltfFail(path, "buffer " + std::to_string(i) + " is embedded as a data URI");
+
+        std::shared_ptr<MappedFile> bin = std::make_shared<MappedFile>();
+        if (!bin->open(asset.directory + '/' + decodeGltfUri(uri)) || bin->getSize() < byteLength) return gltfFail(path, "cannot map " + uri);
+        buffers.push_back(std::make_pair(bin->getData(), byteLength));
+        asset.files.push_back(bin);
+    }
+
+    /* Buffer Views */
+    const JsonValue& viewList = root["bufferViews"];
+    for (size_t i = 0; i < viewList.size(); i++) {
+        const JsonValue& view = viewList[i];
+        const int buffer = view["buffer"].getInt(-1);
+        size_t byteOffset = 0, byteLength = 0;
+        const int stride = view["byteStride"].getInt(-1);
+        if (buffer < 0 || buffer >= (int)buffers.size() || !view["byteOffset"].getSize(byteOffset, 0) || !view["byteLength"].getSize(byteLength, 0) ||
+            byteLength > buffers[buffer].second || byteOffset > buffers[buffer].second - byteLength || (stride < 0 && !view["byteStride"].isNull()) || (stride > 0 && stride < 4) || stride > 252)
+            return gltfFail(path, "buffer view " + std::to_string(i) + " is out of range");
+
+        GltfBufferView bufferView;
+        bufferView.data = buffers[buffer].first + byteOffset;
+        bufferView.length = byteLength;
+        bufferView.stride = stride > 0 ? (unsigned int)stride : 0;
+        asset.views.push_back(bufferView);
+    }
+
+    /* Accessors */
+    const JsonValue& accessorList = root["accessors"];
+    for (size_t i = 0; i < accessorList.size(); i++) {
+        const JsonValue& accessor = accessorList[i];
+
+        GltfAccessor entry;
+        entry.bufferView = accessor["bufferView"].getInt(-1);
+        if (!accessor["byteOffset"].getSize(entry.byteOffset, 0) || !accessor["count"].getSize(entry.count, 0)) return gltfFail(path, "accessor " + std::to_string(i) + " has a bad offset or count");
+        entry.componentType = (GLenum)accessor["componentType"].getInt(0);
+        entry.components = gltfTypeComponents(accessor["type"].getString());
+        entry.normalized = accessor["normalized"].getBool(false);
+        entry.sparse = !accessor["sparse"].isNull();
+        asset.accessors.push_back(entry);
+    }
+
+    /* Materials: only the diffuse texture is drawn */
+    const JsonValue& textures = root["textures"];
+    const JsonValue& images = root["images"];
+    const JsonValue& materialList = root["materials"];
+    for (size_t i = 0; i < materialList.size(); i++) {
+        const JsonValue& material = materialList[i];
+
+        int texture = material["pbrMetallicRoughness"]["baseColorTexture"]["index"].getInt(-1);
+        if (texture < 0) texture = material["extensions"]["KHR_materials_pbrSpecularGlossiness"]["diffuseTexture"]["index"].getInt(-1);
+
+        // Images embedded in a buffer or a data URI are left out, the TextureCache loads files
+        const int image = texture >= 0 ? textures[(size_t)texture]["source"].getInt(-1) : -1;
+        const std::string uri = image >= 0 ? images[(size_t)image]["uri"].getString() : std::string();
+        asset.materialDiffuse.push_back(uri.empty() || uri.compare(0, 5, "data:") == 0 ? std::string() : decodeGltfUri(uri));
+    }
+
+    /* Nodes: every mesh has to be placed once, and the same way as the others, for one model transform to place them all */
+    const JsonValue& nodes = root["nodes"];
+    const JsonValue& scene = root["scenes"][(size_t)root["scene"].getInt(0)];
+    if (scene.isNull()) return gltfFail(path, "no scene");
+
+    std::vector<std::pair<int, glm::mat4>> pending; // Nodes to visit, with their parents' transform
+    for (size_t i = 0; i < scene["nodes"].size(); i++) pending.push_back(std::make_pair(scene["nodes"][i].getInt(-1), glm::mat4(1.0f)));
+
+    std::vector<int> placedMeshes;
+    size_t visited = 0;
+    bool placed = false;
+    while (!pending.empty()) {
+        const std::pair<int, glm::mat4> current = pending.back();
+        pending.pop_back();
+        if (current.first < 0 || current.first >= (int)nodes.size() || ++visited > nodes.size()) return gltfFail(path, "bad node hierarchy");
+
+        const JsonValue& node = nodes[(size_t)current.first];
+        const glm::mat4 world = current.second * gltfNodeMatrix(node);
+
+        const int mesh = node["mesh"].getInt(-1);
+        if (mesh >= 0) {
+            if (std::find(placedMeshes.begin(), placedMeshes.end(), mesh) != placedMeshes.end()) return gltfFail(path, "a mesh is placed more than once");
+            if (placed && !sameGltfTransform(world, asset.transform)) return gltfFail(path, "the nodes place the meshes differently");
+            if (!node["skin"].isNull()) return gltfFail(path, "skinned meshes");
+            placedMeshes.push_back(mesh);
+            asset.transform = world;
+            placed = true;
+        }
+
+        for (size_t i = 0; i < node["children"].size(); i++) pending.push_back(std::make_pair(node["children"][i].getInt(-1), world));
+    }
+
+    /* Primitives of the placed meshes */
+    const JsonValue& meshes = root["meshes"];
+    for (size_t m = 0; m < placedMeshes.size(); m++) {
+        const JsonValue& primitives = meshes[(size_t)placedMeshes[m]]["primitives"];
+        for (size_t p = 0; p < primitives.size(); p++) {
+            const JsonValue& primitive = primitives[p];
+            const JsonValue& attributes = primitive["attributes"];
+
+            GltfPrimitive entry;
+            entry.position = attributes["POSITION"].getInt(-1);
+            entry.normal = attributes["NORMAL"].getInt(-1);
+            entry.texCoords = attributes["TEXCOORD_0"].getInt(-1);
+            entry.indices = primitive["indices"].getInt(-1);
+            entry.material = primitive["material"].getInt(-1);
+
+            if (primitive["mode"].getInt(GL_TRIANGLES) != GL_TRIANGLES) return gltfFail(path, "primitives other than triangle lists");
+            if (!primitive["targets"].isNull()) return gltfFail(path, "morph targets");
+            if (entry.position < 0 || entry.indices < 0) return gltfFail(path, "primitives without positions or indices");
+
+            // Every accessor the primitive reads has to be one GL can fetch as it is
+            const int used[4] = { entry.position, entry.normal, entry.texCoords, entry.indices };
+            for (unsigned int a = 0; a < 4; a++) {
+                if (used[a] < 0) continue;
+                if (used[a] >= (int)asset.accessors.size() || !validGltfAccessor(asset, asset.accessors[used[a]])) return gltfFail(path, "accessor " + std::to_string(used[a]) + " cannot be read directly");
+                if (a < 3 && asset.accessors[used[a]].count != asset.accessors[entry.position].count) return gltfFail(path, "attributes of different lengths");
+                asset.views[asset.accessors[used[a]].bufferView].used = true;
+            }
+
+            const GltfAccessor& indices = asset.accessors[entry.indices];
+            if (indices.components != 1 || indices.componentType == GL_BYTE || indices.componentType == GL_SHORT || indices.componentType == GL_FLOAT || asset.views[indices.bufferView].stride != 0)
+                return gltfFail(path, "indices GL cannot draw from");
+            if (asset.accessors[entry.position].components != 3) return gltfFail(path, "positions that are not 3D");
+
+            asset.primitives.push_back(entry);
+        }
+    }
+    if (asset.primitives.empty()) return gltfFail(path, "nothing to draw");
+
+    // The bounding sphere is the only thing read from the vertices on the CPU
+    for (size_t p = 0; p < asset.primitives.size(); p++) {
+        const GltfAccessor& positions = asset.accessors[asset.primitives[p].position];
+        const GltfBufferView& view = asset.views[positions.bufferView];
+        const unsigned int componentSize = gltfComponentSize(positions.componentType);
+        const size_t stride = view.stride != 0 ? view.stride : 3 * componentSize;
+
+        for (size_t v = 0; v < positions.count; v++) {
+            const unsigned char* source = view.data + positions.byteOffset + v * stride;
+            const glm::vec3 position(readGltfComponent(source, positions.componentType, positions.normalized), readGltfComponent(source + componentSize, positions.componentType, positions.normalized),
+                readGltfComponent(source + 2 * componentSize, positions.componentType, positions.normalized));
+            asset.boundingRadius = std::max(asset.boundingRadius, glm::length(glm::vec3(asset.transform * glm::vec4(position, 1.0f))));
+        }
+    }
+
+    return true;
+}
+
+std::vector<GLBuffer> uploadGltfBufferViews(const GltfAsset& asset)
+{
+    // The copy-write target leaves the element array binding of whatever vertex array is bound alone
+    std::vector<GLBuffer> buffers(asset.views.size());
+    for (size_t i = 0; i < asset.views.size(); i++) {
+        if (!asset.views[i].used) continue;
+
+        buffers[i] = GLBuffer::generate();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[i].get());
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)asset.views[i].length, asset.views[i].data, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    return buffers;
+}
+
+static void setGltfAttribute(const GLuint location, const GltfAsset& asset, const GltfAccessor& accessor, const std::vector<GLBuffer>& buffers)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[accessor.bufferView].get());
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, (GLint)accessor.components, accessor.componentType, accessor.normalized ? GL_TRUE : GL_FALSE, (GLsizei)asset.views[accessor.bufferView].stride, (void*)accessor.byteOffset);
+}
+
+GLVertexArray createGltfVertexArray(const GltfAsset& asset, const GltfPrimitive& primitive, const std::vector<GLBuffer>& buffers, VertexLayout& layout)
+{
+    const GltfAccessor& positions = asset.accessors[primitive.position];
+    const GltfBufferView& view = asset.views[positions.bufferView];
+
+    layout = VertexLayout();
+    layout.stride = view.stride != 0 ? view.stride : 3 * gltfComponentSize(positions.componentType);
+
+    GLVertexArray VAO = GLVertexArray::generate();
+    glBindVertexArray(VAO.get());
+
+    // The same locations as the packed layouts. A normal fetched as a vector gets w = 1, which tells the shaders it is not octahedral
+    setGltfAttribute(0, asset, positions, buffers);
+    if (primitive.normal >= 0) { setGltfAttribute(1, asset, asset.accessors[primitive.normal], buffers); layout.attributes |= VERTEX_NORMAL; }
+    if (primitive.texCoords >= 0) { setGltfAttribute(2, asset, asset.accessors[primitive.texCoords], buffers); layout.attributes |= VERTEX_TEXCOORDS; }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[asset.accessors[primitive.indices].bufferView].get());
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return VAO;
+}
+
+#endif /* GLTF_LOADER_HEADER */
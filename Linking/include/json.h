@@ -0,0 +1,310 @@
+/* Filename: json.h */
+
+#ifndef JSON_HEADER
+#define JSON_HEADER
+
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum JsonType { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+/* Json Value Class. One node of a parsed JSON document. Looking up a member or an element that is not there gives a null value
+   instead of failing, so optional fields read as their default: value["accessors"][3]["byteOffset"].getNumber(0.0) */
+class JsonValue {
+private:
+    JsonType type;
+    bool boolean;
+    double number;
+    std::string text;
+    std::vector<JsonValue> elements;                         // Array elements, or member values
+    std::vector<std::string> names;                          // Member names, in the order of the values
+
+    static const JsonValue& none(void) { static const JsonValue value; return value; }
+
+    friend class JsonParser;
+
+public:
+    JsonValue(void) : type(JSON_NULL), boolean(false), number(0.0) {}
+
+    JsonType getType(void) const { return type; }
+    bool isNull(void) const { return type == JSON_NULL; }
+    bool isArray(void) const { return type == JSON_ARRAY; }
+    bool isObject(void) const { return type == JSON_OBJECT; }
+
+    bool getBool(const bool fallback) const { return type == JSON_BOOL ? boolean : fallback; }
+    double getNumber(const double fallback) const { return type == JSON_NUMBER ? number : fallback; }
+    int getInt(const int fallback) const { return type == JSON_NUMBER && number == std::floor(number) && number >= INT_MIN && number <= INT_MAX ? (int)number : fallback; } // Fractions and out of range numbers read as the fallback too
+    bool getSize(size_t& value, const size_t fallback) const; // For offsets, lengths and counts: false (value untouched) unless absent or a whole number a size_t holds
+    const std::string& getString(void) const { static const std::string empty; return type == JSON_STRING ? text : empty; }
+
+    size_t size(void) const { return type == JSON_ARRAY || type == JSON_OBJECT ? elements.size() : 0; }
+    const JsonValue& operator[](const size_t index) const { return type == JSON_ARRAY && index < elements.size() ? elements[index] : none(); }
+    const JsonValue& operator[](const std::string& name) const;
+    const std::string& getName(const size_t index) const { return names[index]; } // Of an object member
+    const JsonValue& getMember(const size_t index) const { return elements[index]; }
+};
+
+/* Json Parser Class. Builds the JsonValue tree of a whole document in one pass over its text (RFC 8259, UTF-8) */
+class JsonParser {
+private:
+    const char* cursor;
+    const char* end;
+    std::string error;
+    unsigned int depth;
+
+    static const unsigned int MAX_DEPTH = 256;
+
+    bool fail(const char* message);
+    void skipWhitespace(void);
+    bool parseValue(JsonValue& value);
+    bool parseString(std::string& text);
+    bool parseNumber(double& number);
+    bool parseLiteral(const char* literal);
+
+public:
+    JsonParser(void) : cursor(NULL), end(NULL), depth(0) {}
+
+    bool parse(const char* text, const size_t length, JsonValue& root); // False on malformed input, getError() then says what and where
+    const std::string& getError(void) const { return error; }
+};
+
+bool JsonValue::getSize(size_t& value, const size_t fallback) const
+{
+    if (type == JSON_NULL) { value = fallback; return true; }
+
+    // Below 2^53 every whole double is exact, and far beyond any file this could describe
+    if (type != JSON_NUMBER || number != std::floor(number) || number < 0.0 || number >= 9007199254740992.0 || number > (double)SIZE_MAX) return false;
+    value = (size_t)number;
+    return true;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& name) const
+{
+    if (type != JSON_OBJECT) return none();
+    for (size_t i = 0; i < names.size(); i++)
+        if (names[i] == name) return elements[i];
+    return none();
+}
+
+bool JsonParser::parse(const char* text, const size_t length, JsonValue& root)
+{
+    const char* begin = text;
+    cursor = text;
+    end = text + length;
+    depth = 0;
+    error.clear();
+
+    // A UTF-8 byte order mark is allowed before the document
+    if (length >= 3 && (unsigned char)text[0] == 0xEF && (unsigned char)text[1] == 0xBB && (unsigned char)text[2] == 0xBF) cursor += 3;
+
+    root = JsonValue();
+    bool parsed = parseValue(root);
+    if (parsed) {
+        skipWhitespace();
+        if (cursor != end) parsed = fail("unexpected text after the document");
+    }
+    if (!parsed) error += " at byte " + std::to_string(cursor - begin);
+    return parsed;
+}
+
+bool JsonParser::fail(const char* message)
+{
+    if (error.empty()) error = message;
+    return false;
+}
+
+void JsonParser::skipWhitespace(void)
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) cursor++;
+}
+
+bool JsonParser::parseValue(JsonValue& value)
+{
+    skipWhitespace();
+    if (cursor == end) return fail("unexpected end of the document");
+
+    switch (*cursor) {
+    case '{': {
+        if (++depth > MAX_DEPTH) return fail("nested too deep");
+        value.type = JSON_OBJECT;
+        cursor++;
+        skipWhitespace();
+        if (cursor < end && *cursor == '}') { cursor++; depth--; return true; }
+
+        for (;;) {
+            skipWhitespace();
+            std::string name;
+            if (cursor == end || *cursor != '"') return fail("expected a member name");
+            if (!parseString(name)) return false;
+
+            skipWhitespace();
+            if (cursor == end || *cursor != ':') return fail("expected ':' after a member name");
+            cursor++;
+
+            value.names.push_back(std::move(name));
+            value.elements.push_back(JsonValue());
+            if (!parseValue(value.elements.back())) return false;
+
+            skipWhitespace();
+            if (cursor < end && *cursor == ',') { cursor++; continue; }
+            if (cursor < end && *cursor == '}') { cursor++; depth--; return true; }
+            return fail("expected ',' or '}' in an object");
+        }
+    }
+    case '[': {
+        if (++depth > MAX_DEPTH) return fail("nested too deep");
+        value.type = JSON_ARRAY;
+        cursor++;
+        skipWhitespace();
+        if (cursor < end && *cursor == ']') { cursor++; depth--; return true; }
+
+        for (;;) {
+            value.elements.push_back(JsonValue());
+            if (!parseValue(value.elements.back())) return false;
+
+            skipWhitespace();
+            if (cursor < end && *cursor == ',') { cursor++; continue; }
+            if (cursor < end && *cursor == ']') { cursor++; depth--; return true; }
+            return fail("expected ',' or ']' in an array");
+        }
+    }
+    case '"':
+        value.type = JSON_STRING;
+        return parseString(value.text);
+    case 't':
+        value.type = JSON_BOOL;
+        value.boolean = true;
+        return parseLiteral("true");
+    case 'f':
+        value.type = JSON_BOOL;
+        value.boolean = false;
+        return parseLiteral("false");
+    case 'n':
+        value.type = JSON_NULL;
+        return parseLiteral("null");
+    default:
+        value.type = JSON_NUMBER;
+        return parseNumber(value.number);
+    }
+}
+
+bool JsonParser::parseLiteral(const char* literal)
+{
+    for (; *literal != '\0'; literal++, cursor++)
+        if (cursor == end || *cursor != *literal) return fail("unknown literal");
+    return true;
+}
+
+static void appendUTF8(std::string& text, const uint32_t codePoint)
+{
+    if (codePoint < 0x80) text += (char)codePoint;
+    else if (codePoint < 0x800) { text += (char)(0xC0 | (codePoint >> 6)); text += (char)(0x80 | (codePoint & 0x3F)); }
+    else if (codePoint < 0x10000) { text += (char)(0xE0 | (codePoint >> 12)); text += (char)(0x80 | ((codePoint >> 6) & 0x3F)); text += (char)(0x80 | (codePoint & 0x3F)); }
+    else { text += (char)(0xF0 | (codePoint >> 18)); text += (char)(0x80 | ((codePoint >> 12) & 0x3F)); text += (char)(0x80 | ((codePoint >> 6) & 0x3F)); text += (char)(0x80 | (codePoint & 0x3F)); }
+}
+
+static bool parseHex4(const char* digits, uint32_t& value)
+{
+    value = 0;
+    for (unsigned int i = 0; i < 4; i++) {
+        const char c = digits[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f') value |= (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') value |= (uint32_t)(c - 'A' + 10);
+        else return false;
+    }
+    return true;
+}
+
+bool JsonParser::parseString(std::string& text)
+{
+    cursor++; // The opening quote
+
+    for (;;) {
+        // Copying the plain runs whole, escapes are rare
+        const char* run = cursor;
+        while (cursor < end && *cursor != '"' && *cursor != '\\' && (unsigned char)*cursor >= 0x20) cursor++;
+        text.append(run, cursor);
+
+        if (cursor == end) return fail("unterminated string");
+        if (*cursor == '"') { cursor++; return true; }
+        if (*cursor != '\\') return fail("control character in a string");
+
+        if (++cursor == end) return fail("unterminated string");
+        const char escape = *cursor++;
+        switch (escape) {
+        case '"': text += '"'; break;
+        case '\\': text += '\\'; break;
+        case '/': text += '/'; break;
+        case 'b': text += '\b'; break;
+        case 'f': text += '\f'; break;
+        case 'n': text += '\n'; break;
+        case 'r': text += '\r'; break;
+        case 't': text += '\t'; break;
+        case 'u': {
+            uint32_t codePoint;
+            if (end - cursor < 4 || !parseHex4(cursor, codePoint)) return fail("bad \\u escape");
+            cursor += 4;
+
+            // Characters beyond the basic plane come as a surrogate pair of escapes
+            if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                uint32_t low;
+                if (end - cursor < 6 || cursor[0] != '\\' || cursor[1] != 'u' || !parseHex4(cursor + 2, low) || low < 0xDC00 || low >= 0xE000) return fail("unpaired surrogate");
+                cursor += 6;
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+            }
+            else if (codePoint >= 0xDC00 && codePoint < 0xE000) return fail("unpaired surrogate");
+
+            appendUTF8(text, codePoint);
+            break;
+        }
+        default:
+            return fail("unknown escape in a string");
+        }
+    }
+}
+
+bool JsonParser::parseNumber(double& number)
+{
+    // Checking the grammar here, strtod would also take hexadecimal, infinities and leading '+'
+    const char* start = cursor;
+    if (cursor < end && *cursor == '-') cursor++;
+    if (cursor == end || *cursor < '0' || *cursor > '9') return fail("unexpected character");
+    if (*cursor == '0') cursor++;
+    else while (cursor < end && *cursor >= '0' && *cursor <= '9') cursor++;
+
+    if (cursor < end && *cursor == '.') {
+        cursor++;
+        if (cursor == end || *cursor < '0' || *cursor > '9') return fail("bad number");
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') cursor++;
+    }
+    if (cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+        cursor++;
+        if (cursor < end && (*cursor == '+' || *cursor == '-')) cursor++;
+        if (cursor == end || *cursor < '0' || *cursor > '9') return fail("bad number");
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') cursor++;
+    }
+
+    // The text need not be null terminated (a mapped file), so the number gets copied out first
+    char digits[64];
+    const size_t length = (size_t)(cursor - start);
+    if (length >= sizeof(digits)) {
+        const std::string copy(start, cursor);
+        number = std::strtod(copy.c_str(), NULL);
+    }
+    else {
+        for (size_t i = 0; i < length; i++) digits[i] = start[i];
+        digits[length] = '\0';
+        number = std::strtod(digits, NULL);
+    }
+    return true;
+}
+
+#endif /* JSON_HEADER */
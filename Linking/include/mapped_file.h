@@ -0,0 +1,155 @@
+/* Filename: mapped_file.h */
+
+#ifndef MAPPED_FILE_HEADER
+#define MAPPED_FILE_HEADER
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <cstddef>
+#include <string>
+
+/* Mapped File Class. Read-only memory mapping of a whole file: pages are only read from disk when they are first touched */
+class MappedFile {
+private:
+    const unsigned char* data;
+    size_t size;
+
+#ifdef _WIN32
+    HANDLE fileHandle, mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+
+public:
+    MappedFile(void);
+    ~MappedFile(void) { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path); // Maps the file, returns false (and leaves the object closed) if that fails
+    void close(void);
+
+    void prefetch(size_t offset, size_t length) const; // Hints the OS to start reading a range in the background
+    static bool evict(const std::string& path);        // Asks the OS to drop a file's pages from its cache, so that the next read comes from the disk (for benchmarks). False if it would not
+
+    bool isOpen(void) const { return data != NULL; }
+    const unsigned char* getData(void) const { return data; }
+    size_t getSize(void) const { return size; }
+};
+
+MappedFile::MappedFile(void) : data(NULL), size(0)
+{
+#ifdef _WIN32
+    fileHandle = mappingHandle = NULL;
+#else
+    fileDescriptor = -1;
+#endif
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) { fileHandle = NULL; return false; }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) { close(); return false; }
+
+    mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappingHandle == NULL) { close(); return false; }
+
+    data = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    fileDescriptor = ::open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) return false;
+
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size == 0) { close(); return false; }
+
+    void* mapping = mmap(NULL, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (mapping == MAP_FAILED) { close(); return false; }
+
+    data = static_cast<const unsigned char*>(mapping);
+    size = static_cast<size_t>(fileStatus.st_size);
+#endif
+
+    if (data == NULL) { close(); return false; }
+    return true;
+}
+
+void MappedFile::close(void)
+{
+#ifdef _WIN32
+    if (data != NULL) UnmapViewOfFile(data);
+    if (mappingHandle != NULL) CloseHandle(mappingHandle);
+    if (fileHandle != NULL) CloseHandle(fileHandle);
+    fileHandle = mappingHandle = NULL;
+#else
+    if (data != NULL) munmap(const_cast<unsigned char*>(data), size);
+    if (fileDescriptor >= 0) ::close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+
+    data = NULL;
+    size = 0;
+}
+
+void MappedFile::prefetch(size_t offset, size_t length) const
+{
+    if (data == NULL || offset >= size) return;
+    if (length > size - offset) length = size - offset;
+
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<unsigned char*>(data + offset);
+    range.NumberOfBytes = length;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    // madvise wants a page aligned start
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t alignedOffset = offset - offset % pageSize;
+    madvise(const_cast<unsigned char*>(data + alignedOffset), length + (offset - alignedOffset), MADV_WILLNEED);
+#endif
+}
+
+bool MappedFile::evict(const std::string& path)
+{
+#ifdef _WIN32
+    // Opening a file unbuffered flushes its cached pages and purges them, as long as no other handle or mapping holds the file
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    CloseHandle(handle);
+    return true;
+#elif defined(POSIX_FADV_DONTNEED)
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+
+    // Dirty pages (a file just written) are not dropped, they have to reach the disk first
+    fsync(descriptor);
+    const bool evicted = posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    ::close(descriptor);
+    return evicted;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+#endif /* MAPPED_FILE_HEADER */
@@ -8,61 +8,91 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <gl_resource.h>
+#include <texture_cache.h>
+#include <vertex_layout.h>
 #include <shader.h>
 
 #include <string>
+#include <utility>
 #include <vector>
 
-#define MAX_BONE_INFLUENCE 4
-
-/* Vertex Structure */
-typedef struct Vertex {
-    glm::vec3 Position;  // position
-    glm::vec3 Normal;    // normal
-    glm::vec2 TexCoords; // texCoords
-    glm::vec3 Tangent;   // tangent
-    glm::vec3 Bitangent; // bitangent
-
-    int m_BoneIDs[MAX_BONE_INFLUENCE];   // Bone indexes which will influence this vertex
-    float m_Weights[MAX_BONE_INFLUENCE]; // Weights from each bone
-
-} Vertex;
-
-/* Texture Structure */
+/* Texture Structure. The GL texture is looked up through the handle at every bind: the TextureCache replaces it as mip levels
+   stream in and out */
 typedef struct Texture {
-    unsigned int id;
+    TextureHandle handle;
     std::string type, path;
 } Texture;
 
-/* Mesh Class */
+/* Mesh Class. Owns its vertex array and buffers, so it can be moved but not copied. The vertices and indices only live on the GPU */
 class Mesh {
 public:
     /* Mesh Data */
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
     std::vector<Texture> textures;
-    unsigned int VAO;
+    VertexLayout layout; // The attributes and formats the GPU copy of the vertices uses
+    GLVertexArray VAO;
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures); // constructor
-    void Draw(Shader& shader);                                                                            // render the mesh
+    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, std::vector<Texture> textures, const VertexLayout& layout); // uploads the vertices and indices, keeping no CPU copy
+    Mesh(GLVertexArray VAO, const GLenum indexType, const GLsizei indexCount, const size_t indexOffset, std::vector<Texture> textures, const VertexLayout& layout); // a vertex array set up already, over buffers its model owns (no CPU copy of the vertices)
+    void Draw(Shader& shader);                                                                                                        // render the mesh
+    void DrawInstanced(Shader& shader, const GLuint instanceBuffer, const size_t offset, const GLsizei instanceCount);                // render instanceCount copies, their InstanceData read from instanceBuffer at offset
 
 private:
     /* Render Data */
-    unsigned int VBO, EBO;
+    GLBuffer VBO, EBO;
+    GLenum indexType;   // GL_UNSIGNED_SHORT whenever every index fits in 16 bits
+    GLsizei indexCount;
+    size_t indexOffset; // Bytes into the element buffer
 
-    void setupMesh(void); // initializes all the buffer objects/arrays
+    void setupMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices); // initializes all the buffer objects/arrays
+    void bindTextures(Shader& shader);   // binds the textures to their samplers
 };
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, std::vector<Texture> textures, const VertexLayout& layout)
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+    this->textures = std::move(textures);
+    this->layout = layout;
+    this->indexOffset = 0;
+
+    setupMesh(vertices, indices); // now that we have all the required data, set the vertex buffers and its attribute pointers.
+}
 
-    setupMesh(); // now that we have all the required data, set the vertex buffers and its attribute pointers.
+Mesh::Mesh(GLVertexArray VAO, const GLenum indexType, const GLsizei indexCount, const size_t indexOffset, std::vector<Texture> textures, const VertexLayout& layout)
+    : textures(std::move(textures)), layout(layout), VAO(std::move(VAO)), indexType(indexType), indexCount(indexCount), indexOffset(indexOffset)
+{
 }
 
 void Mesh::Draw(Shader& shader)
+{
+    bindTextures(shader);
+
+    // Draw mesh
+    glBindVertexArray(VAO.get());
+    glDrawElements(GL_TRIANGLES, indexCount, indexType, (void*)indexOffset);
+    glBindVertexArray(0);
+
+    // Always good practice to set everything back to defaults once configured.
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Mesh::DrawInstanced(Shader& shader, const GLuint instanceBuffer, const size_t offset, const GLsizei instanceCount)
+{
+    bindTextures(shader);
+
+    // The instance attributes only stay on for this draw
+    glBindVertexArray(VAO.get());
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    setInstanceAttributes(offset);
+
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, (void*)indexOffset, instanceCount);
+
+    clearInstanceAttributes();
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Mesh::bindTextures(Shader& shader)
 {
     // Bind appropriate textures
     unsigned int diffuseNr = 1;
@@ -81,52 +111,45 @@ void Mesh::Draw(Shader& shader)
         else if (name == "texture_normal") number = std::to_string(normalNr++);     // Transfer unsigned int to std::string
         else if (name == "texture_height") number = std::to_string(heightNr++);     // Transfer unsigned int to std::string
 
-        glUniform1i(glGetUniformLocation(shader.shaderProgramID, (name + number).c_str()), i); // Now set the sampler to the correct texture unit
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);                                          // And finally bind the texture
+        glUniform1i(glGetUniformLocation(shader.getID(), (name + number).c_str()), i); // Now set the sampler to the correct texture unit
+        glBindTexture(GL_TEXTURE_2D, textures[i].handle.getID());                              // And finally bind the texture
     }
-
-    // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-
-    // Always good practice to set everything back to defaults once configured.
-    glActiveTexture(GL_TEXTURE0);
 }
 
-void Mesh::setupMesh(void)
+void Mesh::setupMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
 {
     // Create buffers/arrays
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    VAO = GLVertexArray::generate();
+    VBO = GLBuffer::generate();
+    EBO = GLBuffer::generate();
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    // Upload the vertices in the mesh's compact layout
+    std::vector<unsigned char> packedVertices;
+    packVertices(layout, vertices, packedVertices);
 
-    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+    glBufferData(GL_ARRAY_BUFFER, packedVertices.size(), packedVertices.data(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    glBindVertexArray(VAO.get());
+
+    // 16-bit indices whenever they can address every vertex
+    indexCount = static_cast<GLsizei>(indices.size());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.get());
+
+    if (vertices.size() < 65536) {
+        std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+        indexType = GL_UNSIGNED_SHORT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), shortIndices.data(), GL_STATIC_DRAW);
+    }
+    else {
+        indexType = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    }
 
     /* Set the vertex attribute pointers */
-    glEnableVertexAttribArray(0); glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);                           // Vertex Positions
-    glEnableVertexAttribArray(1); glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));    // Vertex Normals
-    glEnableVertexAttribArray(2); glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords)); // Vertex Texture Coordinates
-    glEnableVertexAttribArray(3); glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));   // Vertex Tangent
-    glEnableVertexAttribArray(4); glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent)); // Vertex Tangent
-    glEnableVertexAttribArray(5); glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));            // Vertex Tangent
-    glEnableVertexAttribArray(6); glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights)); // Weights
+    setVertexAttributes(layout);
     
     glBindVertexArray(0);
-
-    unsigned int lightSourceVAO;
-    glGenVertexArrays(1, &lightSourceVAO);
-    glBindVertexArray(lightSourceVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
 }
 
 #endif /* MESH_HEADER */
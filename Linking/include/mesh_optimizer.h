@@ -0,0 +1,223 @@
+/* Filename: mesh_optimizer.h */
+
+#ifndef MESH_OPTIMIZER_HEADER
+#define MESH_OPTIMIZER_HEADER
+
+#include <vertex_layout.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+/* Size of the post-transform vertex cache the triangle order is tuned for, and that the ACMR is measured with */
+#define VERTEX_CACHE_SIZE 16
+
+/* What the import stage did to a mesh. ACMR: average cache miss ratio, vertices transformed per triangle (3.0 is the worst
+   case, an unindexed mesh; about 0.6 is as good as it gets for a regular grid) */
+typedef struct MeshOptimizationStats {
+    size_t verticesBefore = 0, verticesAfter = 0, triangles = 0;
+    double acmrBefore = 0.0, acmrAfter = 0.0;
+
+    void add(const MeshOptimizationStats& other);
+} MeshOptimizationStats;
+
+void MeshOptimizationStats::add(const MeshOptimizationStats& other)
+{
+    // The ACMRs get weighted by triangle count
+    const size_t total = this->triangles + other.triangles;
+    if (total > 0) {
+        this->acmrBefore = (this->acmrBefore * this->triangles + other.acmrBefore * other.triangles) / total;
+        this->acmrAfter = (this->acmrAfter * this->triangles + other.acmrAfter * other.triangles) / total;
+    }
+
+    this->verticesBefore += other.verticesBefore;
+    this->verticesAfter += other.verticesAfter;
+    this->triangles = total;
+}
+
+/* The bytes of a vertex that tell it apart: everything up to the bone attributes, which the importer never fills */
+static const size_t VERTEX_WELD_BYTES = offsetof(Vertex, m_BoneIDs);
+
+/* Hashes and compares vertices by their attribute bits */
+struct VertexBitsHash {
+    const std::vector<Vertex>* vertices;
+
+    size_t operator()(const unsigned int index) const
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&(*this->vertices)[index]);
+        uint64_t hash = 14695981039346656037ULL; // FNV-1a
+        for (size_t i = 0; i < VERTEX_WELD_BYTES; i++) hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        return (size_t)hash;
+    }
+};
+
+struct VertexBitsEqual {
+    const std::vector<Vertex>* vertices;
+
+    bool operator()(const unsigned int a, const unsigned int b) const
+    {
+        return std::memcmp(&(*this->vertices)[a], &(*this->vertices)[b], VERTEX_WELD_BYTES) == 0;
+    }
+};
+
+/* Merges the vertices whose attributes are bit for bit identical and rewrites the indices to the survivors */
+void weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    typedef std::unordered_map<unsigned int, unsigned int, VertexBitsHash, VertexBitsEqual> VertexMap; // Vertex index -> welded index
+    VertexMap unique(vertices.size(), VertexBitsHash{ &vertices }, VertexBitsEqual{ &vertices });
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+
+    for (unsigned int i = 0; i < vertices.size(); i++) {
+        std::pair<VertexMap::iterator, bool> found = unique.insert(std::make_pair(i, (unsigned int)welded.size()));
+        if (found.second) welded.push_back(vertices[i]);
+        remap[i] = found.first->second;
+    }
+
+    for (size_t i = 0; i < indices.size(); i++) indices[i] = remap[indices[i]];
+    vertices.swap(welded);
+}
+
+/* Simulates a FIFO post-transform cache over the triangles and returns the vertices transformed per triangle */
+double computeACMR(const std::vector<unsigned int>& indices, const size_t vertexCount, const unsigned int cacheSize = VERTEX_CACHE_SIZE)
+{
+    if (indices.size() < 3) return 0.0;
+
+    // A vertex is in the cache while fewer than cacheSize misses happened since it was last loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    size_t misses = 0;
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        const unsigned int vertex = indices[i];
+        if (loadedAt[vertex] == 0 || misses - loadedAt[vertex] >= cacheSize) loadedAt[vertex] = ++misses;
+    }
+
+    return (double)misses / (double)(indices.size() / 3);
+}
+
+/* Next fanning vertex of Tipsify: the candidate that stays longest in the cache while its remaining triangles get emitted,
+   then the most recent dead end, then the next vertex in input order that still has triangles */
+static int tipsifyNextVertex(const std::vector<unsigned int>& candidates, const std::vector<int>& cacheTime, const int timestamp, const std::vector<unsigned int>& liveTriangles,
+    std::vector<unsigned int>& deadEnds, size_t& cursor, const unsigned int cacheSize)
+{
+    int best = -1, bestPriority = -1;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const unsigned int vertex = candidates[i];
+        if (liveTriangles[vertex] == 0) continue;
+
+        const int age = timestamp - cacheTime[vertex];
+        const int priority = age + 2 * (int)liveTriangles[vertex] <= (int)cacheSize ? age : 0;
+        if (priority > bestPriority) { bestPriority = priority; best = (int)vertex; }
+    }
+    if (best != -1) return best;
+
+    while (!deadEnds.empty()) {
+        const unsigned int vertex = deadEnds.back();
+        deadEnds.pop_back();
+        if (liveTriangles[vertex] > 0) return (int)vertex;
+    }
+
+    for (; cursor < liveTriangles.size(); cursor++)
+        if (liveTriangles[cursor] > 0) return (int)cursor;
+
+    return -1;
+}
+
+/* Reorders the triangles for the post-transform vertex cache with Tipsify (Sander, Nehab and Barczak, "Fast Triangle
+   Reordering for Vertex Locality and Reduced Overdraw"): it fans around one vertex at a time, picking the next one among the
+   vertices just used. Linear time, within a few percent of Forsyth's ordering */
+void optimizeVertexCache(std::vector<unsigned int>& indices, const size_t vertexCount, const unsigned int cacheSize = VERTEX_CACHE_SIZE)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    // The triangles of every vertex, as offsets into one array
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) liveTriangles[indices[i]]++;
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+    std::vector<unsigned int> adjacency(adjacencyOffsets[vertexCount]);
+    std::vector<unsigned int> filled(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (unsigned int corner = 0; corner < 3; corner++) adjacency[filled[indices[t * 3 + corner]]++] = (unsigned int)t;
+
+    std::vector<int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnds, candidates, reordered;
+    reordered.reserve(triangleCount * 3);
+
+    int timestamp = (int)cacheSize + 1;
+    size_t cursor = 0;
+    int fanning = (int)indices[0];
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        for (unsigned int a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+            const unsigned int triangle = adjacency[a];
+            if (emitted[triangle]) continue;
+
+            for (unsigned int corner = 0; corner < 3; corner++) {
+                const unsigned int vertex = indices[triangle * 3 + corner];
+                reordered.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+
+                if (timestamp - cacheTime[vertex] > (int)cacheSize) cacheTime[vertex] = timestamp++;
+            }
+
+            emitted[triangle] = true;
+        }
+
+        fanning = tipsifyNextVertex(candidates, cacheTime, timestamp, liveTriangles, deadEnds, cursor, cacheSize);
+    }
+
+    indices.swap(reordered);
+}
+
+/* Renumbers the vertices in the order the triangles first use them, so the vertex fetches walk the buffer forward. Vertices
+   no triangle uses get dropped */
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    const unsigned int UNUSED = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(vertices.size(), UNUSED);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        unsigned int& target = remap[indices[i]];
+        if (target == UNUSED) {
+            target = (unsigned int)reordered.size();
+            reordered.push_back(vertices[indices[i]]);
+        }
+
+        indices[i] = target;
+    }
+
+    vertices.swap(reordered);
+}
+
+/* The import stage: welds the vertices, then orders the triangles for the vertex cache and the vertices for fetching */
+MeshOptimizationStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    MeshOptimizationStats stats;
+    stats.verticesBefore = vertices.size();
+    stats.triangles = indices.size() / 3;
+    stats.acmrBefore = computeACMR(indices, vertices.size());
+
+    weldVertices(vertices, indices);
+    optimizeVertexCache(indices, vertices.size());
+    optimizeVertexFetch(vertices, indices);
+
+    stats.verticesAfter = vertices.size();
+    stats.acmrAfter = computeACMR(indices, vertices.size());
+    return stats;
+}
+
+#endif /* MESH_OPTIMIZER_HEADER */
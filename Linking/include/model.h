@@ -5,86 +5,379 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <stb_image.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <content_hash.h>
+#include <gltf_loader.h>
+#include <mapped_file.h>
 #include <mesh.h>
+#include <mesh_optimizer.h>
+#include <model_cooker.h>
+#include <obj_loader.h>
 #include <shader.h>
+#include <texture_cache.h>
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
+#include <algorithm>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
-static unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
+/* Post-processing every model gets from ASSIMP */
+static const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+/* What importing a model file gives before anything touches GL: the welded and reordered geometry of its meshes, and the texture
+   files of each one's material. importModel makes it on any thread, the Model is then built from it on the GL thread. glTF files
+   the native loader takes come as their mapped buffers instead, and models found in the cooked cache as their mapped cooked file:
+   both skip the geometry */
+typedef struct ModelImport {
+    std::string directory;
+    std::vector<MeshGeometry> geometries;
+    std::vector<std::vector<TextureFile>> textureFiles; // One list per geometry
+    std::shared_ptr<GltfAsset> gltf;                    // Set when the glTF loader read the file, the geometries then stay empty
+    std::shared_ptr<CookedModel> cooked;                // Set when the model comes from the cooked cache, the geometries then stay empty
+    MeshOptimizationStats stats;
+    bool loaded = false;
+} ModelImport;
+
+ModelImport importModel(const std::string& path, const bool merge = true, const std::string& cookedDirectory = std::string()); // Reads a model with supported ASSIMP extensions (glTF and OBJ natively when it can), merging its meshes by material unless merge is false. With a cooked directory, from the cooked file there once one was written
+
+static void cookImport(ModelImport& import, const std::string& sourcePath, const std::string& cookedPath, const CookedModelSource& source, const uint32_t settingsKey); // Writes an imported model to the cooked cache and swaps its geometry for the mapped file
+
+static void gatherNodeGeometry(const aiNode* node, const aiScene* scene, const glm::mat4& parentTransform, const bool merge, std::vector<MeshGeometry>& geometries); // Gathers the meshes of a node and its children, placed by their transforms
+static void listMaterialTextures(const aiMaterial* material, const aiTextureType type, const std::string& typeName, std::vector<TextureFile>& files); // Adds the texture files a material has of one type
+static void extractMeshGeometry(const aiMesh* mesh, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices); // Copies the vertices and the triangles of an ASSIMP mesh, in ASSIMP's order
+static void appendTransformedGeometry(const aiMesh* mesh, const glm::mat4& transform, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices); // Same, placed by a node transform, appended to a mesh being merged
 
 /* Model Class */
 class Model {
 private:
     /* Model Data */
-    std::vector<Texture> textures_loaded; // Stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    std::vector<Texture> textures_loaded; // Every texture the meshes use, once per material reference. Their handles keep them in the TextureCache, which shares them between models
     std::vector<Mesh> meshes;
     std::string directory;
     bool gammaCorrection;
+    std::vector<GLBuffer> buffers;        // The buffer views of a glTF model, which its meshes' vertex arrays read as they are
     
-    void loadModel(std::string const& path);              // Loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes std::vector.
-    void processNode(aiNode* node, const aiScene* scene); // Processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
-
-    std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName); // Checks all material textures of a given type and loads the textures if they're not loaded yet.
+    void processGltf(const GltfAsset& asset);                                              // Uploads the buffer views and points a mesh at each primitive
+    void processCooked(const CookedModel& cooked);                                         // Uploads the vertex and index blocks and points a mesh at each part of them
+    Mesh processMesh(MeshGeometry& geometry, const std::vector<TextureFile>& textureFiles); // Uploads a mesh's geometry and gets its textures
+    Texture loadTexture(const std::string& file, const std::string& typeName);           // Gets a texture file of the model's directory from the TextureCache, which loads it unless some model already did.
 
 public:
-    Model(std::string const& path, bool gamma = false): gammaCorrection(gamma) { loadModel(path); } // Constructor, expects a filepath to a 3D model.
-    Model(void) {}
+    float BoundingRadius = 0.0f; // Radius of the smallest origin-centred sphere that contains every vertex, in model space
+    glm::mat4 RootTransform = glm::mat4(1.0f); // Places the meshes in model space when their vertices could not be baked there (glTF node transforms)
+    bool HasRootTransform = false;
+    MeshOptimizationStats importStats; // What welding and reordering did to the meshes, summed over all of them
+
+    Model(std::string const& path, bool gamma = false, bool merge = true) : Model(importModel(path, merge), gamma) {} // Constructor, expects a filepath to a 3D model.
+    Model(ModelImport import, bool gamma = false);                                                                       // Constructor from a model imported ahead (on a worker thread), on the GL thread
+    Model(MeshGeometry geometry, std::string const& directory, const std::vector<TextureFile>& textureFiles, bool gamma = false); // Constructor for generated geometry, textured from files of a directory.
+    Model(void) : gammaCorrection(false) {}
+    Model(const Model&) = delete;            // A model owns its meshes' and textures' GL objects, share it through a ModelRegistry handle instead
+    Model& operator=(const Model&) = delete;
     void Draw(Shader& shader);                                                                      // Draws the model, and thus all its meshes
+    void DrawInstanced(Shader& shader, const GLuint instanceBuffer, const size_t offset, const GLsizei instanceCount); // Draws instanceCount copies in one call per mesh, their InstanceData read from instanceBuffer at offset
+
+    const std::vector<Texture>& getTextures(void) const { return textures_loaded; } // Every texture the model's meshes use
+    void requireTextures(const float screenSize) const;                             // Tells the TextureCache the model is drawn this frame, across screenSize pixels
 };
 
+Model::Model(ModelImport import, bool gamma) : directory(import.directory), gammaCorrection(gamma)
+{
+    importStats = import.stats;
+    if (import.gltf) processGltf(*import.gltf);
+    if (import.cooked) processCooked(*import.cooked);
+
+    meshes.reserve(import.geometries.size());
+    for (size_t i = 0; i < import.geometries.size(); i++) meshes.push_back(processMesh(import.geometries[i], import.textureFiles[i]));
+}
+
+Model::Model(MeshGeometry geometry, std::string const& directory, const std::vector<TextureFile>& textureFiles, bool gamma) : directory(directory), gammaCorrection(gamma)
+{
+    // Generated geometry comes indexed and in a cache friendly order already, it skips the import stage
+    meshes.push_back(processMesh(geometry, textureFiles));
+}
+
 void Model::Draw(Shader& shader) {
     for (unsigned int i = 0; i < meshes.size(); i++)
         meshes[i].Draw(shader);
 }
 
-void Model::loadModel(std::string const& path)
+void Model::DrawInstanced(Shader& shader, const GLuint instanceBuffer, const size_t offset, const GLsizei instanceCount)
 {
-    Assimp::Importer importer; // Read file via ASSIMP
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        meshes[i].DrawInstanced(shader, instanceBuffer, offset, instanceCount);
+}
+
+ModelImport importModel(const std::string& path, const bool merge, const std::string& cookedDirectory)
+{
+    ModelImport import;
+
+    // glTF buffers already hold vertices GL can draw from, so they skip ASSIMP and the repacking
+    const std::string extension = path.substr(std::min(path.size(), path.find_last_of('.')));
+    if (extension == ".gltf" || extension == ".glb") {
+        std::shared_ptr<GltfAsset> gltf = std::make_shared<GltfAsset>();
+        if (loadGltf(path, *gltf)) {
+            import.directory = gltf->directory;
+            import.gltf = gltf;
+            import.loaded = true;
+            return import;
+        }
+    }
 
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    // The cooked cache: a file named after the source and the import settings, which holds the meshes packed as the GPU takes them.
+    // Found current, it gets mapped and nothing is imported. Otherwise the source gets hashed ahead of the import it is cooked from
+    const uint32_t cookKey = cookedModelKey(MODEL_IMPORT_FLAGS, merge);
+    CookedModelSource source;
+    std::string cookedPath;
+    if (!cookedDirectory.empty()) {
+        cookedPath = cookedModelPath(cookedDirectory, path, cookKey);
+
+        std::shared_ptr<CookedModel> cooked = std::make_shared<CookedModel>();
+        if (cooked->open(cookedPath, path, cookKey)) {
+            import.directory = path.substr(0, path.find_last_of('/'));
+            import.cooked = cooked;
+            import.loaded = true;
+            return import;
+        }
+        if (!hashModelSource(path, source)) cookedPath.clear();
+    }
+
+    // OBJ files get parsed in parallel chunks, straight into the importer's geometry
+    if (extension == ".obj") {
+        ObjModel obj;
+        if (importObj(path, merge, obj)) {
+            import.directory = path.substr(0, path.find_last_of('/'));
+            for (size_t i = 0; i < obj.geometries.size(); i++) {
+                MeshGeometry& geometry = obj.geometries[i];
+                import.stats.add(optimizeMesh(geometry.vertices, geometry.indices));
+
+                const ObjMaterial& material = obj.materials[geometry.materialIndex];
+                std::vector<TextureFile> files;
+                if (!material.diffuse.empty()) files.push_back(TextureFile{ "texture_diffuse", material.diffuse });
+                if (!material.specular.empty()) files.push_back(TextureFile{ "texture_specular", material.specular });
+                if (!material.bump.empty()) files.push_back(TextureFile{ "texture_normal", material.bump });
+                if (!material.ambient.empty()) files.push_back(TextureFile{ "texture_height", material.ambient });
+
+                import.geometries.push_back(std::move(geometry));
+                import.textureFiles.push_back(std::move(files));
+            }
+            cookImport(import, path, cookedPath, source, cookKey);
+            import.loaded = true;
+            return import;
+        }
+    }
+
+    Assimp::Importer importer; // Read file via ASSIMP, one importer per call so that models import side by side
+
+    const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+        return import;
+    }
+
+    import.directory = path.substr(0, path.find_last_of('/')); // Retrieve the directory path of the filepath
+
+    // Process ASSIMP's root node recursively, the models are static so every part gets baked where its node puts it
+    std::vector<MeshGeometry> geometries;
+    gatherNodeGeometry(scene->mRootNode, scene, glm::mat4(1.0f), merge, geometries);
+
+    for (size_t i = 0; i < geometries.size(); i++) {
+        MeshGeometry& geometry = geometries[i];
+        if (geometry.indices.empty()) continue;
+
+        // Weld the vertices and reorder them for the vertex cache and fetching
+        import.stats.add(optimizeMesh(geometry.vertices, geometry.indices));
+
+        /* The Material's textures: 1. Diffuse Maps 2. Specular Maps 3. Normal Maps 4. Height Maps */
+        const aiMaterial* material = scene->mMaterials[geometry.materialIndex];
+        std::vector<TextureFile> files;
+        listMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", files);
+        listMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", files);
+        listMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", files);
+        listMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", files);
+
+        import.geometries.push_back(std::move(geometry));
+        import.textureFiles.push_back(std::move(files));
+    }
+
+    cookImport(import, path, cookedPath, source, cookKey);
+    import.loaded = true;
+    return import;
+}
+
+static void cookImport(ModelImport& import, const std::string& sourcePath, const std::string& cookedPath, const CookedModelSource& source, const uint32_t settingsKey)
+{
+    if (cookedPath.empty()) return;
+    if (!cookModel(import.geometries, import.textureFiles, source, settingsKey, cookedPath)) {
+        std::cout << "ERROR::MODEL:: cannot write the cooked model " << cookedPath << std::endl;
         return;
     }
 
-    directory = path.substr(0, path.find_last_of('/')); // Retrieve the directory path of the filepath
-    processNode(scene->mRootNode, scene);               // Process ASSIMP's root node recursively
+    // The model then gets built the way the next runs will build it, from the mapping
+    std::shared_ptr<CookedModel> cooked = std::make_shared<CookedModel>();
+    if (!cooked->open(cookedPath, sourcePath, settingsKey)) return;
+    import.cooked = cooked;
+    import.geometries.clear();
+    import.textureFiles.clear();
+}
+
+void Model::processGltf(const GltfAsset& asset)
+{
+    buffers = uploadGltfBufferViews(asset);
+    BoundingRadius = asset.boundingRadius;
+    RootTransform = asset.transform;
+    HasRootTransform = RootTransform != glm::mat4(1.0f);
+
+    meshes.reserve(asset.primitives.size());
+    for (size_t i = 0; i < asset.primitives.size(); i++) {
+        const GltfPrimitive& primitive = asset.primitives[i];
+
+        std::vector<Texture> textures;
+        if (primitive.material >= 0 && primitive.material < (int)asset.materialDiffuse.size() && !asset.materialDiffuse[primitive.material].empty())
+            textures.push_back(loadTexture(asset.materialDiffuse[primitive.material], "texture_diffuse"));
+
+        VertexLayout layout;
+        GLVertexArray VAO = createGltfVertexArray(asset, primitive, buffers, layout);
+
+        const GltfAccessor& indices = asset.accessors[primitive.indices];
+        meshes.push_back(Mesh(std::move(VAO), indices.componentType, (GLsizei)indices.count, indices.byteOffset, std::move(textures), layout));
+    }
+}
+
+void Model::processCooked(const CookedModel& cooked)
+{
+    // One buffer for the vertices of every mesh and one for their indices, straight from the mapping. The copy-write target leaves
+    // the element array binding of whatever vertex array is bound alone
+    GLBuffer vertexBuffer = GLBuffer::generate(), indexBuffer = GLBuffer::generate();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer.get());
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)cooked.getVertexBytes(), cooked.getVertexData(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer.get());
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)cooked.getIndexBytes(), cooked.getIndexData(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    BoundingRadius = cooked.getBoundingRadius();
+
+    meshes.reserve(cooked.getMeshCount());
+    for (unsigned int i = 0; i < cooked.getMeshCount(); i++) {
+        const CookedMesh& mesh = cooked.getMesh(i);
+
+        std::vector<Texture> textures;
+        const std::vector<TextureFile> files = cooked.getTextureFiles(i);
+        for (size_t t = 0; t < files.size(); t++) textures.push_back(loadTexture(files[t].file, files[t].type));
+
+        const VertexLayout layout = cooked.getLayout(i);
+        GLVertexArray VAO = GLVertexArray::generate();
+        glBindVertexArray(VAO.get());
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.get());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.get());
+        setVertexAttributes(layout, (size_t)mesh.vertexOffset);
+        glBindVertexArray(0);
+
+        meshes.push_back(Mesh(std::move(VAO), mesh.indexType, (GLsizei)mesh.indexCount, (size_t)mesh.indexOffset, std::move(textures), layout));
+    }
+
+    buffers.push_back(std::move(vertexBuffer));
+    buffers.push_back(std::move(indexBuffer));
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+static void gatherNodeGeometry(const aiNode* node, const aiScene* scene, const glm::mat4& parentTransform, const bool merge, std::vector<MeshGeometry>& geometries)
 {
-    // Process each mesh located at the current node
+    // ASSIMP matrices are row major, glm ones column major
+    const aiMatrix4x4& local = node->mTransformation;
+    const glm::mat4 transform = parentTransform * glm::transpose(glm::make_mat4(&local.a1));
+
+    // Gather each mesh located at the current node, into the geometry of its material when merging
     for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
+        const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+
+        size_t target = geometries.size();
+        if (merge)
+            for (size_t g = 0; g < geometries.size(); g++)
+                if (geometries[g].materialIndex == mesh->mMaterialIndex) { target = g; break; }
+
+        if (target == geometries.size()) {
+            geometries.push_back(MeshGeometry());
+            geometries.back().materialIndex = mesh->mMaterialIndex;
+        }
+
+        MeshGeometry& geometry = geometries[target];
+        if (mesh->HasNormals()) geometry.attributes |= VERTEX_NORMAL;
+        if (mesh->mTextureCoords[0]) geometry.attributes |= VERTEX_TEXCOORDS;
+        if (mesh->mTextureCoords[0] && mesh->HasTangentsAndBitangents()) geometry.attributes |= VERTEX_TANGENT_FRAME;
+
+        appendTransformedGeometry(mesh, transform, geometry.vertices, geometry.indices);
     }
     // After we've processed all of the meshes (if any) we then recursively process each of the children nodes
     for (unsigned int i = 0; i < node->mNumChildren; i++)
-        processNode(node->mChildren[i], scene);
+        gatherNodeGeometry(node->mChildren[i], scene, transform, merge, geometries);
+}
+
+static void listMaterialTextures(const aiMaterial* material, const aiTextureType type, const std::string& typeName, std::vector<TextureFile>& files)
+{
+    for (unsigned int i = 0; i < material->GetTextureCount(type); i++) {
+        aiString str;
+        material->GetTexture(type, i, &str);
+
+        const TextureFile file = { typeName, str.C_Str() };
+        files.push_back(file);
+    }
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+Mesh Model::processMesh(MeshGeometry& geometry, const std::vector<TextureFile>& textureFiles)
 {
-    // Data to fill
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
     std::vector<Texture> textures;
+    for (size_t i = 0; i < textureFiles.size(); i++)
+        textures.push_back(loadTexture(textureFiles[i].file, textureFiles[i].type));
+
+    for (size_t i = 0; i < geometry.vertices.size(); i++)
+        BoundingRadius = std::max(BoundingRadius, glm::length(geometry.vertices[i].Position));
+
+    const VertexLayout layout = chooseMeshLayout(geometry, textureFiles); // Pick the Vertex Layout
+
+    Mesh mesh(geometry.vertices, geometry.indices, textures, layout); // a mesh object created from the extracted mesh data
+
+    // Once uploaded the geometry is of no more use, it goes before the next mesh gets uploaded
+    geometry = MeshGeometry();
+    return mesh;
+}
+
+Texture Model::loadTexture(const std::string& file, const std::string& typeName)
+{
+    // The cache finds textures loaded before, by this model or any other, under this name or another
+    const TextureHandle handle = TextureCache::global().load(this->directory + '/' + file);
+
+    Texture texture;
+    texture.handle = handle;
+    texture.type = typeName;
+    texture.path = file;
+    textures_loaded.push_back(texture);
+
+    return texture;
+}
+
+void Model::requireTextures(const float screenSize) const
+{
+    for (size_t i = 0; i < textures_loaded.size(); i++) TextureCache::global().require(textures_loaded[i].handle, screenSize);
+}
+
+static void extractMeshGeometry(const aiMesh* mesh, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    vertices.reserve(mesh->mNumVertices);
+    indices.reserve(mesh->mNumFaces * 3);
 
     // Walk through each of the mesh's vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        Vertex vertex;
+        Vertex vertex = {}; // Zeroed, so attributes the mesh lacks compare equal when welding
 
         // We declare a placeholder vector since assimp uses its own vector class that doesn't directly 
         // convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
@@ -132,99 +425,45 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
     }
 
     // Now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+    // Points and lines, which triangulation leaves alone, are skipped.
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
+        const aiFace& face = mesh->mFaces[i];
+        if (face.mNumIndices != 3) continue;
         for (unsigned int j = 0; j < face.mNumIndices; j++)
             indices.push_back(face.mIndices[j]);
     }
-
-    /* Process the Materials */
-    aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-
-    // 1. Diffuse Maps
-    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse"); 
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-
-    // 2. Specular Maps
-    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular"); 
-    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-
-    // 3. Normal Maps
-    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal"); 
-    textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-
-    // 4. Height Maps
-    std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height"); 
-    textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-    return Mesh(vertices, indices, textures); // return a mesh object created from the extracted mesh data
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+static void appendTransformedGeometry(const aiMesh* mesh, const glm::mat4& transform, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
 {
-    std::vector<Texture> textures;
-    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
-        aiString str;
-        mat->GetTexture(type, i, &str);
-        
-        // Check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-        bool skip = false;
-        for (unsigned int j = 0; j < textures_loaded.size(); j++)
-            if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-                textures.push_back(textures_loaded[j]);
-                skip = true; // A texture with the same filepath has already been loaded, continue to next one. (optimization)
-                break;
-            }
-
-        // If texture hasn't been loaded already, load it
-        if (!skip) {
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), this->directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture); // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+    std::vector<Vertex> partVertices;
+    std::vector<unsigned int> partIndices;
+    extractMeshGeometry(mesh, partVertices, partIndices);
+
+    // Directions go through the inverse transpose (normals) or the plain linear part (tangents), then get renormalized
+    const glm::mat3 linear = glm::mat3(transform);
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+    const bool mirrored = glm::determinant(linear) < 0.0f;
+
+    for (size_t i = 0; i < partVertices.size(); i++) {
+        Vertex& vertex = partVertices[i];
+        vertex.Position = glm::vec3(transform * glm::vec4(vertex.Position, 1.0f));
+        if (mesh->HasNormals()) vertex.Normal = glm::normalize(normalMatrix * vertex.Normal);
+        if (mesh->HasTangentsAndBitangents()) {
+            vertex.Tangent = glm::normalize(linear * vertex.Tangent);
+            vertex.Bitangent = glm::normalize(linear * vertex.Bitangent);
         }
     }
 
-    return textures;
-}
-
-static unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma)
-{
-    std::string filename = std::string(path);
-    filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-
-    if (data) {
-        GLenum format{};
-        if (nrComponents == 1) format = GL_RED;
-        else if (nrComponents == 3) format = GL_RGB;
-        else if (nrComponents == 4) format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+    // A mirroring transform turns the triangles inside out, swapping two corners turns them back
+    const unsigned int base = (unsigned int)vertices.size();
+    for (size_t i = 0; i + 2 < partIndices.size(); i += 3) {
+        indices.push_back(base + partIndices[i]);
+        indices.push_back(base + partIndices[mirrored ? i + 2 : i + 1]);
+        indices.push_back(base + partIndices[mirrored ? i + 1 : i + 2]);
     }
 
-    return textureID;
+    vertices.insert(vertices.end(), partVertices.begin(), partVertices.end());
 }
 
 #endif /* MODEL_HEADER */
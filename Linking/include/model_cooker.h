@@ -0,0 +1,328 @@
+/* Filename: model_cooker.h */
+
+#ifndef MODEL_COOKER_HEADER
+#define MODEL_COOKER_HEADER
+
+#include <glad/glad.h>
+
+#include <content_hash.h>
+#include <mapped_file.h>
+#include <vertex_layout.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* Bumped whenever the importers, the vertex packing or the file layout change, every cooked model then gets imported again */
+#define COOKED_MODEL_VERSION 2
+
+/* A texture file of a model, relative to its directory, and the sampler type it binds to (e.g. "texture_diffuse") */
+typedef struct TextureFile {
+    std::string type, file;
+} TextureFile;
+
+/* What identifies the source file of a cooked model: its content hash, and its size and modification time, which let a load skip
+   hashing the source while they still match */
+typedef struct CookedModelSource {
+    uint64_t hash = 0;
+    uint64_t size = 0;
+    int64_t time = 0;        // Ticks of the file clock
+} CookedModelSource;
+
+/* Start of a cooked model file. The CookedMeshes follow, then the CookedTextureReferences, then the strings they point into, then
+   the vertices of every mesh in its VertexLayout and the indices of every mesh, each block 16 byte aligned */
+typedef struct CookedModelHeader {
+    char magic[4];           // "CMDL"
+    uint32_t version;
+    uint64_t sourceHash;     // contentHash of the source model file
+    uint64_t sourceSize;
+    int64_t sourceTime;      // Modification time of the source when it was last found to match sourceHash
+    uint32_t settingsKey;    // cookedModelKey of the import
+    uint32_t meshCount;
+    uint32_t textureCount;
+    float boundingRadius;    // Of the smallest origin-centred sphere around every vertex
+    uint64_t stringsOffset, stringsSize;
+    uint64_t vertexOffset, vertexSize;
+    uint64_t indexOffset, indexSize;
+} CookedModelHeader;
+
+typedef struct CookedMesh {
+    uint32_t attributes;     // VertexAttributes of its layout
+    uint32_t halfTexCoords;
+    uint32_t vertexCount, indexCount;
+    uint32_t indexType;      // GL_UNSIGNED_SHORT whenever every index fits in 16 bits, GL_UNSIGNED_INT otherwise
+    uint32_t firstTexture, textureCount;
+    uint32_t padding;
+    uint64_t vertexOffset;   // Bytes into the vertex block
+    uint64_t indexOffset;    // Bytes into the index block
+} CookedMesh;
+
+typedef struct CookedTextureReference {
+    uint32_t typeOffset, typeLength; // Bytes into the strings block
+    uint32_t fileOffset, fileLength;
+} CookedTextureReference;
+
+/* Key of the import settings a cooked model was made with: the importer's post-processing flags and whether meshes got merged */
+uint32_t cookedModelKey(const unsigned int importFlags, const bool merge)
+{
+    const uint32_t fields[3] = { COOKED_MODEL_VERSION, importFlags, merge ? 1u : 0u };
+    const uint64_t hash = contentHash(fields, sizeof(fields));
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/* Where the cooked file of a source model lives in a cache directory: named after the source's path and the settings key, so that
+   finding it takes no read of the source */
+std::string cookedModelPath(const std::string& directory, const std::string& sourcePath, const uint32_t settingsKey)
+{
+    std::ostringstream name;
+    name << std::hex << std::setfill('0') << std::setw(16) << contentHash(sourcePath.data(), sourcePath.size()) << '-' << std::setw(8) << settingsKey << ".cmdl";
+    return (std::filesystem::path(directory) / name.str()).generic_string();
+}
+
+/* Reads the size and modification time of a model's source file, without opening it. False if it is not there */
+bool stampModelSource(const std::string& path, CookedModelSource& source)
+{
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(path, error);
+    if (error) return false;
+    const std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    if (error) return false;
+
+    source.size = (uint64_t)size;
+    source.time = (int64_t)time.time_since_epoch().count();
+    return true;
+}
+
+/* Stamps a model's source file and hashes its content. False if it cannot be read */
+bool hashModelSource(const std::string& path, CookedModelSource& source)
+{
+    MappedFile file;
+    if (!stampModelSource(path, source) || !file.open(path)) return false;
+    source.hash = contentHash(file.getData(), file.getSize());
+    return true;
+}
+
+/* Picks the layout a mesh's vertices go to the GPU in: only the attributes the mesh has and its shaders can use. The importer never
+   fills the bone attributes, and the tangent frame only matters with a normal map */
+VertexLayout chooseMeshLayout(const MeshGeometry& geometry, const std::vector<TextureFile>& textureFiles)
+{
+    bool normalMap = false;
+    for (size_t i = 0; i < textureFiles.size(); i++) normalMap = normalMap || textureFiles[i].type == "texture_normal";
+
+    unsigned int attributes = geometry.attributes;
+    if (!normalMap) attributes &= ~VERTEX_TANGENT_FRAME;
+    return chooseVertexLayout(geometry.vertices, attributes);
+}
+
+static size_t alignCookedBlock(const size_t offset) { return (offset + 15) & ~(size_t)15; }
+
+/* Packs the imported meshes of a model the way they go to the GPU and writes them, with their texture references, to a cooked model
+   file. Written to a temporary file and renamed, so a reader never maps half a file. Returns false if it cannot be written */
+bool cookModel(const std::vector<MeshGeometry>& geometries, const std::vector<std::vector<TextureFile>>& textureFiles, const CookedModelSource& source, const uint32_t settingsKey, const std::string& outputPath)
+{
+    std::vector<CookedMesh> meshes(geometries.size());
+    std::vector<CookedTextureReference> references;
+    std::string strings;
+    std::vector<std::vector<unsigned char>> vertexBlocks(geometries.size());
+    size_t vertexSize = 0, indexSize = 0;
+    float boundingRadius = 0.0f;
+
+    for (size_t i = 0; i < geometries.size(); i++) {
+        const MeshGeometry& geometry = geometries[i];
+        const VertexLayout layout = chooseMeshLayout(geometry, textureFiles[i]);
+        packVertices(layout, geometry.vertices, vertexBlocks[i]);
+
+        for (size_t v = 0; v < geometry.vertices.size(); v++) boundingRadius = std::max(boundingRadius, glm::length(geometry.vertices[v].Position));
+
+        CookedMesh& mesh = meshes[i];
+        std::memset(&mesh, 0, sizeof(mesh));
+        mesh.attributes = layout.attributes;
+        mesh.halfTexCoords = layout.halfTexCoords ? 1u : 0u;
+        mesh.vertexCount = (uint32_t)geometry.vertices.size();
+        mesh.indexCount = (uint32_t)geometry.indices.size();
+        mesh.indexType = geometry.vertices.size() < 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        mesh.vertexOffset = vertexSize;
+        mesh.indexOffset = indexSize;
+        vertexSize = alignCookedBlock(vertexSize + vertexBlocks[i].size());
+        indexSize = alignCookedBlock(indexSize + geometry.indices.size() * (mesh.indexType == GL_UNSIGNED_SHORT ? 2 : 4));
+
+        mesh.firstTexture = (uint32_t)references.size();
+        mesh.textureCount = (uint32_t)textureFiles[i].size();
+        for (size_t t = 0; t < textureFiles[i].size(); t++) {
+            CookedTextureReference reference;
+            reference.typeOffset = (uint32_t)strings.size();
+            reference.typeLength = (uint32_t)textureFiles[i][t].type.size();
+            strings += textureFiles[i][t].type;
+            reference.fileOffset = (uint32_t)strings.size();
+            reference.fileLength = (uint32_t)textureFiles[i][t].file.size();
+            strings += textureFiles[i][t].file;
+            references.push_back(reference);
+        }
+    }
+
+    CookedModelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "CMDL", 4);
+    header.version = COOKED_MODEL_VERSION;
+    header.sourceHash = source.hash;
+    header.sourceSize = source.size;
+    header.sourceTime = source.time;
+    header.settingsKey = settingsKey;
+    header.meshCount = (uint32_t)meshes.size();
+    header.textureCount = (uint32_t)references.size();
+    header.boundingRadius = boundingRadius;
+
+    const size_t tablesOffset = sizeof(header);
+    const size_t referencesOffset = tablesOffset + meshes.size() * sizeof(CookedMesh);
+    header.stringsOffset = referencesOffset + references.size() * sizeof(CookedTextureReference);
+    header.stringsSize = strings.size();
+    header.vertexOffset = alignCookedBlock((size_t)(header.stringsOffset + header.stringsSize));
+    header.vertexSize = vertexSize;
+    header.indexOffset = alignCookedBlock((size_t)(header.vertexOffset + vertexSize));
+    header.indexSize = indexSize;
+
+    std::vector<unsigned char> file((size_t)(header.indexOffset + indexSize), 0);
+    std::memcpy(file.data(), &header, sizeof(header));
+    if (!meshes.empty()) std::memcpy(file.data() + tablesOffset, meshes.data(), meshes.size() * sizeof(CookedMesh));
+    if (!references.empty()) std::memcpy(file.data() + referencesOffset, references.data(), references.size() * sizeof(CookedTextureReference));
+    if (!strings.empty()) std::memcpy(file.data() + header.stringsOffset, strings.data(), strings.size());
+
+    for (size_t i = 0; i < geometries.size(); i++) {
+        if (!vertexBlocks[i].empty()) std::memcpy(file.data() + header.vertexOffset + meshes[i].vertexOffset, vertexBlocks[i].data(), vertexBlocks[i].size());
+
+        const std::vector<unsigned int>& indices = geometries[i].indices;
+        unsigned char* target = file.data() + header.indexOffset + meshes[i].indexOffset;
+        if (meshes[i].indexType == GL_UNSIGNED_INT) { if (!indices.empty()) std::memcpy(target, indices.data(), indices.size() * sizeof(unsigned int)); }
+        else
+            for (size_t j = 0; j < indices.size(); j++) {
+                const uint16_t index = (uint16_t)indices[j];
+                std::memcpy(target + j * sizeof(index), &index, sizeof(index));
+            }
+    }
+
+    std::error_code error;
+    const std::filesystem::path target(outputPath);
+    if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), error);
+
+    const std::string temporary = outputPath + ".tmp";
+    {
+        std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+        if (!output.write(reinterpret_cast<const char*>(file.data()), (std::streamsize)file.size())) return false;
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) { std::filesystem::remove(temporary, error); return false; }
+    return true;
+}
+
+/* Cooked Model Class. A cooked model file mapped into memory, its vertex and index blocks go to the GPU straight from the mapping.
+   Opening it only reads the source's size and modification time: the source gets hashed when they changed, and a source whose
+   content did not change (a checkout, a copy) has the new stamp written to the cooked file, so that the next loads skip it again */
+class CookedModel {
+private:
+    MappedFile file;
+    CookedModelHeader header;
+    const CookedMesh* meshes;
+    const CookedTextureReference* textures;
+
+    bool map(const std::string& path, const uint32_t settingsKey); // Maps the file and checks its layout, false if it is missing, damaged or of other settings
+
+public:
+    CookedModel(void) : meshes(NULL), textures(NULL) { std::memset(&header, 0, sizeof(header)); }
+
+    bool open(const std::string& path, const std::string& sourcePath, const uint32_t settingsKey); // Maps the file, false if it is missing, damaged or stale
+
+    unsigned int getMeshCount(void) const { return meshes != NULL ? header.meshCount : 0; }
+    const CookedMesh& getMesh(const unsigned int mesh) const { return meshes[mesh]; }
+    VertexLayout getLayout(const unsigned int mesh) const { return makeVertexLayout(meshes[mesh].attributes, meshes[mesh].halfTexCoords != 0); }
+    std::vector<TextureFile> getTextureFiles(const unsigned int mesh) const;
+
+    const unsigned char* getVertexData(void) const { return file.getData() + header.vertexOffset; }
+    size_t getVertexBytes(void) const { return (size_t)header.vertexSize; }
+    const unsigned char* getIndexData(void) const { return file.getData() + header.indexOffset; }
+    size_t getIndexBytes(void) const { return (size_t)header.indexSize; }
+    float getBoundingRadius(void) const { return header.boundingRadius; }
+    size_t getFileBytes(void) const { return file.getSize(); }
+};
+
+bool CookedModel::open(const std::string& path, const std::string& sourcePath, const uint32_t settingsKey)
+{
+    CookedModelSource source;
+    if (!map(path, settingsKey) || !stampModelSource(sourcePath, source)) { file.close(); meshes = NULL; textures = NULL; return false; }
+    if (source.size == header.sourceSize && source.time == header.sourceTime) return true;
+
+    // Touched since: only a change of content makes the cooked model stale
+    if (!hashModelSource(sourcePath, source) || source.hash != header.sourceHash) { file.close(); meshes = NULL; textures = NULL; return false; }
+
+    // The stamp gets rewritten with the file unmapped, Windows would not let it be written while it is
+    file.close();
+    {
+        std::fstream output(path, std::ios::binary | std::ios::in | std::ios::out);
+        output.seekp((std::streamoff)offsetof(CookedModelHeader, sourceSize));
+        output.write(reinterpret_cast<const char*>(&source.size), sizeof(source.size));
+        output.write(reinterpret_cast<const char*>(&source.time), sizeof(source.time));
+    }
+    return map(path, settingsKey);
+}
+
+bool CookedModel::map(const std::string& path, const uint32_t settingsKey)
+{
+    meshes = NULL;
+    textures = NULL;
+    if (!file.open(path) || file.getSize() < sizeof(CookedModelHeader)) { file.close(); return false; }
+
+    std::memcpy(&header, file.getData(), sizeof(header));
+    const uint64_t size = file.getSize();
+    const bool current = std::memcmp(header.magic, "CMDL", 4) == 0 && header.version == COOKED_MODEL_VERSION && header.settingsKey == settingsKey;
+    const uint64_t tablesEnd = sizeof(header) + (uint64_t)header.meshCount * sizeof(CookedMesh) + (uint64_t)header.textureCount * sizeof(CookedTextureReference);
+    const bool blocksFit = tablesEnd <= header.stringsOffset && header.stringsOffset <= size && header.stringsSize <= size - header.stringsOffset
+        && header.vertexOffset <= size && header.vertexSize <= size - header.vertexOffset && header.indexOffset <= size && header.indexSize <= size - header.indexOffset
+        && header.vertexOffset % 16 == 0 && header.indexOffset % 16 == 0;
+    if (!current || !blocksFit) { file.close(); return false; }
+
+    meshes = reinterpret_cast<const CookedMesh*>(file.getData() + sizeof(header));
+    textures = reinterpret_cast<const CookedTextureReference*>(file.getData() + sizeof(header) + header.meshCount * sizeof(CookedMesh));
+
+    // Every mesh has to stay inside the blocks, or a draw would read past its buffers
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        const CookedMesh& mesh = meshes[i];
+        const uint64_t indexBytes = mesh.indexType == GL_UNSIGNED_SHORT ? 2 : mesh.indexType == GL_UNSIGNED_INT ? 4 : 0;
+        const uint64_t stride = makeVertexLayout(mesh.attributes, mesh.halfTexCoords != 0).stride;
+        bool valid = indexBytes != 0 && mesh.vertexOffset % 4 == 0 && mesh.indexOffset % indexBytes == 0
+            && mesh.vertexOffset <= header.vertexSize && (uint64_t)mesh.vertexCount * stride <= header.vertexSize - mesh.vertexOffset
+            && mesh.indexOffset <= header.indexSize && (uint64_t)mesh.indexCount * indexBytes <= header.indexSize - mesh.indexOffset
+            && mesh.firstTexture <= header.textureCount && mesh.textureCount <= header.textureCount - mesh.firstTexture;
+        for (uint32_t t = 0; valid && t < mesh.textureCount; t++) {
+            const CookedTextureReference& reference = textures[mesh.firstTexture + t];
+            valid = (uint64_t)reference.typeOffset + reference.typeLength <= header.stringsSize && (uint64_t)reference.fileOffset + reference.fileLength <= header.stringsSize;
+        }
+        if (!valid) { file.close(); meshes = NULL; textures = NULL; return false; }
+    }
+
+    return true;
+}
+
+std::vector<TextureFile> CookedModel::getTextureFiles(const unsigned int mesh) const
+{
+    const char* strings = reinterpret_cast<const char*>(file.getData() + header.stringsOffset);
+
+    std::vector<TextureFile> files;
+    for (uint32_t t = 0; t < meshes[mesh].textureCount; t++) {
+        const CookedTextureReference& reference = textures[meshes[mesh].firstTexture + t];
+        TextureFile textureFile;
+        textureFile.type.assign(strings + reference.typeOffset, reference.typeLength);
+        textureFile.file.assign(strings + reference.fileOffset, reference.fileLength);
+        files.push_back(textureFile);
+    }
+    return files;
+}
+
+#endif /* MODEL_COOKER_HEADER */
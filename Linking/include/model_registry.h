@@ -0,0 +1,122 @@
+/* Filename: model_registry.h */
+
+#ifndef MODEL_REGISTRY_HEADER
+#define MODEL_REGISTRY_HEADER
+
+#include <model.h>
+#include <thread_pool.h>
+
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+/* One loaded model and the number of handles that refer to it */
+typedef struct ModelEntry {
+    std::string path;
+    Model model;
+    std::atomic<unsigned int> references;
+
+    template<typename... Arguments>
+    ModelEntry(const std::string& path, Arguments&&... arguments) : path(path), model(std::forward<Arguments>(arguments)...), references(0) {}
+} ModelEntry;
+
+/* Model Handle Class. A lightweight reference-counted reference to a model of a ModelRegistry: copying a handle only bumps a
+   counter, every copy draws the same resident model */
+class ModelHandle {
+private:
+    ModelEntry* entry;
+
+public:
+    ModelHandle(void) : entry(NULL) {}
+    explicit ModelHandle(ModelEntry* entry) : entry(entry) { if (entry != NULL) entry->references++; }
+    ModelHandle(const ModelHandle& other) : entry(other.entry) { if (entry != NULL) entry->references++; }
+    ModelHandle(ModelHandle&& other) : entry(other.entry) { other.entry = NULL; }
+    ~ModelHandle(void) { reset(); }
+
+    ModelHandle& operator=(ModelHandle other) { std::swap(entry, other.entry); return *this; } // Copy and swap, the old reference goes with other
+
+    void reset(void) { if (entry != NULL) entry->references--; entry = NULL; }
+
+    Model* get(void) const { return entry != NULL ? &entry->model : NULL; }
+    Model* operator->(void) const { return get(); }
+    Model& operator*(void) const { return *get(); }
+    explicit operator bool(void) const { return entry != NULL; }
+
+    const std::string& getPath(void) const { static const std::string none; return entry != NULL ? entry->path : none; }
+};
+
+/* Model Registry Class. Loads every model file once and hands out handles to it. Models nobody refers to any more stay resident
+   until collect() is called, their GL objects then wait in the GLDeletionQueue until the render loop drains it. Files prefetched
+   ahead get imported on the thread pool, so that load() only has the GL side left to do. With a cooked directory, every file is
+   imported once and mapped from its cooked model on the runs after */
+class ModelRegistry {
+private:
+    std::map<std::string, std::unique_ptr<ModelEntry>> entries;
+    std::map<std::string, std::future<ModelImport>> imports; // Prefetched files not loaded yet
+    std::string cookedDirectory;                             // Empty: every run imports the files again
+
+public:
+    ModelRegistry(void) {}
+    ModelRegistry(const ModelRegistry&) = delete;
+    ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+    void setCookedDirectory(const std::string& directory) { cookedDirectory = directory; } // Files imported from now on get cooked there, or mapped from there once they were
+    void prefetch(const std::string& path);                        // Starts importing a file on the thread pool (no GL needed, it may run before the context exists)
+    ModelHandle load(const std::string& path, bool gamma = false); // Returns a handle to the model, loading the file only the first time
+
+    // Returns a handle to the model registered under a key, building it from the Model constructor arguments the first time
+    template<typename... Arguments> ModelHandle emplace(const std::string& key, Arguments&&... arguments);
+    unsigned int collect(void);                                    // Unloads the models without handles, returns how many
+
+    size_t getModelCount(void) const { return entries.size(); }
+};
+
+void ModelRegistry::prefetch(const std::string& path)
+{
+    if (entries.count(path) || imports.count(path)) return;
+    const std::string directory = cookedDirectory;
+    imports[path] = ThreadPool::global().submit([path, directory] { return importModel(path, true, directory); });
+}
+
+ModelHandle ModelRegistry::load(const std::string& path, bool gamma)
+{
+    std::map<std::string, std::future<ModelImport>>::iterator pending = imports.find(path);
+    if (pending == imports.end()) {
+        std::map<std::string, std::unique_ptr<ModelEntry>>::iterator found = entries.find(path);
+        if (found != entries.end()) return ModelHandle(found->second.get());
+        return this->emplace(path, importModel(path, true, cookedDirectory), gamma);
+    }
+
+    ModelImport import = pending->second.get(); // Usually done already, while the window and the shaders got made
+    imports.erase(pending);
+    return this->emplace(path, std::move(import), gamma);
+}
+
+template<typename... Arguments>
+ModelHandle ModelRegistry::emplace(const std::string& key, Arguments&&... arguments)
+{
+    std::map<std::string, std::unique_ptr<ModelEntry>>::iterator found = entries.find(key);
+    if (found != entries.end()) return ModelHandle(found->second.get());
+
+    ModelEntry* entry = new ModelEntry(key, std::forward<Arguments>(arguments)...);
+    entries[key] = std::unique_ptr<ModelEntry>(entry);
+    return ModelHandle(entry);
+}
+
+unsigned int ModelRegistry::collect(void)
+{
+    unsigned int unloaded = 0;
+
+    for (std::map<std::string, std::unique_ptr<ModelEntry>>::iterator it = entries.begin(); it != entries.end();) {
+        if (it->second->references == 0) { it = entries.erase(it); unloaded++; }
+        else ++it;
+    }
+
+    return unloaded;
+}
+
+#endif /* MODEL_REGISTRY_HEADER */
@@ -0,0 +1,523 @@
+/* Filename: obj_loader.h */
+
+#ifndef OBJ_LOADER_HEADER
+#define OBJ_LOADER_HEADER
+
+#include <glm/glm.hpp>
+
+#include <mapped_file.h>
+#include <thread_pool.h>
+#include <vertex_layout.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Files get split in chunks of at least this many bytes, each one parsed by its own task */
+static const size_t OBJ_CHUNK_BYTES = (size_t)1 << 20;
+
+/* A material of the MTL libraries, and the texture files it names relative to the OBJ's directory: the same four maps ASSIMP
+   turns into diffuse, specular, height and ambient textures */
+typedef struct ObjMaterial {
+    std::string name;
+    std::string diffuse, specular, bump, ambient; // map_Kd, map_Ks, map_Bump (or bump), map_Ka
+} ObjMaterial;
+
+/* What an OBJ file holds, in the importer's terms: one indexed geometry per material (or per group and material when not merging),
+   triangulated, with smooth normals where the file has none, texture coordinates flipped for GL and tangents where they exist */
+typedef struct ObjModel {
+    std::vector<MeshGeometry> geometries; // materialIndex refers to materials
+    std::vector<ObjMaterial> materials;
+    size_t bytes = 0;                     // Size of the OBJ file
+} ObjModel;
+
+bool importObj(const std::string& path, const bool merge, ObjModel& model); // False (with the reason printed) if the file cannot be read or refers to elements it does not define
+
+/* One corner of a face. Indices are 0-based; a chunk does not know how many elements the chunks before it define, so negative
+   (relative) indices are kept relative to the chunk's first element until the chunks are joined */
+typedef struct ObjCorner {
+    int32_t element[3];  // Position, texture coordinates, normal
+    uint8_t present;     // Bit per element written
+    uint8_t relative;    // Bit per element that still needs its chunk's base
+} ObjCorner;
+
+/* A usemtl (material) or an o or g (group) statement, before the face it comes before */
+typedef struct ObjEvent {
+    size_t face;
+    bool material;
+    std::string name;
+} ObjEvent;
+
+/* Everything one line-aligned range of the file defines */
+typedef struct ObjChunk {
+    const char* begin = NULL;
+    const char* end = NULL;
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<ObjCorner> corners;
+    std::vector<uint32_t> faceSizes;
+    std::vector<ObjEvent> events;
+    std::vector<std::string> libraries;
+    size_t base[3] = { 0, 0, 0 };         // Elements the chunks before define, per kind
+    size_t firstCorner = 0;
+    size_t skippedLines = 0;
+} ObjChunk;
+
+static const char* skipObjSpace(const char* cursor, const char* end)
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) cursor++;
+    return cursor;
+}
+
+static bool parseObjFloat(const char*& cursor, const char* end, float& value)
+{
+    cursor = skipObjSpace(cursor, end);
+    if (cursor < end && *cursor == '+') cursor++; // from_chars takes no plus sign
+    const std::from_chars_result result = std::from_chars(cursor, end, value);
+    if (result.ec != std::errc()) return false;
+    cursor = result.ptr;
+    return true;
+}
+
+/* The rest of a statement, without the surrounding blanks: names may hold spaces */
+static std::string objStatementText(const char* cursor, const char* end)
+{
+    cursor = skipObjSpace(cursor, end);
+    while (end > cursor && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    return std::string(cursor, end);
+}
+
+static bool objKeyword(const char* cursor, const char* end, const char* keyword, const size_t length)
+{
+    return (size_t)(end - cursor) > length && std::memcmp(cursor, keyword, length) == 0 && (cursor[length] == ' ' || cursor[length] == '\t');
+}
+
+/* Parses the face corners of an "f" statement: v, v/vt, v//vn or v/vt/vn each */
+static bool parseObjFace(ObjChunk& chunk, const char* cursor, const char* end)
+{
+    const size_t counts[3] = { chunk.positions.size(), chunk.texCoords.size(), chunk.normals.size() };
+    const size_t first = chunk.corners.size();
+
+    for (;;) {
+        cursor = skipObjSpace(cursor, end);
+        if (cursor == end) break;
+
+        ObjCorner corner = {};
+        for (unsigned int element = 0; element < 3; element++) {
+            if (element > 0) {
+                if (cursor == end || *cursor != '/') break;
+                cursor++;
+                if (cursor < end && *cursor == '/') continue; // v//vn: no texture coordinates
+            }
+
+            // Face indices are most of an OBJ file's numbers, a plain digit loop reads them faster than from_chars
+            const bool negative = cursor < end && *cursor == '-';
+            if (negative) cursor++;
+            int64_t index = 0;
+            const char* digits = cursor;
+            while (cursor < end && *cursor >= '0' && *cursor <= '9' && index <= INT32_MAX) index = index * 10 + (*cursor++ - '0');
+            if (cursor == digits || index == 0 || index > INT32_MAX) { chunk.corners.resize(first); return false; }
+            if (negative) index = -index;
+
+            corner.present |= (uint8_t)(1u << element);
+            if (index > 0) corner.element[element] = (int32_t)(index - 1);
+            else {
+                corner.element[element] = (int32_t)((int64_t)counts[element] + index);
+                corner.relative |= (uint8_t)(1u << element);
+            }
+        }
+        if (cursor < end && *cursor != ' ' && *cursor != '\t') { chunk.corners.resize(first); return false; }
+        chunk.corners.push_back(corner);
+    }
+
+    // Lines and points ("f" with fewer than three corners) are not drawn
+    const size_t size = chunk.corners.size() - first;
+    if (size < 3) { chunk.corners.resize(first); return size != 0; }
+    chunk.faceSizes.push_back((uint32_t)size);
+    return true;
+}
+
+static void parseObjLine(ObjChunk& chunk, const char* cursor, const char* end)
+{
+    if (end > cursor && end[-1] == '\r') end--;
+    cursor = skipObjSpace(cursor, end);
+    if (cursor == end || *cursor == '#') return;
+
+    bool parsed = true;
+    if (cursor[0] == 'v' && end - cursor > 1) {
+        if (cursor[1] == ' ' || cursor[1] == '\t') {
+            glm::vec3 position;
+            cursor++;
+            parsed = parseObjFloat(cursor, end, position.x) && parseObjFloat(cursor, end, position.y) && parseObjFloat(cursor, end, position.z);
+            if (parsed) chunk.positions.push_back(position);
+        }
+        else if (objKeyword(cursor, end, "vt", 2)) {
+            // Flipped to GL's bottom-up convention, the way the importer's aiProcess_FlipUVs leaves them
+            glm::vec2 texCoords(0.0f);
+            cursor += 2;
+            parsed = parseObjFloat(cursor, end, texCoords.x);
+            if (parsed && !parseObjFloat(cursor, end, texCoords.y)) texCoords.y = 0.0f;
+            texCoords.y = 1.0f - texCoords.y;
+            if (parsed) chunk.texCoords.push_back(texCoords);
+        }
+        else if (objKeyword(cursor, end, "vn", 2)) {
+            glm::vec3 normal;
+            cursor += 2;
+            parsed = parseObjFloat(cursor, end, normal.x) && parseObjFloat(cursor, end, normal.y) && parseObjFloat(cursor, end, normal.z);
+            if (parsed) chunk.normals.push_back(normal);
+        }
+    }
+    else if (objKeyword(cursor, end, "f", 1)) parsed = parseObjFace(chunk, cursor + 1, end);
+    else if (objKeyword(cursor, end, "usemtl", 6)) {
+        const ObjEvent event = { chunk.faceSizes.size(), true, objStatementText(cursor + 6, end) };
+        chunk.events.push_back(event);
+    }
+    else if (objKeyword(cursor, end, "o", 1) || objKeyword(cursor, end, "g", 1)) {
+        const ObjEvent event = { chunk.faceSizes.size(), false, objStatementText(cursor + 1, end) };
+        chunk.events.push_back(event);
+    }
+    else if (objKeyword(cursor, end, "mtllib", 6)) chunk.libraries.push_back(objStatementText(cursor + 6, end));
+
+    if (!parsed) chunk.skippedLines++;
+}
+
+static void parseObjChunk(ObjChunk& chunk)
+{
+    // Rough reservations from the byte count, a vertex line takes about 30 bytes
+    const size_t bytes = (size_t)(chunk.end - chunk.begin);
+    chunk.positions.reserve(bytes / 96);
+    chunk.corners.reserve(bytes / 16);
+
+    const char* cursor = chunk.begin;
+    while (cursor < chunk.end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', (size_t)(chunk.end - cursor)));
+        if (lineEnd == NULL) lineEnd = chunk.end;
+        parseObjLine(chunk, cursor, lineEnd);
+        cursor = lineEnd + 1;
+    }
+}
+
+/* The texture file of a map statement: options ("-bm 0.5", "-clamp on") come before it, so with options the last word is taken */
+static std::string objMapFile(const std::string& text)
+{
+    if (text.empty() || text[0] != '-') return text;
+    const size_t space = text.find_last_of(" \t");
+    return space == std::string::npos ? std::string() : text.substr(space + 1);
+}
+
+static void parseObjMaterials(const std::string& path, std::vector<ObjMaterial>& materials)
+{
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cout << "ERROR::OBJ:: cannot read the material library " << path << std::endl;
+        return;
+    }
+
+    const char* cursor = (const char*)file.getData();
+    const char* fileEnd = cursor + file.getSize();
+    while (cursor < fileEnd) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', (size_t)(fileEnd - cursor)));
+        if (lineEnd == NULL) lineEnd = fileEnd;
+        const char* end = lineEnd > cursor && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+        const char* line = skipObjSpace(cursor, end);
+        cursor = lineEnd + 1;
+
+        if (objKeyword(line, end, "newmtl", 6)) {
+            ObjMaterial material;
+            material.name = objStatementText(line + 6, end);
+            materials.push_back(material);
+        }
+        else if (materials.empty()) continue;
+        else if (objKeyword(line, end, "map_Kd", 6)) materials.back().diffuse = objMapFile(objStatementText(line + 6, end));
+        else if (objKeyword(line, end, "map_Ks", 6)) materials.back().specular = objMapFile(objStatementText(line + 6, end));
+        else if (objKeyword(line, end, "map_Ka", 6)) materials.back().ambient = objMapFile(objStatementText(line + 6, end));
+        else if (objKeyword(line, end, "map_Bump", 8) || objKeyword(line, end, "map_bump", 8)) materials.back().bump = objMapFile(objStatementText(line + 8, end));
+        else if (objKeyword(line, end, "bump", 4)) materials.back().bump = objMapFile(objStatementText(line + 4, end));
+    }
+}
+
+/* A run of consecutive faces of one chunk that go to the same geometry */
+typedef struct ObjFaceRun {
+    size_t chunk, firstFace, faceCount, firstCorner;
+} ObjFaceRun;
+
+/* Builds one geometry from its face runs: fans the polygons into triangles and keeps one vertex per distinct corner. The corners
+   hash to their position index: the vertices at a position chain from its bucket, so a lookup only compares the texture
+   coordinates and normals of the few vertices on a seam, and faces that walk the file in order keep the buckets in cache */
+static void buildObjGeometry(const std::vector<ObjChunk>& chunks, const std::vector<ObjFaceRun>& runs, const std::vector<glm::vec3>& positions,
+    const std::vector<glm::vec2>& texCoords, const std::vector<glm::vec3>& normals, MeshGeometry& geometry)
+{
+    size_t cornerCount = 0, triangleCount = 0;
+    bool allNormals = true, anyTexCoords = false;
+    for (size_t r = 0; r < runs.size(); r++) {
+        const ObjChunk& chunk = chunks[runs[r].chunk];
+        for (size_t f = 0, corner = runs[r].firstCorner; f < runs[r].faceCount; corner += chunk.faceSizes[runs[r].firstFace + f], f++) {
+            const uint32_t size = chunk.faceSizes[runs[r].firstFace + f];
+            cornerCount += size;
+            triangleCount += size - 2;
+            for (uint32_t c = 0; c < size; c++) {
+                allNormals = allNormals && (chunk.corners[corner + c].present & 4) != 0;
+                anyTexCoords = anyTexCoords || (chunk.corners[corner + c].present & 2) != 0;
+            }
+        }
+    }
+
+    std::vector<uint32_t> buckets(positions.size(), UINT32_MAX), chains; // First vertex at each position, next vertex at the same position
+    std::vector<ObjCorner> keys;
+    keys.reserve(cornerCount / 2);
+    chains.reserve(cornerCount / 2);
+    geometry.vertices.reserve(cornerCount / 2);
+    geometry.indices.reserve(triangleCount * 3);
+
+    std::vector<uint32_t> polygon;
+    for (size_t r = 0; r < runs.size(); r++) {
+        const ObjChunk& chunk = chunks[runs[r].chunk];
+        size_t corner = runs[r].firstCorner;
+        for (size_t f = 0; f < runs[r].faceCount; f++) {
+            const uint32_t size = chunk.faceSizes[runs[r].firstFace + f];
+
+            polygon.clear();
+            for (uint32_t c = 0; c < size; c++, corner++) {
+                ObjCorner key = chunk.corners[corner];
+                if (!(key.present & 2) || !anyTexCoords) key.element[1] = -1;
+                if (!allNormals) key.element[2] = -1; // Smooth normals get generated for the whole geometry
+
+                uint32_t& bucket = buckets[key.element[0]];
+                uint32_t found = bucket;
+                while (found != UINT32_MAX && (keys[found].element[1] != key.element[1] || keys[found].element[2] != key.element[2])) found = chains[found];
+
+                if (found == UINT32_MAX) {
+                    Vertex vertex = {};
+                    vertex.Position = positions[key.element[0]];
+                    if (key.element[1] >= 0) vertex.TexCoords = texCoords[key.element[1]];
+                    if (key.element[2] >= 0) vertex.Normal = normals[key.element[2]];
+                    found = (uint32_t)geometry.vertices.size();
+                    geometry.vertices.push_back(vertex);
+                    keys.push_back(key);
+                    chains.push_back(bucket);
+                    bucket = found;
+                }
+                polygon.push_back(found);
+            }
+
+            for (uint32_t c = 1; c + 1 < size; c++) {
+                geometry.indices.push_back(polygon[0]);
+                geometry.indices.push_back(polygon[c]);
+                geometry.indices.push_back(polygon[c + 1]);
+            }
+        }
+    }
+
+    std::vector<Vertex>& vertices = geometry.vertices;
+    const std::vector<unsigned int>& indices = geometry.indices;
+
+    // Like aiProcess_GenSmoothNormals: every vertex at a position gets the average of the face normals around it
+    if (!allNormals) {
+        std::vector<glm::vec3> sums(positions.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const glm::vec3 normal = glm::cross(vertices[indices[i + 1]].Position - vertices[indices[i]].Position, vertices[indices[i + 2]].Position - vertices[indices[i]].Position);
+            const float length = glm::length(normal);
+            if (length == 0.0f) continue;
+            for (unsigned int c = 0; c < 3; c++) sums[keys[indices[i + c]].element[0]] += normal / length;
+        }
+        for (size_t v = 0; v < vertices.size(); v++) {
+            const glm::vec3& sum = sums[keys[v].element[0]];
+            vertices[v].Normal = glm::length(sum) > 0.0f ? glm::normalize(sum) : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    // Like aiProcess_CalcTangentSpace: the texture axes of the triangles around a vertex, made orthogonal to its normal
+    if (anyTexCoords) {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const Vertex& a = vertices[indices[i]];
+            const Vertex& b = vertices[indices[i + 1]];
+            const Vertex& c = vertices[indices[i + 2]];
+            const glm::vec3 edge1 = b.Position - a.Position, edge2 = c.Position - a.Position;
+            const glm::vec2 delta1 = b.TexCoords - a.TexCoords, delta2 = c.TexCoords - a.TexCoords;
+
+            const float determinant = delta1.x * delta2.y - delta2.x * delta1.y;
+            if (determinant == 0.0f) continue;
+            const glm::vec3 tangent = (edge1 * delta2.y - edge2 * delta1.y) / determinant;
+            const glm::vec3 bitangent = (edge2 * delta1.x - edge1 * delta2.x) / determinant;
+            for (unsigned int k = 0; k < 3; k++) {
+                vertices[indices[i + k]].Tangent += tangent;
+                vertices[indices[i + k]].Bitangent += bitangent;
+            }
+        }
+        for (size_t v = 0; v < vertices.size(); v++) {
+            Vertex& vertex = vertices[v];
+            glm::vec3 tangent = vertex.Tangent - vertex.Normal * glm::dot(vertex.Normal, vertex.Tangent);
+            glm::vec3 bitangent = vertex.Bitangent - vertex.Normal * glm::dot(vertex.Normal, vertex.Bitangent);
+            vertex.Tangent = glm::length(tangent) > 0.0f ? glm::normalize(tangent) : glm::vec3(0.0f);
+            vertex.Bitangent = glm::length(bitangent) > 0.0f ? glm::normalize(bitangent) : glm::vec3(0.0f);
+        }
+    }
+
+    geometry.attributes = VERTEX_NORMAL;
+    if (anyTexCoords) geometry.attributes |= VERTEX_TEXCOORDS | VERTEX_TANGENT_FRAME;
+}
+
+bool importObj(const std::string& path, const bool merge, ObjModel& model)
+{
+    model = ObjModel();
+
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cout << "ERROR::OBJ:: cannot read " << path << std::endl;
+        return false;
+    }
+    model.bytes = file.getSize();
+    const size_t slash = path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+
+    /* 1. Parse: line-aligned chunks, in parallel */
+    ThreadPool& pool = ThreadPool::global();
+    const char* text = (const char*)file.getData();
+    const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(file.getSize() / OBJ_CHUNK_BYTES, (pool.size() + 1) * 4));
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char* cursor = text;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char* end = i + 1 == chunkCount ? text + file.getSize() : std::max(cursor, text + file.getSize() * (i + 1) / chunkCount);
+        while (end < text + file.getSize() && end[-1] != '\n') end++;
+        chunks[i].begin = cursor;
+        chunks[i].end = end;
+        cursor = end;
+    }
+    pool.parallelFor(chunkCount, 1, [&chunks](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) parseObjChunk(chunks[i]);
+    });
+
+    /* 2. Join: every chunk's elements behind the ones before, with the relative indices made absolute */
+    size_t totals[3] = { 0, 0, 0 }, corners = 0, skippedLines = 0;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const size_t counts[3] = { chunks[i].positions.size(), chunks[i].texCoords.size(), chunks[i].normals.size() };
+        for (unsigned int k = 0; k < 3; k++) { chunks[i].base[k] = totals[k]; totals[k] += counts[k]; }
+        chunks[i].firstCorner = corners;
+        corners += chunks[i].corners.size();
+        skippedLines += chunks[i].skippedLines;
+    }
+    if (totals[0] > (size_t)INT32_MAX || corners == 0) {
+        std::cout << "ERROR::OBJ:: " << path << (corners == 0 ? " has no faces" : " is too large") << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> positions(totals[0]), normals(totals[2]);
+    std::vector<glm::vec2> texCoords(totals[1]);
+    std::vector<char> valid(chunkCount, 1);
+    pool.parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            ObjChunk& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.base[0]);
+            std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.base[1]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.base[2]);
+
+            for (size_t c = 0; c < chunk.corners.size(); c++) {
+                ObjCorner& corner = chunk.corners[c];
+                for (unsigned int k = 0; k < 3; k++) {
+                    if (!(corner.present & (1u << k))) { corner.element[k] = -1; continue; }
+                    const int64_t index = (int64_t)corner.element[k] + ((corner.relative & (1u << k)) ? (int64_t)chunk.base[k] : 0);
+                    if (index < 0 || index >= (int64_t)totals[k]) valid[i] = 0;
+                    corner.element[k] = (int32_t)index;
+                }
+            }
+        }
+    });
+    if (std::find(valid.begin(), valid.end(), 0) != valid.end()) {
+        std::cout << "ERROR::OBJ:: " << path << " has faces referring to elements it does not define" << std::endl;
+        return false;
+    }
+
+    /* 3. Materials, from every library the file names */
+    for (size_t i = 0; i < chunkCount; i++)
+        for (size_t l = 0; l < chunks[i].libraries.size(); l++) parseObjMaterials(directory + '/' + chunks[i].libraries[l], model.materials);
+
+    /* 4. Group the faces into geometries, in the order they first appear */
+    std::vector<std::vector<ObjFaceRun>> geometryRuns;
+    std::vector<unsigned int> geometryMaterials;
+    std::vector<int> materialGeometry; // Merging: the geometry of each material, -1 until it has one
+    int currentMaterial = -1, currentGeometry = -1, defaultMaterial = -1;
+    bool newGroup = true;
+
+    const auto materialIndex = [&model, &defaultMaterial](const std::string& name) {
+        for (size_t m = 0; m < model.materials.size(); m++)
+            if (model.materials[m].name == name) return (int)m;
+
+        // A name no library defines still gets a material of its own (untextured), as ASSIMP gives it, faces before any usemtl the default
+        if (!name.empty()) {
+            ObjMaterial material;
+            material.name = name;
+            model.materials.push_back(material);
+            return (int)model.materials.size() - 1;
+        }
+        if (defaultMaterial < 0) {
+            ObjMaterial material;
+            material.name = "DefaultMaterial";
+            model.materials.push_back(material);
+            defaultMaterial = (int)model.materials.size() - 1;
+        }
+        return defaultMaterial;
+    };
+
+    // A usemtl switches the material, o and g start a new group
+    const auto applyEvent = [&](const ObjEvent& event) {
+        if (event.material) {
+            const int material = materialIndex(event.name);
+            newGroup = newGroup || material != currentMaterial;
+            currentMaterial = material;
+        }
+        else newGroup = true;
+    };
+
+    for (size_t i = 0; i < chunkCount; i++) {
+        const ObjChunk& chunk = chunks[i];
+        size_t event = 0, corner = 0;
+        for (size_t face = 0; face < chunk.faceSizes.size();) {
+            for (; event < chunk.events.size() && chunk.events[event].face == face; event++) applyEvent(chunk.events[event]);
+            if (currentMaterial < 0) currentMaterial = materialIndex(std::string());
+
+            // The faces up to the next statement all go to one geometry
+            const size_t last = event < chunk.events.size() ? chunk.events[event].face : chunk.faceSizes.size();
+            if (merge) {
+                if ((int)materialGeometry.size() <= currentMaterial) materialGeometry.resize(currentMaterial + 1, -1);
+                if (materialGeometry[currentMaterial] < 0) {
+                    materialGeometry[currentMaterial] = (int)geometryRuns.size();
+                    geometryRuns.push_back(std::vector<ObjFaceRun>());
+                    geometryMaterials.push_back((unsigned int)currentMaterial);
+                }
+                currentGeometry = materialGeometry[currentMaterial];
+            }
+            else if (newGroup || currentGeometry < 0) {
+                currentGeometry = (int)geometryRuns.size();
+                geometryRuns.push_back(std::vector<ObjFaceRun>());
+                geometryMaterials.push_back((unsigned int)currentMaterial);
+            }
+            newGroup = false;
+
+            const ObjFaceRun run = { i, face, last - face, corner };
+            geometryRuns[currentGeometry].push_back(run);
+            for (; face < last; face++) corner += chunk.faceSizes[face];
+        }
+
+        // Statements after the chunk's last face (or in a chunk without faces) carry over to the faces of the next chunks
+        for (; event < chunk.events.size(); event++) applyEvent(chunk.events[event]);
+    }
+
+    /* 5. Build the geometries, in parallel */
+    model.geometries.resize(geometryRuns.size());
+    pool.parallelFor(geometryRuns.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t g = begin; g < end; g++) {
+            buildObjGeometry(chunks, geometryRuns[g], positions, texCoords, normals, model.geometries[g]);
+            model.geometries[g].materialIndex = geometryMaterials[g];
+        }
+    });
+
+    if (skippedLines > 0) std::cout << "ERROR::OBJ:: " << path << ": skipped " << skippedLines << " malformed lines" << std::endl;
+    return true;
+}
+
+#endif /* OBJ_LOADER_HEADER */
@@ -0,0 +1,129 @@
+/* Filename: pixel_convert.h */
+
+#ifndef PIXEL_CONVERT_HEADER
+#define PIXEL_CONVERT_HEADER
+
+#include <thread_pool.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// SSE2 is there on every x64 CPU (and asked for by x86 builds), SSSE3 gets checked at run time
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define PIXEL_CONVERT_SSE2
+    #include <emmintrin.h>
+    #include <tmmintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define PIXEL_CONVERT_SSSE3_TARGET
+    #else
+        #define PIXEL_CONVERT_SSSE3_TARGET __attribute__((target("ssse3")))
+    #endif
+#endif
+
+/* Gray to RGBA: (g, g, g, 255) */
+static void expandGrayRow(const uint8_t* source, uint8_t* target, const size_t count)
+{
+    size_t i = 0;
+#ifdef PIXEL_CONVERT_SSE2
+    const __m128i opaque = _mm_set1_epi8((char)0xFF);
+    for (; i + 16 <= count; i += 16) {
+        const __m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        const __m128i grayGrayLow = _mm_unpacklo_epi8(gray, gray), grayGrayHigh = _mm_unpackhi_epi8(gray, gray);
+        const __m128i grayAlphaLow = _mm_unpacklo_epi8(gray, opaque), grayAlphaHigh = _mm_unpackhi_epi8(gray, opaque);
+        __m128i* output = reinterpret_cast<__m128i*>(target + i * 4);
+        _mm_storeu_si128(output, _mm_unpacklo_epi16(grayGrayLow, grayAlphaLow));
+        _mm_storeu_si128(output + 1, _mm_unpackhi_epi16(grayGrayLow, grayAlphaLow));
+        _mm_storeu_si128(output + 2, _mm_unpacklo_epi16(grayGrayHigh, grayAlphaHigh));
+        _mm_storeu_si128(output + 3, _mm_unpackhi_epi16(grayGrayHigh, grayAlphaHigh));
+    }
+#endif
+    for (; i < count; i++) {
+        target[i * 4] = target[i * 4 + 1] = target[i * 4 + 2] = source[i];
+        target[i * 4 + 3] = 255;
+    }
+}
+
+/* Gray and alpha to RGBA: (g, g, g, a) */
+static void expandGrayAlphaRow(const uint8_t* source, uint8_t* target, const size_t count)
+{
+    size_t i = 0;
+#ifdef PIXEL_CONVERT_SSE2
+    const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i pairs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+        const __m128i gray = _mm_and_si128(pairs, lowBytes), alpha = _mm_srli_epi16(pairs, 8);
+        const __m128i redGreen = _mm_or_si128(gray, _mm_slli_epi16(gray, 8)), blueAlpha = _mm_or_si128(gray, _mm_slli_epi16(alpha, 8));
+        __m128i* output = reinterpret_cast<__m128i*>(target + i * 4);
+        _mm_storeu_si128(output, _mm_unpacklo_epi16(redGreen, blueAlpha));
+        _mm_storeu_si128(output + 1, _mm_unpackhi_epi16(redGreen, blueAlpha));
+    }
+#endif
+    for (; i < count; i++) {
+        target[i * 4] = target[i * 4 + 1] = target[i * 4 + 2] = source[i * 2];
+        target[i * 4 + 3] = source[i * 2 + 1];
+    }
+}
+
+#ifdef PIXEL_CONVERT_SSE2
+/* RGB to RGBA four pixels at a time with a byte shuffle, as long as 16 bytes can be read */
+PIXEL_CONVERT_SSSE3_TARGET static size_t expandRGBRowSSSE3(const uint8_t* source, uint8_t* target, const size_t count)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+
+    size_t i = 0;
+    for (; i + 6 <= count; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), opaque));
+    }
+    return i;
+}
+
+static bool cpuHasSSSE3(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+#endif
+
+/* RGB to RGBA: (r, g, b, 255) */
+static void expandRGBRow(const uint8_t* source, uint8_t* target, const size_t count)
+{
+    size_t i = 0;
+#ifdef PIXEL_CONVERT_SSE2
+    static const bool ssse3 = cpuHasSSSE3();
+    if (ssse3) i = expandRGBRowSSSE3(source, target, count);
+#endif
+    for (; i < count; i++) {
+        target[i * 4] = source[i * 3];
+        target[i * 4 + 1] = source[i * 3 + 1];
+        target[i * 4 + 2] = source[i * 3 + 2];
+        target[i * 4 + 3] = 255;
+    }
+}
+
+/* Converts a decoded image of 1 to 4 channels to RGBA the way stb_image does, flipping it upside down on the way if asked: both
+   in a single pass over the pixels, rows spread over the thread pool. The target has room for width * height * 4 bytes */
+void convertToRGBA(const uint8_t* source, const unsigned int width, const unsigned int height, const int channels, const bool flip, uint8_t* target)
+{
+    ThreadPool::global().parallelFor(height, 64, [=](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            const uint8_t* row = source + (flip ? height - 1 - y : y) * (size_t)width * channels;
+            uint8_t* output = target + y * (size_t)width * 4;
+
+            if (channels == 4) std::memcpy(output, row, (size_t)width * 4);
+            else if (channels == 3) expandRGBRow(row, output, width);
+            else if (channels == 2) expandGrayAlphaRow(row, output, width);
+            else expandGrayRow(row, output, width);
+        }
+    });
+}
+
+#endif /* PIXEL_CONVERT_HEADER */
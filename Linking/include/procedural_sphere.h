@@ -0,0 +1,100 @@
+/* Filename: procedural_sphere.h */
+
+#ifndef PROCEDURAL_SPHERE_HEADER
+#define PROCEDURAL_SPHERE_HEADER
+
+#include <vertex_layout.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <vector>
+
+/* One face of the cube the sphere gets blown up from: its outward axis, the axes its grid runs along (right and up, with
+   right x up = outward so the triangles face out) and the centre of its cell in the planet textures */
+typedef struct CubeSphereFace {
+    glm::vec3 outward, right, up;
+    glm::vec2 cellCentre;
+} CubeSphereFace;
+
+/* The planet textures are horizontal cube crosses, 4 cells wide and 3 high: -X, +Z, +X, -Z along the middle row, +Y above +Z
+   and -Y below it. Cell centres are in the textures' own orientation (v up), as the OBJ files store them. Each OBJ file lays the
+   cross out on its own rotated cube, so a planet drawn from this sphere needs that rotation on top (its Spin orientation) */
+static const CubeSphereFace CUBE_SPHERE_FACES[6] = {
+    { glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec3(1.0f, 0.0f, 0.0f),  glm::vec3(0.0f, 1.0f, 0.0f),  glm::vec2(0.375f, 0.5f) },       // +Z
+    { glm::vec3(1.0f, 0.0f, 0.0f),  glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f),  glm::vec2(0.625f, 0.5f) },       // +X
+    { glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),  glm::vec2(0.875f, 0.5f) },       // -Z
+    { glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec3(0.0f, 1.0f, 0.0f),  glm::vec2(0.125f, 0.5f) },       // -X
+    { glm::vec3(0.0f, 1.0f, 0.0f),  glm::vec3(1.0f, 0.0f, 0.0f),  glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(0.375f, 5.0f / 6.0f) }, // +Y
+    { glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec2(0.375f, 1.0f / 6.0f) }  // -Y
+};
+
+/* Gnomonic coordinate on a cube face, in [-1, 1], of equal-angle grid coordinate s in [0, 1]: equal steps of s are equal angles
+   seen from the centre, so the triangles stay close in size from the face centres to the corners */
+float cubeSphereGnomonic(const float s)
+{
+    return std::tan((s * 2.0f - 1.0f) * glm::quarter_pi<float>());
+}
+
+/* Unit direction of the point of a face at equal-angle grid coordinates (s, t), s along the face's right axis and t along up */
+glm::vec3 cubeSphereDirection(const CubeSphereFace& face, const float s, const float t)
+{
+    return glm::normalize(face.outward + cubeSphereGnomonic(s) * face.right + cubeSphereGnomonic(t) * face.up);
+}
+
+/* Texture coordinates of the point of a face at equal-angle grid coordinates (s, t), on the face's cell of the cube cross and
+   with v flipped the way the ASSIMP import (aiProcess_FlipUVs) flips them */
+glm::vec2 cubeSphereTexCoords(const CubeSphereFace& face, const float s, const float t)
+{
+    const glm::vec2 cellHalfSize(0.125f, 1.0f / 6.0f);
+    const glm::vec2 crossTexCoords = face.cellCentre + glm::vec2(cubeSphereGnomonic(s), cubeSphereGnomonic(t)) * cellHalfSize;
+    return glm::vec2(crossTexCoords.x, 1.0f - crossTexCoords.y);
+}
+
+/* Generates a cube sphere: each cube face is a subdivisions x subdivisions equal-angle grid pushed out onto the sphere. Texture
+   coordinates follow the cube cross textures the planet OBJ files use, so a generated planet and its OBJ sample the textures
+   the same way. Every face has its own vertices, there is no seam to patch */
+MeshGeometry generateCubeSphere(const unsigned int subdivisions, const float radius)
+{
+    MeshGeometry geometry;
+    geometry.attributes = VERTEX_NORMAL | VERTEX_TEXCOORDS | VERTEX_TANGENT_FRAME;
+
+    const unsigned int side = subdivisions + 1;
+    geometry.vertices.reserve(6 * side * side);
+    geometry.indices.reserve(6 * subdivisions * subdivisions * 6);
+
+    for (unsigned int f = 0; f < 6; f++) {
+        const CubeSphereFace& face = CUBE_SPHERE_FACES[f];
+        const unsigned int base = (unsigned int)geometry.vertices.size();
+
+        for (unsigned int j = 0; j < side; j++)
+            for (unsigned int i = 0; i < side; i++) {
+                const float s = (float)i / subdivisions, t = (float)j / subdivisions;
+                const glm::vec3 direction = cubeSphereDirection(face, s, t);
+
+                Vertex vertex = {};
+                vertex.Position = direction * radius;
+                vertex.Normal = direction;
+                vertex.TexCoords = cubeSphereTexCoords(face, s, t);
+
+                // u grows along right, the flipped v grows against up
+                vertex.Tangent = glm::normalize(face.right - glm::dot(face.right, direction) * direction);
+                vertex.Bitangent = -glm::normalize(face.up - glm::dot(face.up, direction) * direction);
+
+                geometry.vertices.push_back(vertex);
+            }
+
+        // Row by row, two triangles per grid cell, counter-clockwise seen from outside
+        for (unsigned int j = 0; j < subdivisions; j++)
+            for (unsigned int i = 0; i < subdivisions; i++) {
+                const unsigned int corner = base + j * side + i;
+                const unsigned int quad[6] = { corner, corner + 1, corner + side + 1, corner, corner + side + 1, corner + side };
+                geometry.indices.insert(geometry.indices.end(), quad, quad + 6);
+            }
+    }
+
+    return geometry;
+}
+
+#endif /* PROCEDURAL_SPHERE_HEADER */
@@ -0,0 +1,46 @@
+/* Filename: process_memory.h */
+
+#ifndef PROCESS_MEMORY_HEADER
+#define PROCESS_MEMORY_HEADER
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <unistd.h>
+    #include <fstream>
+#endif
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+/* Returns the memory of the process that currently sits in RAM (the working set), in bytes, or 0 if it cannot be read */
+static size_t processResidentBytes(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return static_cast<size_t>(counters.WorkingSetSize);
+#else
+    // Second field of statm: resident pages
+    std::ifstream statm("/proc/self/statm");
+    size_t totalPages = 0, residentPages = 0;
+    if (!(statm >> totalPages >> residentPages)) return 0;
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+/* Prints the resident memory of the process, labelled */
+static void reportProcessMemory(const std::string& label)
+{
+    std::cout << "Process memory (" << label << "): " << processResidentBytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+#endif /* PROCESS_MEMORY_HEADER */
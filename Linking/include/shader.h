@@ -9,16 +9,20 @@
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
 #include <glm/glm.hpp>
 
+#include <gl_resource.h>
+
 #define BUFFER_SIZE 512
 
 /* Shader Class */
 class Shader {
-public:
-	unsigned int shaderProgramID;
+private:
+	GLProgram program; // Deleted through the GL deletion queue with the shader
 
+public:
 	Shader(const char* vertexPath, const char* fragmentPath); // Constructor reads and builds the shader
 	
-	void use() { glUseProgram(this->shaderProgramID); } // Use/Activate the shader
+	unsigned int inline getID(void) const { return this->program.get(); }
+	void use() { glUseProgram(this->program.get()); } // Use/Activate the shader
 	
 	void setBool(const std::string& name, bool balue) const;
 	void setInt(const std::string& name, int value) const;
@@ -65,7 +69,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 		vertexCode = vShaderStream.str(); 
 		fragmentCode = fShaderStream.str();
 	}
-	catch (std::ifstream::failure e) {
+	catch (const std::ifstream::failure&) {
 		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
 	}
 	const char* vShaderCode = vertexCode.c_str(); 
@@ -104,16 +108,16 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 
 	// Initialize the shader program, attach our shaders to it, and link it
 	// --------------------------------------------------------------------------------------------- //
-	this->shaderProgramID = glCreateProgram();
+	this->program = GLProgram::generate();
 
-	glAttachShader(this->shaderProgramID, vertex); 
-	glAttachShader(this->shaderProgramID, fragment);
-	glLinkProgram(this->shaderProgramID);
+	glAttachShader(this->program.get(), vertex); 
+	glAttachShader(this->program.get(), fragment);
+	glLinkProgram(this->program.get());
 
 	// Retrive any error (if existed) during the program linking and print it
-	glGetProgramiv(this->shaderProgramID, GL_LINK_STATUS, &success);
+	glGetProgramiv(this->program.get(), GL_LINK_STATUS, &success);
 	if (!success) {
-		glGetProgramInfoLog(this->shaderProgramID, BUFFER_SIZE, NULL, infoLog);
+		glGetProgramInfoLog(this->program.get(), BUFFER_SIZE, NULL, infoLog);
 		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
 	}
 
@@ -123,48 +127,48 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 }
 
 void Shader::setBool(const std::string& name, bool value) const {
-	glUniform1i(glGetUniformLocation(this->shaderProgramID, name.c_str()), (int)value);
+	glUniform1i(glGetUniformLocation(this->program.get(), name.c_str()), (int)value);
 }
 
 void Shader::setInt(const std::string& name, int value) const {
-	glUniform1i(glGetUniformLocation(this->shaderProgramID, name.c_str()), value);
+	glUniform1i(glGetUniformLocation(this->program.get(), name.c_str()), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const {
-	glUniform1f(glGetUniformLocation(this->shaderProgramID, name.c_str()), value);
+	glUniform1f(glGetUniformLocation(this->program.get(), name.c_str()), value);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
-	glUniform2fv(glGetUniformLocation(this->shaderProgramID, name.c_str()), 1, &value[0]);
+	glUniform2fv(glGetUniformLocation(this->program.get(), name.c_str()), 1, &value[0]);
 }
 void Shader::setVec2(const std::string& name, float x, float y) const {
-	glUniform2f(glGetUniformLocation(this->shaderProgramID, name.c_str()), x, y);
+	glUniform2f(glGetUniformLocation(this->program.get(), name.c_str()), x, y);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
-	glUniform3fv(glGetUniformLocation(this->shaderProgramID, name.c_str()), 1, &value[0]);
+	glUniform3fv(glGetUniformLocation(this->program.get(), name.c_str()), 1, &value[0]);
 }
 void Shader::setVec3(const std::string& name, float x, float y, float z) const {
-	glUniform3f(glGetUniformLocation(this->shaderProgramID, name.c_str()), x, y, z);
+	glUniform3f(glGetUniformLocation(this->program.get(), name.c_str()), x, y, z);
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const {
-	glUniform4fv(glGetUniformLocation(this->shaderProgramID, name.c_str()), 1, &value[0]);
+	glUniform4fv(glGetUniformLocation(this->program.get(), name.c_str()), 1, &value[0]);
 }
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const {
-	glUniform4f(glGetUniformLocation(this->shaderProgramID, name.c_str()), x, y, z, w);
+	glUniform4f(glGetUniformLocation(this->program.get(), name.c_str()), x, y, z, w);
 }
 
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const {
-	glUniformMatrix2fv(glGetUniformLocation(this->shaderProgramID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix2fv(glGetUniformLocation(this->program.get(), name.c_str()), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const {
-	glUniformMatrix3fv(glGetUniformLocation(this->shaderProgramID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix3fv(glGetUniformLocation(this->program.get(), name.c_str()), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
-	glUniformMatrix4fv(glGetUniformLocation(this->shaderProgramID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(this->program.get(), name.c_str()), 1, GL_FALSE, &mat[0][0]);
 }
 
 #endif /* SHADER_HEADER */
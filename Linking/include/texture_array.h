@@ -0,0 +1,186 @@
+/* Filename: texture_array.h */
+
+#ifndef TEXTURE_ARRAY_HEADER
+#define TEXTURE_ARRAY_HEADER
+
+#include <glad/glad.h>
+
+#include <content_hash.h>
+#include <gl_resource.h>
+#include <mapped_file.h>
+#include <texture_cooker.h>
+#include <texture_streamer.h>
+#include <thread_pool.h>
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Texture Array Class. Images of one size in the layers of a GL_TEXTURE_2D_ARRAY: objects that only differ by their textures bind
+   the same array and pick a layer, so they can share a draw call. The cook settings have to give the layer size and format,
+   every image is resampled and encoded to them (through the cooked cache when there is one) or the layers would not fit
+   together. The layers are prepared on the thread pool while one flat texel per layer stands in for them, and go to the GPU
+   all at once when the last one is ready: unlike the TextureCache's textures, an array is not streamed level by level */
+class TextureArray {
+private:
+    GLTexture texture;
+    unsigned int width, height, layerCount;
+    size_t bytes; // Video memory, every layer and mip level
+
+    std::vector<std::future<std::unique_ptr<TexturePayload>>> jobs; // The layers being prepared, in order
+    std::vector<std::string> names;                                 // What each layer is made of, for the error messages
+
+    void begin(const size_t count, const unsigned char fill); // Gives the array its placeholder layers, fill in every channel
+    bool create(void);               // Uploads the prepared layers
+
+public:
+    TextureArray(void) : width(0), height(0), layerCount(0), bytes(0) {}
+
+    void load(const std::vector<std::string>& paths, const TextureCookSettings& settings, const std::string& cookedDirectory); // One layer per path, in order
+    void loadPacked(const std::vector<PackedTextureSources>& layers, const TextureCookSettings& settings, const std::string& cookedDirectory); // One packed texture per layer
+    bool update(void);               // Uploads the layers once every one is prepared, returns true on the call that did. Only on the GL thread
+    bool finish(void);               // Waits for the layers and uploads them, false if one could not be loaded (the placeholders stay)
+    void bind(const unsigned int unit) const;
+
+    bool isLoading(void) const { return !jobs.empty(); }
+    GLuint getID(void) const { return texture.get(); }
+    unsigned int getWidth(void) const { return width; }
+    unsigned int getHeight(void) const { return height; }
+    unsigned int getLayerCount(void) const { return layerCount; }
+    size_t getBytes(void) const { return bytes; }
+};
+
+void TextureArray::begin(const size_t count, const unsigned char fill)
+{
+    this->texture = GLTexture::generate();
+    this->width = this->height = 1;
+    this->layerCount = (unsigned int)count;
+    this->bytes = count * 4;
+
+    const std::vector<unsigned char> texels(count * 4, fill);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->texture.get());
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 1, 1, (GLsizei)count, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+/* Starts preparing every layer on the thread pool, update() or finish() upload them on the GL thread */
+void TextureArray::load(const std::vector<std::string>& paths, const TextureCookSettings& settings, const std::string& cookedDirectory)
+{
+    const bool s3tc = !cookedDirectory.empty() && cookedFormatSupported(COOKED_BC1);
+
+    begin(paths.size(), 128);
+    jobs.clear();
+    for (size_t i = 0; i < paths.size(); i++) {
+        const std::string path = paths[i];
+        jobs.push_back(ThreadPool::global().submit([path, cookedDirectory, settings, s3tc]() -> std::unique_ptr<TexturePayload> {
+            MappedFile source;
+            if (!source.open(path)) return NULL;
+            return prepareTexture(source, contentHash(source.getData(), source.getSize()), cookedDirectory, settings, s3tc);
+        }));
+    }
+    names = paths;
+}
+
+void TextureArray::loadPacked(const std::vector<PackedTextureSources>& layers, const TextureCookSettings& settings, const std::string& cookedDirectory)
+{
+    const bool s3tc = !cookedDirectory.empty() && cookedFormatSupported(COOKED_BC1);
+
+    begin(layers.size(), 0); // Packed masks read as nothing: no ocean, lights, clouds or relief
+    jobs.clear();
+    names.clear();
+    for (size_t i = 0; i < layers.size(); i++) {
+        const PackedTextureSources sources = layers[i];
+        jobs.push_back(ThreadPool::global().submit([sources, cookedDirectory, settings, s3tc]() -> std::unique_ptr<TexturePayload> {
+            return preparePackedTexture(sources, cookedDirectory, settings, s3tc);
+        }));
+
+        std::string name;
+        for (unsigned int c = 0; c < 4; c++)
+            if (!sources.channels[c].path.empty()) name += (name.empty() ? "" : " + ") + sources.channels[c].path;
+        names.push_back(name);
+    }
+}
+
+bool TextureArray::update(void)
+{
+    for (size_t i = 0; i < jobs.size(); i++)
+        if (jobs[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+    return !jobs.empty() && create();
+}
+
+bool TextureArray::finish(void)
+{
+    return !jobs.empty() && create();
+}
+
+bool TextureArray::create(void)
+{
+    std::vector<std::unique_ptr<TexturePayload>> layers;
+    bool complete = true;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        layers.push_back(jobs[i].get());
+        if (!layers.back()) {
+            std::cout << "ERROR::TEXTURE_ARRAY:: cannot load layer " << i << " from " << names[i] << std::endl;
+            complete = false;
+        }
+    }
+    jobs.clear();
+    if (!complete || layers.empty()) return false;
+
+    // A layer whose cooked file could not be written comes back uncompressed, it cannot share the storage of the others
+    const TexturePayload& first = *layers.front();
+    for (size_t i = 1; i < layers.size(); i++) {
+        const TexturePayload& layer = *layers[i];
+        if (layer.internalFormat != first.internalFormat || layer.levels.size() != first.levels.size() || layer.levels[0].width != first.levels[0].width || layer.levels[0].height != first.levels[0].height) {
+            std::cout << "ERROR::TEXTURE_ARRAY:: layer " << i << " (" << names[i] << ") did not come out in the size and format of the others" << std::endl;
+            return false;
+        }
+    }
+
+    this->texture = GLTexture::generate();
+    this->width = first.levels[0].width;
+    this->height = first.levels[0].height;
+    this->layerCount = (unsigned int)layers.size();
+    this->bytes = 0;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->texture.get());
+    for (size_t l = 0; l < first.levels.size(); l++) {
+        const TextureLevelData& level = first.levels[l];
+        const GLsizei depth = (GLsizei)this->layerCount;
+        if (first.compressed) glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)l, first.internalFormat, (GLsizei)level.width, (GLsizei)level.height, depth, 0, (GLsizei)(level.size * depth), NULL);
+        else glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)l, first.internalFormat, (GLsizei)level.width, (GLsizei)level.height, depth, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        for (unsigned int layer = 0; layer < this->layerCount; layer++) {
+            const TextureLevelData& data = layers[layer]->levels[l];
+            if (first.compressed) glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)l, 0, 0, (GLint)layer, (GLsizei)data.width, (GLsizei)data.height, 1, first.internalFormat, (GLsizei)data.size, data.data);
+            else glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)l, 0, 0, (GLint)layer, (GLsizei)data.width, (GLsizei)data.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data.data);
+            this->bytes += data.size;
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)first.levels.size() - 1);
+    glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, first.swizzle);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return true;
+}
+
+void TextureArray::bind(const unsigned int unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->texture.get());
+}
+
+#endif /* TEXTURE_ARRAY_HEADER */
@@ -0,0 +1,504 @@
+/* Filename: texture_cache.h */
+
+#ifndef TEXTURE_CACHE_HEADER
+#define TEXTURE_CACHE_HEADER
+
+#include <glad/glad.h>
+
+#include <content_hash.h>
+#include <gl_resource.h>
+#include <mapped_file.h>
+#include <stb_image.h>
+#include <texture_cooker.h>
+#include <texture_streamer.h>
+#include <thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* Where a texture of the cache is: a worker decodes it or the streamer uploads it while the placeholder shows, or it is in */
+enum TextureState { TEXTURE_LOADING, TEXTURE_RESIDENT, TEXTURE_FAILED };
+
+/* One texture of the cache: the GL texture, the files it was found under and the number of handles that refer to it */
+typedef struct TextureEntry {
+    GLTexture texture;               // Replaced whenever the resident mip levels change, so always look it up through a handle
+    TextureState state = TEXTURE_LOADING;
+    uint64_t contentHash = 0;
+    size_t bytes = 0;                // Video memory of the resident levels (0 while loading)
+    std::vector<std::string> paths;  // Canonical paths, the first one is the file that got decoded
+    std::atomic<unsigned int> references{ 0 };
+
+    unsigned int width = 0, height = 0;
+    std::vector<size_t> levelBytes;  // Video memory of every mip level, known once the image was first prepared
+    unsigned int residentLevel = 0;  // Finest mip level in video memory, level 0 of the GL texture
+    unsigned int targetLevel = 0;    // Finest level once the job in flight is done
+    bool busy = false;               // A worker prepares its levels, or the streamer uploads them
+    float screenSize = 0.0f;         // Largest size it was drawn at, in pixels across, in the frame of lastUsed
+    uint64_t lastUsed = 0;           // Frame it was last drawn in
+} TextureEntry;
+
+/* What one texture of the cache holds in video memory, for inspection */
+typedef struct TextureResidency {
+    std::string path;
+    unsigned int width, height, levels;
+    unsigned int residentLevel, neededLevel;
+    size_t bytes, fullBytes;         // Resident now, and with every level in
+    uint64_t framesUnused;
+} TextureResidency;
+
+/* Texture Handle Class. A reference-counted reference to a texture of the TextureCache, copying it only bumps a counter */
+class TextureHandle {
+private:
+    TextureEntry* entry;
+
+public:
+    TextureHandle(void) : entry(NULL) {}
+    friend class TextureCache;
+
+    explicit TextureHandle(TextureEntry* entry) : entry(entry) { if (entry != NULL) entry->references++; }
+    TextureHandle(const TextureHandle& other) : entry(other.entry) { if (entry != NULL) entry->references++; }
+    TextureHandle(TextureHandle&& other) : entry(other.entry) { other.entry = NULL; }
+    ~TextureHandle(void) { reset(); }
+
+    TextureHandle& operator=(TextureHandle other) { std::swap(entry, other.entry); return *this; } // Copy and swap, the old reference goes with other
+
+    void reset(void) { if (entry != NULL) entry->references--; entry = NULL; }
+
+    GLuint getID(void) const { return entry != NULL ? entry->texture.get() : 0; }
+    explicit operator bool(void) const { return entry != NULL; }
+};
+
+/* Texture Cache Class. Every texture file of the process gets decoded and uploaded once. Lookups go by canonical path first, and
+   a file seen for the first time is hashed, so a copy of a texture under another name shares the GL texture too. Loading never
+   blocks: the GL texture holds a 1x1 gray placeholder until a worker has decoded the image and update() has streamed it in,
+   a few MB per frame. Only the mip levels the screen needs get resident: every frame the renderer tells the cache how large it
+   draws each texture, finer levels are streamed in as objects come closer, and when the textures outgrow the video memory
+   budget the finest levels of the least recently used ones go first. Textures no handle refers to stay resident until
+   collect() is called. Only use it on the GL thread */
+class TextureCache {
+private:
+    std::unordered_map<std::string, TextureEntry*> byPath;                        // Canonical path -> entry
+    std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>> byContent;        // Content hash -> entry, owns the entries
+
+    static const unsigned int MAX_PREPARING = 4; // Residency changes in flight at once
+
+    /* A texture a worker is preparing */
+    typedef struct PendingTexture {
+        TextureEntry* entry;
+        std::future<std::unique_ptr<TexturePayload>> payload;
+    } PendingTexture;
+
+    std::vector<PendingTexture> pending;
+    TextureStreamer streamer;
+    size_t uploadBudget;              // Bytes streamed per update()
+    size_t memoryBudget;              // Video memory the textures may take, the finest levels of the least recently used go beyond it
+    uint64_t frame;
+
+    std::string cookedDirectory;      // Empty: textures are decoded and uploaded uncompressed
+    TextureCookSettings cookSettings;
+
+    size_t decoded, cookedLoads, cooked, pathHits, contentHits;
+
+    static std::string canonicalPath(const std::string& path);
+    static bool sameContent(const MappedFile& file, const std::string& otherPath); // Rules out hash collisions
+
+    static size_t chainBytes(const TextureEntry& entry, const unsigned int level); // Video memory of a level and every coarser one
+    unsigned int neededLevel(const TextureEntry& entry) const;                    // Finest level the last frame's screen size calls for
+    size_t committedBytes(void) const;                                           // What the textures take once the changes in flight are done
+    unsigned int affordableLevel(const TextureEntry& entry, unsigned int level, const size_t committed) const; // The level, or the finest coarser one the budget still has room for
+
+    void prepare(TextureEntry* entry, std::shared_ptr<MappedFile> file, const unsigned int targetLevel); // Has a worker prepare the levels, a NULL file is opened again
+    void finish(PendingTexture& job);                                                                  // Hands a prepared texture to the streamer
+    TextureEntry* leastRecentlyUsed(const TextureEntry* except) const;                                 // The texture to drop a level of first, NULL if none can
+    void drop(TextureEntry* entry, size_t& committed);                                                 // Streams a texture back down to fewer levels
+    void manageResidency(void);                                                                        // Refines what got closer and keeps the budget
+
+public:
+    TextureCache(const size_t uploadBudget = 4 << 20, const size_t memoryBudget = (size_t)256 << 20) : uploadBudget(uploadBudget), memoryBudget(memoryBudget), frame(1), decoded(0), cookedLoads(0), cooked(0), pathHits(0), contentHits(0) {}
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    static TextureCache& global(void); // The cache every Model loads through
+
+    void setCookedDirectory(const std::string& directory, const TextureCookSettings& settings = TextureCookSettings()) { cookedDirectory = directory; cookSettings = settings; } // Textures loaded from now on come block compressed from there
+
+    void setUploadBudget(const size_t bytes) { uploadBudget = bytes; }
+    void setMemoryBudget(const size_t bytes) { memoryBudget = bytes; }
+
+    TextureHandle load(const std::string& path); // Returns the texture of a file (the placeholder until it is streamed in), decoding it only if no file with its content was loaded yet. Empty if it cannot be read
+    void require(const TextureHandle& texture, const float screenSize); // Tells the cache a texture is drawn this frame, across screenSize pixels
+    void update(void);                          // Hands the textures the workers finished to the streamer, adjusts the resident levels to last frame's requirements and streams up to the budget. Once per frame
+    size_t collect(void);                       // Frees the textures nobody refers to any more, returns how many
+
+    size_t getTextureCount(void) const { return byContent.size(); }
+    size_t getLoadingCount(void) const;         // Textures still showing their placeholder
+    size_t getStreamedBytes(void) const { return streamer.getUploadedBytes(); }
+    size_t getResidentBytes(void) const;
+    size_t getBytesSaved(void) const;           // Video memory the shared duplicates did not take
+    size_t getMemoryBudget(void) const { return memoryBudget; }
+    std::vector<TextureResidency> getResidency(void) const; // What every texture holds in video memory, and what it needs
+    void report(void) const;                    // Prints what the cache holds and what sharing saved
+    void reportResidency(void) const;           // Prints getResidency() as a table
+};
+
+TextureCache& TextureCache::global(void)
+{
+    // The deletion queue has to outlive the cache, whose textures go there when it is destroyed at exit, and the pool its workers
+    GLDeletionQueue::global();
+    ThreadPool::global();
+
+    static TextureCache cache;
+    return cache;
+}
+
+std::string TextureCache::canonicalPath(const std::string& path)
+{
+    std::error_code error;
+    const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? std::filesystem::path(path).lexically_normal().generic_string() : canonical.generic_string();
+}
+
+bool TextureCache::sameContent(const MappedFile& file, const std::string& otherPath)
+{
+    MappedFile other;
+    return other.open(otherPath) && other.getSize() == file.getSize() && std::memcmp(other.getData(), file.getData(), file.getSize()) == 0;
+}
+
+TextureHandle TextureCache::load(const std::string& path)
+{
+    const std::string canonical = canonicalPath(path);
+
+    std::unordered_map<std::string, TextureEntry*>::const_iterator known = byPath.find(canonical);
+    if (known != byPath.end()) { pathHits++; return TextureHandle(known->second); }
+
+    // Hashing stays on this thread (about a millisecond for a few MB), so a duplicate gets the GL name right away
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(canonical)) {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        return TextureHandle();
+    }
+
+    // A new name, maybe for content that is already resident (or on its way)
+    const uint64_t hash = contentHash(file->getData(), file->getSize());
+    std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>>::iterator same = byContent.find(hash);
+    if (same != byContent.end() && sameContent(*file, same->second->paths.front())) {
+        TextureEntry* entry = same->second.get();
+        entry->paths.push_back(canonical);
+        byPath[canonical] = entry;
+
+        contentHits++;
+        std::cout << "Texture cache: " << canonical << " is the same image as " << entry->paths.front() << ", sharing it" << std::endl;
+        return TextureHandle(entry);
+    }
+
+    std::unique_ptr<TextureEntry> entry(new TextureEntry());
+    entry->texture = GLTexture::generate();
+    entry->contentHash = hash;
+    entry->paths.push_back(canonical);
+
+    // The placeholder, one gray texel that the streamed levels replace
+    const unsigned char gray[4] = { 128, 128, 128, 255 };
+    glBindTexture(GL_TEXTURE_2D, entry->texture.get());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    prepare(entry.get(), file, 0);
+
+    // A hash collision between different images keeps the older one findable by content, the new one only by path
+    TextureEntry* added = entry.get();
+    if (same == byContent.end()) byContent[hash] = std::move(entry);
+    else {
+        uint64_t key = hash;
+        while (byContent.count(key)) key++;
+        byContent[key] = std::move(entry);
+    }
+    byPath[canonical] = added;
+
+    return TextureHandle(added);
+}
+
+size_t TextureCache::chainBytes(const TextureEntry& entry, const unsigned int level)
+{
+    size_t bytes = 0;
+    for (size_t l = level; l < entry.levelBytes.size(); l++) bytes += entry.levelBytes[l];
+    return bytes;
+}
+
+unsigned int TextureCache::neededLevel(const TextureEntry& entry) const
+{
+    // Each level halves the texels across, the finest one needed has about as many as the texture covers pixels
+    const unsigned int coarsest = (unsigned int)entry.levelBytes.size() - 1;
+    if (entry.lastUsed + 1 < frame || entry.screenSize <= 0.0f) return coarsest;
+
+    const float texels = (float)std::max(entry.width, entry.height);
+    if (entry.screenSize >= texels) return 0;
+    return std::min(coarsest, (unsigned int)std::floor(std::log2(texels / entry.screenSize)));
+}
+
+size_t TextureCache::committedBytes(void) const
+{
+    size_t committed = 0;
+    for (std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>>::const_iterator it = byContent.begin(); it != byContent.end(); ++it) {
+        const TextureEntry& entry = *it->second;
+        if (entry.levelBytes.empty()) continue;
+        committed += entry.busy ? std::max(entry.bytes, chainBytes(entry, entry.targetLevel)) : entry.bytes;
+    }
+    return committed;
+}
+
+unsigned int TextureCache::affordableLevel(const TextureEntry& entry, unsigned int level, const size_t committed) const
+{
+    while (level + 1 < entry.levelBytes.size() && committed + chainBytes(entry, level) > memoryBudget + entry.bytes) level++;
+    return level;
+}
+
+void TextureCache::prepare(TextureEntry* entry, std::shared_ptr<MappedFile> file, const unsigned int targetLevel)
+{
+    // Which compressed formats the context samples is a GL question, so it is asked here rather than on the worker
+    const std::string path = entry->paths.front(), directory = cookedDirectory;
+    const uint64_t hash = entry->contentHash;
+    const TextureCookSettings settings = cookSettings;
+    const bool s3tc = !directory.empty() && cookedFormatSupported(COOKED_BC1);
+
+    PendingTexture job;
+    job.entry = entry;
+    job.payload = ThreadPool::global().submit([file, path, hash, directory, settings, s3tc]() -> std::unique_ptr<TexturePayload> {
+        if (file) return prepareTexture(*file, hash, directory, settings, s3tc);
+
+        MappedFile source;
+        if (!source.open(path)) return NULL;
+        return prepareTexture(source, hash, directory, settings, s3tc);
+    });
+    pending.push_back(std::move(job));
+
+    entry->busy = true;
+    entry->targetLevel = targetLevel;
+}
+
+void TextureCache::finish(PendingTexture& job)
+{
+    TextureEntry* entry = job.entry;
+    std::unique_ptr<TexturePayload> payload = job.payload.get();
+
+    if (!payload) {
+        std::cout << "Texture failed to load at path: " << entry->paths.front() << std::endl;
+        if (entry->state == TEXTURE_LOADING) entry->state = TEXTURE_FAILED;
+        entry->busy = false;
+        return;
+    }
+
+    if (payload->cookedNow) cooked++;
+
+    // The first time: the placeholder's texture takes the levels in place, coarsest first, down to what the screen needs by now
+    if (entry->state == TEXTURE_LOADING) {
+        if (payload->compressed) cookedLoads++;
+        else decoded++;
+
+        const size_t committed = committedBytes();
+        entry->width = payload->levels.front().width;
+        entry->height = payload->levels.front().height;
+        entry->levelBytes.clear();
+        for (size_t l = 0; l < payload->levels.size(); l++) entry->levelBytes.push_back(payload->levels[l].size);
+        entry->targetLevel = affordableLevel(*entry, neededLevel(*entry), committed);
+
+        const unsigned int firstLevel = entry->targetLevel;
+        streamer.enqueue(entry->texture.get(), std::move(payload), firstLevel, [entry, firstLevel](size_t bytes) {
+            entry->bytes = bytes;
+            entry->residentLevel = firstLevel;
+            entry->state = TEXTURE_RESIDENT;
+            entry->busy = false;
+        });
+        return;
+    }
+
+    // Later changes build a new texture, the current one keeps being drawn until it takes over
+    std::shared_ptr<GLTexture> replacement = std::make_shared<GLTexture>(GLTexture::generate());
+    const unsigned int firstLevel = entry->targetLevel;
+    streamer.enqueue(replacement->get(), std::move(payload), firstLevel, [entry, firstLevel, replacement](size_t bytes) {
+        entry->texture = std::move(*replacement); // The old one goes to the deletion queue
+        entry->bytes = bytes;
+        entry->residentLevel = firstLevel;
+        entry->busy = false;
+    });
+}
+
+TextureEntry* TextureCache::leastRecentlyUsed(const TextureEntry* except) const
+{
+    TextureEntry* oldest = NULL;
+    for (std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>>::const_iterator it = byContent.begin(); it != byContent.end(); ++it) {
+        TextureEntry* entry = it->second.get();
+        if (entry == except || entry->busy || entry->state != TEXTURE_RESIDENT || entry->residentLevel + 1 >= entry->levelBytes.size()) continue;
+
+        // Drawn last frame: only levels finer than it needs may go
+        if (entry->lastUsed + 1 >= frame && entry->residentLevel >= neededLevel(*entry)) continue;
+
+        if (oldest == NULL || entry->lastUsed < oldest->lastUsed || (entry->lastUsed == oldest->lastUsed && entry->bytes > oldest->bytes)) oldest = entry;
+    }
+
+    return oldest;
+}
+
+void TextureCache::drop(TextureEntry* entry, size_t& committed)
+{
+    // One level at a time for textures out of sight, straight to what the screen needs for the others
+    const unsigned int level = entry->lastUsed + 1 >= frame ? neededLevel(*entry) : entry->residentLevel + 1;
+    committed -= entry->bytes - chainBytes(*entry, level);
+    prepare(entry, NULL, level);
+}
+
+void TextureCache::manageResidency(void)
+{
+    size_t committed = committedBytes();
+    std::vector<TextureEntry*> refine;
+    for (std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>>::const_iterator it = byContent.begin(); it != byContent.end(); ++it) {
+        TextureEntry* entry = it->second.get();
+        if (entry->state == TEXTURE_RESIDENT && !entry->busy && neededLevel(*entry) < entry->residentLevel) refine.push_back(entry);
+    }
+
+    // Sharper levels for what got closer, largest on screen first, making room by dropping levels the screen did not need lately.
+    // What still does not fit gets as close to its need as the budget allows
+    std::sort(refine.begin(), refine.end(), [](const TextureEntry* a, const TextureEntry* b) { return a->screenSize > b->screenSize; });
+    for (size_t i = 0; i < refine.size() && pending.size() < MAX_PREPARING; i++) {
+        TextureEntry* entry = refine[i];
+        const unsigned int needed = neededLevel(*entry);
+
+        TextureEntry* victim;
+        while (committed + chainBytes(*entry, needed) > memoryBudget + entry->bytes && pending.size() + 1 < MAX_PREPARING && (victim = leastRecentlyUsed(entry)) != NULL) drop(victim, committed);
+
+        const unsigned int level = affordableLevel(*entry, needed, committed);
+        if (level >= entry->residentLevel) continue;
+
+        committed += chainBytes(*entry, level) - entry->bytes;
+        prepare(entry, NULL, level);
+    }
+
+    // Still over (the budget went down, or everything got closer): the least recently used textures lose their finest levels
+    TextureEntry* victim;
+    while (committed > memoryBudget && pending.size() < MAX_PREPARING && (victim = leastRecentlyUsed(NULL)) != NULL) drop(victim, committed);
+}
+
+void TextureCache::require(const TextureHandle& texture, const float screenSize)
+{
+    TextureEntry* entry = texture.entry;
+    if (entry == NULL) return;
+
+    entry->screenSize = entry->lastUsed == frame ? std::max(entry->screenSize, screenSize) : screenSize;
+    entry->lastUsed = frame;
+}
+
+void TextureCache::update(void)
+{
+    for (size_t i = 0; i < pending.size();) {
+        if (pending[i].payload.wait_for(std::chrono::seconds(0)) != std::future_status::ready) { i++; continue; }
+
+        PendingTexture job = std::move(pending[i]);
+        pending[i] = std::move(pending.back());
+        pending.pop_back();
+        finish(job);
+    }
+
+    manageResidency();
+    streamer.update(uploadBudget);
+
+    // Requirements made from now on belong to the next frame
+    frame++;
+}
+
+size_t TextureCache::collect(void)
+{
+    size_t freed = 0;
+
+    for (std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>>::iterator it = byContent.begin(); it != byContent.end();) {
+        TextureEntry* entry = it->second.get();
+        if (entry->references.load() > 0 || entry->busy) { ++it; continue; } // A worker or the streamer may still write to a busy one
+
+        for (size_t i = 0; i < entry->paths.size(); i++) byPath.erase(entry->paths[i]);
+        it = byContent.erase(it); // The GL texture goes to the deletion queue
+        freed++;
+    }
+
+    return freed;
+}
+
+size_t TextureCache::getResidentBytes(void) const
+{
+    size_t bytes = 0;
+    for (std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>>::const_iterator it = byContent.begin(); it != byContent.end(); ++it) bytes += it->second->bytes;
+    return bytes;
+}
+
+size_t TextureCache::getLoadingCount(void) const
+{
+    size_t count = 0;
+    for (std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>>::const_iterator it = byContent.begin(); it != byContent.end(); ++it) count += it->second->state == TEXTURE_LOADING;
+    return count;
+}
+
+size_t TextureCache::getBytesSaved(void) const
+{
+    size_t bytes = 0;
+    for (std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>>::const_iterator it = byContent.begin(); it != byContent.end(); ++it) bytes += it->second->bytes * (it->second->paths.size() - 1);
+    return bytes;
+}
+
+void TextureCache::report(void) const
+{
+    std::cout << "Texture cache: " << byContent.size() << " textures (" << getResidentBytes() / (1024.0 * 1024.0) << " MB) from " << decoded << " decoded and " << cookedLoads << " cooked files (" << cooked << " cooked now), "
+        << pathHits << " path hits, " << contentHits << " shared duplicates saving " << getBytesSaved() / (1024.0 * 1024.0) << " MB, " << getLoadingCount() << " still loading" << std::endl;
+}
+
+std::vector<TextureResidency> TextureCache::getResidency(void) const
+{
+    std::vector<TextureResidency> residency;
+    for (std::unordered_map<uint64_t, std::unique_ptr<TextureEntry>>::const_iterator it = byContent.begin(); it != byContent.end(); ++it) {
+        const TextureEntry& entry = *it->second;
+        if (entry.state != TEXTURE_RESIDENT) continue;
+
+        TextureResidency texture;
+        texture.path = entry.paths.front();
+        texture.width = entry.width;
+        texture.height = entry.height;
+        texture.levels = (unsigned int)entry.levelBytes.size();
+        texture.residentLevel = entry.residentLevel;
+        texture.neededLevel = neededLevel(entry);
+        texture.bytes = entry.bytes;
+        texture.fullBytes = chainBytes(entry, 0);
+        texture.framesUnused = frame - 1 - std::min(entry.lastUsed, frame - 1);
+        residency.push_back(texture);
+    }
+
+    std::sort(residency.begin(), residency.end(), [](const TextureResidency& a, const TextureResidency& b) { return a.bytes > b.bytes; });
+    return residency;
+}
+
+void TextureCache::reportResidency(void) const
+{
+    const std::vector<TextureResidency> residency = getResidency();
+
+    std::cout << "Texture residency: " << getResidentBytes() / (1024.0 * 1024.0) << " of " << memoryBudget / (1024.0 * 1024.0) << " MB budget" << std::endl;
+    for (size_t i = 0; i < residency.size(); i++) {
+        const TextureResidency& texture = residency[i];
+        std::cout << "  " << std::setw(8) << std::setprecision(3) << texture.bytes / (1024.0 * 1024.0) << " MB of " << std::setw(8) << texture.fullBytes / (1024.0 * 1024.0) << " MB, level "
+            << texture.residentLevel << " (" << std::max(1u, texture.width >> texture.residentLevel) << "x" << std::max(1u, texture.height >> texture.residentLevel) << ") of " << texture.levels
+            << ", needs " << texture.neededLevel << ", unused for " << texture.framesUnused << " frames: " << texture.path << std::endl;
+    }
+}
+
+#endif /* TEXTURE_CACHE_HEADER */
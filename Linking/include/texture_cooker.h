@@ -0,0 +1,531 @@
+/* Filename: texture_cooker.h */
+
+#ifndef TEXTURE_COOKER_HEADER
+#define TEXTURE_COOKER_HEADER
+
+#include <glad/glad.h>
+
+#include <content_hash.h>
+#include <mapped_file.h>
+#include <pixel_convert.h>
+#include <stb_image.h>
+#include <thread_pool.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// S3TC is an extension, not core: the loader does not define its formats
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+/* Bumped whenever the encoders or the file layout change, every cooked file then gets cooked again */
+#define COOKED_TEXTURE_VERSION 1
+
+/* The formats the cooker writes. BC1: RGB, 8 bytes per 4x4 block. BC3: BC1 plus a BC4 alpha block, 16 bytes. BC5: two BC4
+   channels (red and green), 16 bytes. RGBA8: not compressed, for channels too unrelated to share a block's endpoints */
+enum CookedFormat { COOKED_BC1 = 1, COOKED_BC3 = 3, COOKED_BC5 = 5, COOKED_RGBA8 = 8 };
+
+/* How a source image gets cooked. Part of the cache key, so changing a setting cooks the texture again */
+typedef struct TextureCookSettings {
+    bool flipVertically = true;         // Bottom row first, the way stb_image hands the textures to GL everywhere else
+    unsigned int width = 0, height = 0; // Size the image is resampled to before anything else, 0 keeps its own
+    int format = 0;                     // CookedFormat every image gets, 0 picks one from the pixels
+
+    uint32_t key(void) const
+    {
+        const uint32_t fields[5] = { COOKED_TEXTURE_VERSION, flipVertically ? 1u : 0u, width, height, (uint32_t)format };
+        const uint64_t hash = contentHash(fields, sizeof(fields));
+        return (uint32_t)(hash ^ (hash >> 32));
+    }
+} TextureCookSettings;
+
+/* Start of a cooked texture file. The CookedLevels follow, then the blocks of every level, largest first */
+typedef struct CookedTextureHeader {
+    char magic[4];           // "CTEX"
+    uint32_t version;
+    uint64_t sourceHash;     // contentHash of the source image file
+    uint32_t settingsKey;
+    uint32_t format;         // CookedFormat
+    uint32_t width, height;
+    uint32_t levelCount;
+    uint32_t sourceChannels;
+} CookedTextureHeader;
+
+typedef struct CookedLevel {
+    uint32_t width, height;
+    uint64_t offset, size;   // Of the level's blocks, from the start of the file
+} CookedLevel;
+
+/* What cooking one texture did */
+typedef struct CookedTextureStats {
+    CookedFormat format = COOKED_BC1;
+    unsigned int width = 0, height = 0, levels = 0;
+    size_t uncompressedBytes = 0; // What the texture took in video memory uncompressed, mipmaps included
+    size_t cookedBytes = 0;
+} CookedTextureStats;
+
+/* The images whose luminance goes into the channels of a packed texture */
+typedef struct PackedChannel {
+    std::string path;    // Empty leaves the channel at 0
+    bool invert = false; // Packs 255 minus the luminance (a mask that marks the other side)
+} PackedChannel;
+
+typedef struct PackedTextureSources {
+    PackedChannel channels[4]; // Red, green, blue, alpha
+} PackedTextureSources;
+
+/* The GL internal format of a cooked format */
+GLenum cookedInternalFormat(const CookedFormat format)
+{
+    if (format == COOKED_RGBA8) return GL_RGBA8;
+    if (format == COOKED_BC5) return GL_COMPRESSED_RG_RGTC2;
+    return format == COOKED_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+bool cookedFormatCompressed(const CookedFormat format) { return format != COOKED_RGBA8; }
+
+unsigned int cookedBlockBytes(const CookedFormat format) { return format == COOKED_BC1 ? 8 : 16; }
+
+/* Bytes of one mip level of a cooked format */
+size_t cookedLevelBytes(const CookedFormat format, const unsigned int width, const unsigned int height)
+{
+    if (!cookedFormatCompressed(format)) return (size_t)width * height * 4;
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * cookedBlockBytes(format);
+}
+
+const char* cookedFormatName(const CookedFormat format)
+{
+    switch (format) {
+    case COOKED_BC1: return "BC1";
+    case COOKED_BC3: return "BC3";
+    case COOKED_BC5: return "BC5";
+    default: return "RGBA8";
+    }
+}
+
+/* Where the cooked file of a source image lives in a cache directory: named after its content hash and settings key */
+std::string cookedTexturePath(const std::string& directory, const uint64_t sourceHash, const TextureCookSettings& settings)
+{
+    std::ostringstream name;
+    name << std::hex << std::setfill('0') << std::setw(16) << sourceHash << '-' << std::setw(8) << settings.key() << ".ctex";
+    return (std::filesystem::path(directory) / name.str()).generic_string();
+}
+
+/* Whether the GL context can sample a cooked format (RGTC is core, S3TC almost always there but an extension) */
+bool cookedFormatSupported(const CookedFormat format)
+{
+    if (format == COOKED_BC5 || format == COOKED_RGBA8) return true;
+
+    static int s3tc = -1;
+    if (s3tc < 0) {
+        s3tc = 0;
+        GLint extensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+        for (GLint i = 0; i < extensions && !s3tc; i++) {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, (GLuint)i));
+            s3tc = name != NULL && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0;
+        }
+    }
+
+    return s3tc == 1;
+}
+
+/* RGB 5:6:5 endpoints, and back with the bits replicated the way the GPU expands them */
+static inline uint16_t packRGB565(const glm::vec3& color)
+{
+    const glm::vec3 c = glm::clamp(color, 0.0f, 255.0f);
+    return (uint16_t)(((unsigned int)(c.r * 31.0f / 255.0f + 0.5f) << 11) | ((unsigned int)(c.g * 63.0f / 255.0f + 0.5f) << 5) | (unsigned int)(c.b * 31.0f / 255.0f + 0.5f));
+}
+
+static inline glm::vec3 unpackRGB565(const uint16_t packed)
+{
+    const unsigned int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    return glm::vec3((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)));
+}
+
+/* Encodes a 4x4 block of RGBA pixels (row by row) as BC1, always in four colour mode. The endpoints span the block's colours
+   along their principal axis (found by power iteration on the covariance), each pixel then takes the closest of the four */
+static void encodeBC1Block(const uint8_t* pixels, uint8_t* block)
+{
+    glm::vec3 colors[16], mean(0.0f);
+    for (unsigned int i = 0; i < 16; i++) { colors[i] = glm::vec3(pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2]); mean += colors[i]; }
+    mean /= 16.0f;
+
+    glm::mat3 covariance(0.0f);
+    for (unsigned int i = 0; i < 16; i++) { const glm::vec3 d = colors[i] - mean; covariance += glm::outerProduct(d, d); }
+
+    glm::vec3 axis(1.0f, 1.0f, 1.0f);
+    for (unsigned int iteration = 0; iteration < 8; iteration++) {
+        const glm::vec3 next = covariance * axis;
+        const float length = glm::length(next);
+        if (length < 1e-6f) break;
+        axis = next / length;
+    }
+    axis = glm::normalize(axis);
+
+    float low = 0.0f, high = 0.0f;
+    for (unsigned int i = 0; i < 16; i++) {
+        const float t = glm::dot(colors[i] - mean, axis);
+        low = std::min(low, t); high = std::max(high, t);
+    }
+
+    uint16_t color0 = packRGB565(mean + axis * high), color1 = packRGB565(mean + axis * low);
+    if (color0 < color1) std::swap(color0, color1);
+
+    // Equal endpoints would switch the block to three colour mode, whose last entry is black: every pixel takes endpoint 0 instead
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        const glm::vec3 end0 = unpackRGB565(color0), end1 = unpackRGB565(color1);
+        const glm::vec3 palette[4] = { end0, end1, (2.0f * end0 + end1) / 3.0f, (end0 + 2.0f * end1) / 3.0f };
+
+        for (unsigned int i = 0; i < 16; i++) {
+            unsigned int best = 0;
+            float bestDistance = 1e30f;
+            for (unsigned int p = 0; p < 4; p++) {
+                const glm::vec3 d = colors[i] - palette[p];
+                const float distance = glm::dot(d, d);
+                if (distance < bestDistance) { bestDistance = distance; best = p; }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+
+    block[0] = (uint8_t)color0; block[1] = (uint8_t)(color0 >> 8);
+    block[2] = (uint8_t)color1; block[3] = (uint8_t)(color1 >> 8);
+    for (unsigned int b = 0; b < 4; b++) block[4 + b] = (uint8_t)(indices >> (8 * b));
+}
+
+/* Encodes 16 single channel values as a BC4 block, in eight value mode between the block's extremes */
+static void encodeBC4Block(const uint8_t* values, uint8_t* block)
+{
+    uint8_t high = values[0], low = values[0];
+    for (unsigned int i = 1; i < 16; i++) { high = std::max(high, values[i]); low = std::min(low, values[i]); }
+
+    block[0] = high;
+    block[1] = low;
+
+    // Codes 0 and 1 are the extremes, codes 2 to 7 the six steps between them from high to low
+    uint64_t indices = 0;
+    if (high != low) {
+        const float scale = 7.0f / (float)(high - low);
+        for (unsigned int i = 0; i < 16; i++) {
+            const unsigned int step = (unsigned int)((high - values[i]) * scale + 0.5f);
+            const unsigned int code = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+            indices |= (uint64_t)code << (3 * i);
+        }
+    }
+
+    for (unsigned int b = 0; b < 6; b++) block[2 + b] = (uint8_t)(indices >> (8 * b));
+}
+
+/* Encodes one mip level, block rows spread over the thread pool. Blocks past the edge of the image repeat its last pixels */
+static void encodeLevel(const std::vector<uint8_t>& rgba, const unsigned int width, const unsigned int height, const CookedFormat format, uint8_t* output)
+{
+    if (!cookedFormatCompressed(format)) { std::memcpy(output, rgba.data(), (size_t)width * height * 4); return; }
+
+    const unsigned int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4, blockBytes = cookedBlockBytes(format);
+
+    ThreadPool::global().parallelFor(blocksHigh, 8, [&](size_t begin, size_t end) {
+        uint8_t pixels[64], channel[16];
+
+        for (size_t by = begin; by < end; by++)
+            for (unsigned int bx = 0; bx < blocksWide; bx++) {
+                for (unsigned int i = 0; i < 16; i++) {
+                    const unsigned int x = std::min(bx * 4 + (i & 3), width - 1), y = std::min((unsigned int)by * 4 + (i >> 2), height - 1);
+                    std::memcpy(pixels + i * 4, &rgba[((size_t)y * width + x) * 4], 4);
+                }
+
+                uint8_t* block = output + ((size_t)by * blocksWide + bx) * blockBytes;
+                if (format == COOKED_BC1) encodeBC1Block(pixels, block);
+                else if (format == COOKED_BC3) {
+                    for (unsigned int i = 0; i < 16; i++) channel[i] = pixels[i * 4 + 3];
+                    encodeBC4Block(channel, block);
+                    encodeBC1Block(pixels, block + 8);
+                }
+                else {
+                    for (unsigned int i = 0; i < 16; i++) channel[i] = pixels[i * 4];
+                    encodeBC4Block(channel, block);
+                    for (unsigned int i = 0; i < 16; i++) channel[i] = pixels[i * 4 + 1];
+                    encodeBC4Block(channel, block + 8);
+                }
+            }
+    });
+}
+
+/* Halves an RGBA level with a box filter, like glGenerateMipmap does */
+static void downsampleLevel(const std::vector<uint8_t>& source, const unsigned int width, const unsigned int height, std::vector<uint8_t>& target)
+{
+    const unsigned int targetWidth = std::max(1u, width / 2), targetHeight = std::max(1u, height / 2);
+    target.resize((size_t)targetWidth * targetHeight * 4);
+
+    for (unsigned int y = 0; y < targetHeight; y++)
+        for (unsigned int x = 0; x < targetWidth; x++) {
+            const unsigned int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            const unsigned int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+
+            for (unsigned int c = 0; c < 4; c++) {
+                const unsigned int sum = source[((size_t)y0 * width + x0) * 4 + c] + source[((size_t)y0 * width + x1) * 4 + c] + source[((size_t)y1 * width + x0) * 4 + c] + source[((size_t)y1 * width + x1) * 4 + c];
+                target[((size_t)y * targetWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+}
+
+/* Resamples an RGBA image to another size with a bilinear filter between the pixel centers. Meant for sizes close to the source,
+   like evening out the layers of a texture array: shrinking far below it would skip pixels */
+static void resampleImage(const std::vector<uint8_t>& source, const unsigned int width, const unsigned int height, std::vector<uint8_t>& target, const unsigned int targetWidth, const unsigned int targetHeight)
+{
+    target.resize((size_t)targetWidth * targetHeight * 4);
+    const float scaleX = (float)width / targetWidth, scaleY = (float)height / targetHeight;
+
+    ThreadPool::global().parallelFor(targetHeight, 64, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            const float sy = glm::clamp(((float)y + 0.5f) * scaleY - 0.5f, 0.0f, (float)(height - 1));
+            const unsigned int y0 = (unsigned int)sy, y1 = std::min(y0 + 1, height - 1);
+            const float fy = sy - (float)y0;
+
+            for (unsigned int x = 0; x < targetWidth; x++) {
+                const float sx = glm::clamp(((float)x + 0.5f) * scaleX - 0.5f, 0.0f, (float)(width - 1));
+                const unsigned int x0 = (unsigned int)sx, x1 = std::min(x0 + 1, width - 1);
+                const float fx = sx - (float)x0;
+
+                for (unsigned int c = 0; c < 4; c++) {
+                    const float top = glm::mix((float)source[((size_t)y0 * width + x0) * 4 + c], (float)source[((size_t)y0 * width + x1) * 4 + c], fx);
+                    const float bottom = glm::mix((float)source[((size_t)y1 * width + x0) * 4 + c], (float)source[((size_t)y1 * width + x1) * 4 + c], fx);
+                    target[(y * targetWidth + x) * 4 + c] = (uint8_t)(glm::mix(top, bottom, fy) + 0.5f);
+                }
+            }
+        }
+    });
+}
+
+/* Decodes an encoded image to RGBA the way the settings ask for it: flipped, and resampled when they give a size. The channels
+   are those of the source file. Returns false if the image cannot be decoded */
+bool decodeTexture(const unsigned char* source, const size_t size, const TextureCookSettings& settings, std::vector<uint8_t>& rgba, unsigned int& width, unsigned int& height, int& channels)
+{
+    // stb_image's JPEG decoder writes RGBA straight out of its color conversion. Everything else decodes to its own channels,
+    // which the SIMD conversion expands and flips in the same pass as the copy out of stb_image's buffer
+    const bool jpeg = size >= 2 && source[0] == 0xFF && source[1] == 0xD8;
+    // Only this thread's flag, and it stays set (stb_image cannot hand a thread back to the global one): anything else that loads
+    // images on the thread pool sets its own
+    stbi_set_flip_vertically_on_load_thread(0);
+    int decodedWidth, decodedHeight;
+    unsigned char* decoded = stbi_load_from_memory(source, (int)size, &decodedWidth, &decodedHeight, &channels, jpeg ? 4 : 0);
+    if (!decoded) return false;
+
+    width = (unsigned int)decodedWidth;
+    height = (unsigned int)decodedHeight;
+    rgba.resize((size_t)width * height * 4);
+    convertToRGBA(decoded, width, height, jpeg ? 4 : channels, settings.flipVertically, rgba.data());
+    stbi_image_free(decoded);
+
+    if (settings.width > 0 && settings.height > 0 && (settings.width != width || settings.height != height)) {
+        std::vector<uint8_t> resampled;
+        resampleImage(rgba, width, height, resampled, settings.width, settings.height);
+        rgba.swap(resampled);
+        width = settings.width;
+        height = settings.height;
+    }
+    return true;
+}
+
+/* Maps the sources of a packed texture (a channel without a path has none) and hashes them together with the way each one is
+   packed, which makes the packed texture's source hash. False if a source cannot be read */
+bool openPackedSources(const PackedTextureSources& sources, MappedFile files[4], uint64_t& hash)
+{
+    uint64_t keys[8];
+    for (unsigned int c = 0; c < 4; c++) {
+        const PackedChannel& channel = sources.channels[c];
+        if (!channel.path.empty() && !files[c].open(channel.path)) return false;
+        keys[2 * c] = channel.path.empty() ? 0 : contentHash(files[c].getData(), files[c].getSize());
+        keys[2 * c + 1] = channel.invert ? 1 : 0;
+    }
+    hash = contentHash(keys, sizeof(keys));
+    return true;
+}
+
+/* Packs the luminance of each source into one channel of an RGBA image. The sources are resampled to the size the settings give,
+   or to the first one's. Returns false if no channel has a source or one cannot be decoded */
+bool packTextureChannels(const PackedTextureSources& sources, const MappedFile files[4], const TextureCookSettings& settings, std::vector<uint8_t>& rgba, unsigned int& width, unsigned int& height)
+{
+    TextureCookSettings sized = settings;
+    rgba.clear();
+
+    std::vector<uint8_t> image;
+    unsigned int imageWidth, imageHeight;
+    int channels;
+    for (unsigned int c = 0; c < 4; c++) {
+        if (sources.channels[c].path.empty()) continue;
+        if (!decodeTexture(files[c].getData(), files[c].getSize(), sized, image, imageWidth, imageHeight, channels)) return false;
+
+        if (rgba.empty()) {
+            width = sized.width = imageWidth;
+            height = sized.height = imageHeight;
+            rgba.assign((size_t)width * height * 4, 0);
+        }
+
+        // Rec. 709 weights in 8 bit fixed point, gray stays exactly gray
+        const uint8_t flip = sources.channels[c].invert ? 255 : 0;
+        for (size_t i = 0; i < (size_t)width * height; i++) {
+            const unsigned int luminance = (54u * image[i * 4] + 183u * image[i * 4 + 1] + 19u * image[i * 4 + 2] + 128u) >> 8;
+            rgba[i * 4 + c] = (uint8_t)luminance ^ flip;
+        }
+    }
+    return !rgba.empty();
+}
+
+/* Cooks an RGBA image (with the number of channels its source had) into a cooked texture file with its whole mip chain. Unless
+   the settings force a format: BC5 for grayscale images (gray in red, alpha or nothing in green), BC3 when some pixel is not
+   opaque, BC1 otherwise. The file is written next to its final name first and renamed, so a crash never leaves half a file
+   behind. Returns false if it cannot be written */
+bool cookImage(std::vector<uint8_t>& level, const unsigned int width, const unsigned int height, const int channels, const uint64_t sourceHash, const TextureCookSettings& settings, const std::string& outputPath, CookedTextureStats* stats = NULL)
+{
+    CookedFormat format = COOKED_BC1;
+    if (settings.format != 0) format = (CookedFormat)settings.format;
+    else if (channels <= 2) format = COOKED_BC5;
+    else if (channels == 4) {
+        for (size_t i = 3; i < level.size() && format == COOKED_BC1; i += 4)
+            if (level[i] != 255) format = COOKED_BC3;
+    }
+    if (format == COOKED_BC5)
+        for (size_t i = 0; i < level.size(); i += 4) level[i + 1] = channels == 2 ? level[i + 3] : 0;
+
+    // Every level down to 1x1
+    unsigned int levelCount = 1;
+    while ((std::max(width, height) >> levelCount) > 0) levelCount++;
+
+    std::vector<CookedLevel> levels(levelCount);
+    size_t offset = sizeof(CookedTextureHeader) + levelCount * sizeof(CookedLevel);
+    for (unsigned int l = 0; l < levelCount; l++) {
+        levels[l].width = std::max(1u, width >> l);
+        levels[l].height = std::max(1u, height >> l);
+        levels[l].offset = offset;
+        levels[l].size = (uint64_t)cookedLevelBytes(format, levels[l].width, levels[l].height);
+        offset += (size_t)levels[l].size;
+    }
+
+    std::vector<unsigned char> file(offset);
+    CookedTextureHeader header;
+    std::memcpy(header.magic, "CTEX", 4);
+    header.version = COOKED_TEXTURE_VERSION;
+    header.sourceHash = sourceHash;
+    header.settingsKey = settings.key();
+    header.format = format;
+    header.width = width;
+    header.height = height;
+    header.levelCount = levelCount;
+    header.sourceChannels = (uint32_t)channels;
+    std::memcpy(file.data(), &header, sizeof(header));
+    std::memcpy(file.data() + sizeof(header), levels.data(), levelCount * sizeof(CookedLevel));
+
+    std::vector<uint8_t> smaller;
+    for (unsigned int l = 0; l < levelCount; l++) {
+        encodeLevel(level, levels[l].width, levels[l].height, format, file.data() + levels[l].offset);
+        if (l + 1 < levelCount) {
+            downsampleLevel(level, levels[l].width, levels[l].height, smaller);
+            level.swap(smaller);
+        }
+    }
+
+    std::error_code error;
+    const std::filesystem::path target(outputPath);
+    if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), error);
+
+    const std::string temporary = outputPath + ".tmp";
+    {
+        std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+        if (!output.write(reinterpret_cast<const char*>(file.data()), (std::streamsize)file.size())) return false;
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) { std::filesystem::remove(temporary, error); return false; }
+
+    if (stats != NULL) {
+        stats->format = format;
+        stats->width = width;
+        stats->height = height;
+        stats->levels = levelCount;
+        stats->uncompressedBytes = (size_t)width * height * (channels == 2 ? 4 : channels) * 4 / 3;
+        stats->cookedBytes = offset - levels[0].offset;
+    }
+    return true;
+}
+
+/* Cooks an encoded image (PNG, JPG...), see cookImage. Returns false if the image cannot be decoded or written */
+bool cookTexture(const unsigned char* source, const size_t size, const uint64_t sourceHash, const TextureCookSettings& settings, const std::string& outputPath, CookedTextureStats* stats = NULL)
+{
+    std::vector<uint8_t> level;
+    unsigned int width, height;
+    int channels;
+    if (!decodeTexture(source, size, settings, level, width, height, channels)) return false;
+    return cookImage(level, width, height, channels, sourceHash, settings, outputPath, stats);
+}
+
+/* Cooked Texture Class. A cooked texture file mapped into memory, its mip levels go to the GPU straight from the mapping */
+class CookedTexture {
+private:
+    MappedFile file;
+    CookedTextureHeader header;
+    const CookedLevel* levels;
+
+public:
+    CookedTexture(void) : levels(NULL) { std::memset(&header, 0, sizeof(header)); }
+
+    bool open(const std::string& path, const uint64_t sourceHash, const TextureCookSettings& settings); // Maps the file, false if it is missing, damaged or stale
+
+    CookedFormat getFormat(void) const { return (CookedFormat)header.format; }
+    size_t getVideoBytes(void) const;
+    void getSwizzle(GLint swizzle[4]) const; // How the texture has to be sampled to give back the source's channels
+
+    unsigned int getLevelCount(void) const { return levels != NULL ? header.levelCount : 0; }
+    const CookedLevel& getLevel(const unsigned int level) const { return levels[level]; }
+    const unsigned char* getLevelData(const unsigned int level) const { return file.getData() + levels[level].offset; }
+};
+
+bool CookedTexture::open(const std::string& path, const uint64_t sourceHash, const TextureCookSettings& settings)
+{
+    levels = NULL;
+    if (!file.open(path) || file.getSize() < sizeof(CookedTextureHeader)) { file.close(); return false; }
+
+    std::memcpy(&header, file.getData(), sizeof(header));
+    const bool current = std::memcmp(header.magic, "CTEX", 4) == 0 && header.version == COOKED_TEXTURE_VERSION && header.sourceHash == sourceHash && header.settingsKey == settings.key();
+    const bool knownFormat = header.format == COOKED_BC1 || header.format == COOKED_BC3 || header.format == COOKED_BC5 || header.format == COOKED_RGBA8;
+    if (!current || !knownFormat || header.levelCount == 0 || header.levelCount > 32 || sizeof(header) + header.levelCount * sizeof(CookedLevel) > file.getSize()) { file.close(); return false; }
+
+    levels = reinterpret_cast<const CookedLevel*>(file.getData() + sizeof(header));
+    for (uint32_t l = 0; l < header.levelCount; l++)
+        if (levels[l].offset > file.getSize() || levels[l].size > file.getSize() - levels[l].offset || levels[l].size != cookedLevelBytes(getFormat(), levels[l].width, levels[l].height)) { file.close(); levels = NULL; return false; }
+
+    return true;
+}
+
+size_t CookedTexture::getVideoBytes(void) const
+{
+    size_t bytes = 0;
+    for (uint32_t l = 0; levels != NULL && l < header.levelCount; l++) bytes += (size_t)levels[l].size;
+    return bytes;
+}
+
+void CookedTexture::getSwizzle(GLint swizzle[4]) const
+{
+    // A grayscale image samples as gray again, its alpha (if it had one) back in alpha
+    const bool gray = getFormat() == COOKED_BC5;
+    swizzle[0] = GL_RED;
+    swizzle[1] = gray ? GL_RED : GL_GREEN;
+    swizzle[2] = gray ? GL_RED : GL_BLUE;
+    swizzle[3] = !gray ? GL_ALPHA : header.sourceChannels == 2 ? GL_GREEN : GL_ONE;
+}
+
+#endif /* TEXTURE_COOKER_HEADER */
@@ -0,0 +1,274 @@
+/* Filename: texture_streamer.h */
+
+#ifndef TEXTURE_STREAMER_HEADER
+#define TEXTURE_STREAMER_HEADER
+
+#include <glad/glad.h>
+
+#include <gl_resource.h>
+#include <mapped_file.h>
+#include <texture_cooker.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* One mip level of a texture on its way to the GPU */
+typedef struct TextureLevelData {
+    unsigned int width, height;
+    const unsigned char* data;
+    size_t size;
+} TextureLevelData;
+
+/* A texture a worker thread decoded (or cooked), with every mip level ready to upload */
+typedef struct TexturePayload {
+    bool compressed = false;
+    bool cookedNow = false;                                  // The cooked file did not exist (or was stale) and got made for this load
+    GLenum internalFormat = GL_RGBA8;
+    GLint swizzle[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+    std::vector<TextureLevelData> levels;                    // Largest first
+    CookedTexture cooked;                                    // The mapping compressed levels point into
+    std::vector<std::vector<uint8_t>> pixels;                // The memory uncompressed levels point into
+} TexturePayload;
+
+/* Points a payload at the levels of its cooked texture if the GL context can sample their format, reading every page on the way
+   so the copies on the GL thread never wait for the disk */
+static bool takeCookedLevels(TexturePayload& payload, const bool s3tcSupported)
+{
+    const CookedFormat format = payload.cooked.getFormat();
+    if (format != COOKED_BC5 && format != COOKED_RGBA8 && !s3tcSupported) return false;
+
+    payload.compressed = cookedFormatCompressed(format);
+    payload.internalFormat = cookedInternalFormat(format);
+    payload.cooked.getSwizzle(payload.swizzle);
+
+    for (unsigned int l = 0; l < payload.cooked.getLevelCount(); l++) {
+        const CookedLevel& level = payload.cooked.getLevel(l);
+        const TextureLevelData data = { level.width, level.height, payload.cooked.getLevelData(l), (size_t)level.size };
+        payload.levels.push_back(data);
+
+        volatile unsigned char sink = 0;
+        for (size_t offset = 0; offset < data.size; offset += 4096) sink ^= data.data[offset];
+    }
+    return true;
+}
+
+/* Gives a payload an RGBA image and the mip chain the cooker's box filter makes of it, so the GL thread never runs glGenerateMipmap */
+static void takeImageLevels(TexturePayload& payload, std::vector<uint8_t>& rgba, const unsigned int width, const unsigned int height)
+{
+    payload.pixels.push_back(std::move(rgba));
+
+    unsigned int levelWidth = width, levelHeight = height;
+    while (levelWidth > 1 || levelHeight > 1) {
+        std::vector<uint8_t> smaller;
+        downsampleLevel(payload.pixels.back(), levelWidth, levelHeight, smaller);
+        payload.pixels.push_back(std::move(smaller));
+        levelWidth = std::max(1u, levelWidth / 2);
+        levelHeight = std::max(1u, levelHeight / 2);
+    }
+
+    for (size_t l = 0; l < payload.pixels.size(); l++) {
+        const TextureLevelData data = { std::max(1u, width >> l), std::max(1u, height >> l), payload.pixels[l].data(), payload.pixels[l].size() };
+        payload.levels.push_back(data);
+    }
+}
+
+/* Prepares a texture on a worker thread. With a cooked directory it is the cooked version (cooked first if needed), as long as
+   the GL context can sample its format. Otherwise the image is decoded to RGBA, resampled if the settings give a size, and its
+   mip chain built on the CPU. Returns NULL if the image cannot be decoded */
+std::unique_ptr<TexturePayload> prepareTexture(const MappedFile& source, const uint64_t hash, const std::string& cookedDirectory, const TextureCookSettings& settings, const bool s3tcSupported)
+{
+    std::unique_ptr<TexturePayload> payload(new TexturePayload());
+
+    if (!cookedDirectory.empty()) {
+        const std::string path = cookedTexturePath(cookedDirectory, hash, settings);
+        bool ready = payload->cooked.open(path, hash, settings);
+        if (!ready && cookTexture(source.getData(), source.getSize(), hash, settings, path)) ready = payload->cookedNow = payload->cooked.open(path, hash, settings);
+        if (ready && takeCookedLevels(*payload, s3tcSupported)) return payload;
+    }
+
+    std::vector<uint8_t> rgba;
+    unsigned int width, height;
+    int channels;
+    if (!decodeTexture(source.getData(), source.getSize(), settings, rgba, width, height, channels)) return NULL;
+    takeImageLevels(*payload, rgba, width, height);
+    return payload;
+}
+
+/* Prepares a packed texture on a worker thread, the way prepareTexture does a plain one: cooked once into the directory (when
+   there is one), packed from its sources on every load otherwise. Returns NULL if a source cannot be read or decoded */
+std::unique_ptr<TexturePayload> preparePackedTexture(const PackedTextureSources& sources, const std::string& cookedDirectory, const TextureCookSettings& settings, const bool s3tcSupported)
+{
+    std::unique_ptr<TexturePayload> payload(new TexturePayload());
+
+    MappedFile files[4];
+    uint64_t hash;
+    if (!openPackedSources(sources, files, hash)) return NULL;
+
+    std::vector<uint8_t> rgba;
+    unsigned int width, height;
+    bool packed = false;
+    if (!cookedDirectory.empty()) {
+        const std::string path = cookedTexturePath(cookedDirectory, hash, settings);
+        bool ready = payload->cooked.open(path, hash, settings);
+        if (!ready && (packed = packTextureChannels(sources, files, settings, rgba, width, height))) {
+            std::vector<uint8_t> level = rgba;
+            if (cookImage(level, width, height, 4, hash, settings, path)) ready = payload->cookedNow = payload->cooked.open(path, hash, settings);
+        }
+        if (ready && takeCookedLevels(*payload, s3tcSupported)) return payload;
+    }
+
+    if (!packed && !packTextureChannels(sources, files, settings, rgba, width, height)) return NULL;
+    takeImageLevels(*payload, rgba, width, height);
+    return payload;
+}
+
+/* Texture Streamer Class. Uploads prepared textures a few rows at a time, through a ring of pixel buffer objects, so no frame
+   spends more than its byte budget on uploads. Each texture goes smallest mip level first and its base level follows the upload:
+   it is sampled blurry at first, sharper with every level, and never shows a level that is not there yet. An upload may stop
+   short of the finest levels, the coarsest one it keeps then becomes level 0 of the GL texture. Only use it on the GL thread */
+class TextureStreamer {
+private:
+    typedef struct Upload {
+        GLuint texture;
+        std::unique_ptr<TexturePayload> payload;
+        bool started;                       // The texture got its storage
+        int firstLevel;                     // Finest level of the payload that goes to the GPU, it becomes GL level 0
+        int level;                          // Level of the payload being uploaded, firstLevel - 1 once they are all in
+        unsigned int row;                   // Next row of that level (row of blocks when compressed)
+        std::function<void(size_t)> done;   // Called with the texture's video memory once every level is in
+    } Upload;
+
+    std::deque<Upload> queue;
+    std::vector<GLBuffer> buffers;
+    size_t bufferSize;
+    unsigned int nextBuffer;
+    size_t uploadedBytes;
+
+    void begin(Upload& upload);                            // Gives the texture storage for every level
+    size_t uploadBand(Upload& upload, const size_t budget); // Copies the next rows of the current level through a buffer, returns the bytes
+
+public:
+    TextureStreamer(const unsigned int bufferCount = 4, const size_t bufferSize = 1 << 20) : buffers(bufferCount), bufferSize(bufferSize), nextBuffer(0), uploadedBytes(0) {}
+
+    void enqueue(const GLuint texture, std::unique_ptr<TexturePayload> payload, const unsigned int firstLevel, std::function<void(size_t)> done);
+    size_t update(const size_t budget); // Uploads up to budget bytes (at least one band, so big rows still get through), returns how many
+
+    size_t getQueuedCount(void) const { return queue.size(); }
+    size_t getUploadedBytes(void) const { return uploadedBytes; }
+};
+
+void TextureStreamer::enqueue(const GLuint texture, std::unique_ptr<TexturePayload> payload, const unsigned int firstLevel, std::function<void(size_t)> done)
+{
+    Upload upload;
+    upload.texture = texture;
+    upload.firstLevel = (int)std::min<size_t>(firstLevel, payload->levels.size() - 1);
+    upload.payload = std::move(payload);
+    upload.started = false;
+    upload.level = 0;
+    upload.row = 0;
+    upload.done = std::move(done);
+    queue.push_back(std::move(upload));
+}
+
+void TextureStreamer::begin(Upload& upload)
+{
+    const TexturePayload& payload = *upload.payload;
+    const GLint levelCount = (GLint)payload.levels.size() - upload.firstLevel;
+
+    glBindTexture(GL_TEXTURE_2D, upload.texture);
+    for (GLint l = 0; l < levelCount; l++) {
+        const TextureLevelData& level = payload.levels[upload.firstLevel + l];
+        if (payload.compressed) glCompressedTexImage2D(GL_TEXTURE_2D, l, payload.internalFormat, (GLsizei)level.width, (GLsizei)level.height, 0, (GLsizei)level.size, NULL);
+        else glTexImage2D(GL_TEXTURE_2D, l, payload.internalFormat, (GLsizei)level.width, (GLsizei)level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, payload.swizzle);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    upload.started = true;
+    upload.level = (int)payload.levels.size() - 1;
+    upload.row = 0;
+}
+
+size_t TextureStreamer::uploadBand(Upload& upload, const size_t budget)
+{
+    const TexturePayload& payload = *upload.payload;
+    const TextureLevelData& level = payload.levels[upload.level];
+    const GLint target = upload.level - upload.firstLevel;
+
+    // Rows of pixels, or of 4x4 blocks
+    const unsigned int rows = payload.compressed ? (level.height + 3) / 4 : level.height;
+    const size_t rowBytes = level.size / rows;
+    const unsigned int bandRows = (unsigned int)std::max<size_t>(1, std::min<size_t>(rows - upload.row, std::min(budget, bufferSize) / rowBytes));
+    const size_t bandBytes = bandRows * rowBytes;
+
+    // Orphaning the buffer: a draw or copy still reading its old contents keeps them, the map never waits
+    GLBuffer& buffer = buffers[nextBuffer];
+    nextBuffer = (nextBuffer + 1) % buffers.size();
+    if (!buffer) buffer = GLBuffer::generate();
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.get());
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)std::max(bandBytes, bufferSize), NULL, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bandBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped != NULL) {
+        std::memcpy(mapped, level.data + upload.row * rowBytes, bandBytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        glBindTexture(GL_TEXTURE_2D, upload.texture);
+        if (payload.compressed) {
+            const GLint y = (GLint)upload.row * 4;
+            const GLsizei height = std::min((GLsizei)bandRows * 4, (GLsizei)level.height - y);
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, target, 0, y, (GLsizei)level.width, height, payload.internalFormat, (GLsizei)bandBytes, NULL);
+        }
+        else glTexSubImage2D(GL_TEXTURE_2D, target, 0, (GLint)upload.row, (GLsizei)level.width, (GLsizei)bandRows, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    else std::cout << "ERROR::TEXTURE_STREAMER:: cannot map a pixel buffer, texture " << upload.texture << " level " << upload.level << " stays undefined" << std::endl;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // A finished level becomes the sharpest one sampled
+    upload.row += bandRows;
+    if (upload.row == rows) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, target);
+        upload.level--;
+        upload.row = 0;
+    }
+
+    return bandBytes;
+}
+
+size_t TextureStreamer::update(const size_t budget)
+{
+    size_t uploaded = 0;
+
+    while (!queue.empty() && (uploaded == 0 || uploaded < budget)) {
+        Upload& upload = queue.front();
+        if (!upload.started) begin(upload);
+
+        uploaded += uploadBand(upload, budget > uploaded ? budget - uploaded : 0);
+
+        if (upload.level < upload.firstLevel) {
+            size_t bytes = 0;
+            for (size_t l = upload.firstLevel; l < upload.payload->levels.size(); l++) bytes += upload.payload->levels[l].size;
+            upload.done(bytes);
+            queue.pop_front();
+        }
+    }
+
+    uploadedBytes += uploaded;
+    return uploaded;
+}
+
+#endif /* TEXTURE_STREAMER_HEADER */
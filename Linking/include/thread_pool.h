@@ -0,0 +1,151 @@
+/* Filename: thread_pool.h */
+
+#ifndef THREAD_POOL_HEADER
+#define THREAD_POOL_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/* Thread Pool Class. A fixed set of worker threads that the whole application shares for parallel work */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void(void)>> jobs;
+    std::mutex jobsMutex;
+    std::condition_variable jobsAvailable;
+    bool stopping;
+
+    void workerLoop(void); // Pops and runs queued jobs until the pool is destroyed
+
+public:
+    ThreadPool(unsigned int threadCount = 0); // Constructor, 0 means one worker per hardware thread (minus the calling thread)
+    ~ThreadPool(void);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int size(void) const { return static_cast<unsigned int>(workers.size()); }
+
+    template <typename Function> auto submit(Function job) -> std::future<decltype(job())>; // Queues a job and returns a future for its result
+    template <typename Function> void parallelFor(size_t count, size_t grainSize, Function body);        // Calls body(begin, end) over [0, count) in chunks of at least grainSize
+
+    static ThreadPool& global(void); // The pool every subsystem uses unless it needs its own
+};
+
+ThreadPool::ThreadPool(unsigned int threadCount) : stopping(false)
+{
+    if (threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    jobsAvailable.notify_all();
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+void ThreadPool::workerLoop(void)
+{
+    while (true) {
+        std::function<void(void)> job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            jobsAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+            if (stopping && jobs.empty()) return;
+
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+        job();
+    }
+}
+
+template <typename Function>
+auto ThreadPool::submit(Function job) -> std::future<decltype(job())>
+{
+    typedef decltype(job()) Result;
+
+    // std::function needs a copyable target, so the packaged task lives behind a shared pointer
+    std::shared_ptr<std::packaged_task<Result()>> task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+    std::future<Result> result = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        jobs.push([task] { (*task)(); });
+    }
+    jobsAvailable.notify_one();
+
+    return result;
+}
+
+template <typename Function>
+void ThreadPool::parallelFor(size_t count, size_t grainSize, Function body)
+{
+    if (count == 0) return;
+    if (grainSize == 0) grainSize = 1;
+
+    const size_t chunks = (count + grainSize - 1) / grainSize;
+    if (chunks == 1 || workers.empty()) { body(static_cast<size_t>(0), count); return; }
+
+    // Chunks are claimed from a shared counter, so the calling thread works too and helpers that start late simply find nothing left.
+    // The caller only waits for claimed chunks to finish, never for helpers to start, which keeps nested calls from deadlocking.
+    struct SharedState {
+        std::atomic<size_t> nextChunk{ 0 };
+        std::atomic<size_t> finishedChunks{ 0 };
+        std::mutex doneMutex;
+        std::condition_variable done;
+    };
+    std::shared_ptr<SharedState> state = std::make_shared<SharedState>();
+
+    auto runChunks = [state, chunks, count, grainSize, &body](void) {
+        size_t chunk;
+        while ((chunk = state->nextChunk.fetch_add(1)) < chunks) {
+            const size_t begin = chunk * grainSize;
+            body(begin, std::min(begin + grainSize, count));
+
+            if (state->finishedChunks.fetch_add(1) + 1 == chunks) {
+                std::lock_guard<std::mutex> lock(state->doneMutex);
+                state->done.notify_all();
+            }
+        }
+    };
+
+    const size_t helpers = std::min(static_cast<size_t>(workers.size()), chunks - 1);
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        for (size_t i = 0; i < helpers; i++) jobs.push(runChunks);
+    }
+    jobsAvailable.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(state->doneMutex);
+    state->done.wait(lock, [&state, chunks] { return state->finishedChunks.load() == chunks; });
+}
+
+ThreadPool& ThreadPool::global(void)
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+#endif /* THREAD_POOL_HEADER */
@@ -0,0 +1,191 @@
+/* Filename: vertex_layout.h */
+
+#ifndef VERTEX_LAYOUT_HEADER
+#define VERTEX_LAYOUT_HEADER
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#define MAX_BONE_INFLUENCE 4
+
+/* Vertex Structure. The full vertex the importer fills, the GPU only gets the attributes of the mesh's VertexLayout */
+typedef struct Vertex {
+    glm::vec3 Position;  // position
+    glm::vec3 Normal;    // normal
+    glm::vec2 TexCoords; // texCoords
+    glm::vec3 Tangent;   // tangent
+    glm::vec3 Bitangent; // bitangent
+
+    int m_BoneIDs[MAX_BONE_INFLUENCE];   // Bone indexes which will influence this vertex
+    float m_Weights[MAX_BONE_INFLUENCE]; // Weights from each bone
+
+} Vertex;
+
+/* The optional vertex attributes, the position is always there */
+enum VertexAttribute {
+    VERTEX_NORMAL = 1u << 0,        // Location 1: octahedral normal in the xy of a GL_INT_2_10_10_10_REV
+    VERTEX_TEXCOORDS = 1u << 1,     // Location 2: half floats when they fit, floats otherwise
+    VERTEX_TANGENT_FRAME = 1u << 2  // Location 3: octahedral tangent in xy, bitangent sign in z, of a GL_INT_2_10_10_10_REV
+};
+
+/* The vertices and triangles of one mesh before upload, and the VertexAttributes they carry. The importer gathers one per
+   material, generators build them directly */
+typedef struct MeshGeometry {
+    unsigned int materialIndex = 0;
+    unsigned int attributes = 0;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+} MeshGeometry;
+
+/* Per-instance data of an instanced draw: the camera-relative model matrix, the seed of the instance's procedural shape and the
+   layer of the texture arrays it samples */
+typedef struct InstanceData {
+    glm::mat4 model;
+    uint32_t shapeSeed;
+    uint32_t textureLayer;
+} InstanceData;
+
+/* Half floats step by 1/2048 up to 1.0, about a texel of a 2K texture: texture coordinates beyond it (tiling) stay floats */
+#define HALF_TEXCOORDS_LIMIT 1.0f
+
+/* Vertex Layout Structure. Which attributes a mesh's vertices store on the GPU and where, chosen per mesh at import */
+typedef struct VertexLayout {
+    unsigned int attributes = 0;
+    bool halfTexCoords = false;
+
+    unsigned int stride = 0;
+    unsigned int normalOffset = 0, texCoordsOffset = 0, tangentOffset = 0;
+
+    bool inline has(const VertexAttribute attribute) const { return (this->attributes & attribute) != 0; }
+} VertexLayout;
+
+/* Builds the layout of a set of attributes, packed one after the other behind the position */
+VertexLayout makeVertexLayout(const unsigned int attributes, const bool halfTexCoords)
+{
+    VertexLayout layout;
+    layout.attributes = attributes;
+    layout.halfTexCoords = halfTexCoords && (attributes & VERTEX_TEXCOORDS) != 0;
+
+    layout.stride = 3 * sizeof(float);
+    if (layout.has(VERTEX_NORMAL)) { layout.normalOffset = layout.stride; layout.stride += sizeof(uint32_t); }
+    if (layout.has(VERTEX_TEXCOORDS)) { layout.texCoordsOffset = layout.stride; layout.stride += layout.halfTexCoords ? sizeof(uint32_t) : 2 * sizeof(float); }
+    if (layout.has(VERTEX_TANGENT_FRAME)) { layout.tangentOffset = layout.stride; layout.stride += sizeof(uint32_t); }
+
+    return layout;
+}
+
+/* Picks the smallest layout that keeps the given attributes of these vertices */
+VertexLayout chooseVertexLayout(const std::vector<Vertex>& vertices, const unsigned int attributes)
+{
+    bool halfTexCoords = true;
+    for (size_t i = 0; i < vertices.size() && halfTexCoords; i++)
+        halfTexCoords = std::fabs(vertices[i].TexCoords.x) <= HALF_TEXCOORDS_LIMIT && std::fabs(vertices[i].TexCoords.y) <= HALF_TEXCOORDS_LIMIT;
+
+    return makeVertexLayout(attributes, halfTexCoords);
+}
+
+/* Maps a unit vector onto the octahedron, unfolded to the [-1, 1] square */
+glm::vec2 octahedralEncode(const glm::vec3& vector)
+{
+    const float length1 = std::fabs(vector.x) + std::fabs(vector.y) + std::fabs(vector.z);
+    if (length1 == 0.0f) return glm::vec2(0.0f);
+
+    glm::vec2 encoded = glm::vec2(vector.x, vector.y) / length1;
+    if (vector.z < 0.0f) {
+        const glm::vec2 folded = 1.0f - glm::abs(glm::vec2(encoded.y, encoded.x));
+        encoded = glm::vec2(encoded.x >= 0.0f ? folded.x : -folded.x, encoded.y >= 0.0f ? folded.y : -folded.y);
+    }
+
+    return encoded;
+}
+
+/* Writes the vertices in a layout's format, stride bytes each */
+void packVertices(const VertexLayout& layout, const std::vector<Vertex>& vertices, std::vector<unsigned char>& packed)
+{
+    packed.resize(vertices.size() * layout.stride);
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& vertex = vertices[i];
+        unsigned char* destination = packed.data() + i * layout.stride;
+
+        std::memcpy(destination, &vertex.Position, 3 * sizeof(float));
+
+        if (layout.has(VERTEX_NORMAL)) {
+            const uint32_t normal = glm::packSnorm3x10_1x2(glm::vec4(octahedralEncode(vertex.Normal), 0.0f, 0.0f));
+            std::memcpy(destination + layout.normalOffset, &normal, sizeof(normal));
+        }
+
+        if (layout.has(VERTEX_TEXCOORDS)) {
+            if (layout.halfTexCoords) {
+                const uint32_t texCoords = glm::packHalf2x16(vertex.TexCoords);
+                std::memcpy(destination + layout.texCoordsOffset, &texCoords, sizeof(texCoords));
+            }
+            else std::memcpy(destination + layout.texCoordsOffset, &vertex.TexCoords, 2 * sizeof(float));
+        }
+
+        if (layout.has(VERTEX_TANGENT_FRAME)) {
+            // The bitangent is cross(normal, tangent) up to its sign, which is all that needs storing
+            const float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+            const uint32_t tangent = glm::packSnorm3x10_1x2(glm::vec4(octahedralEncode(vertex.Tangent), handedness, 0.0f));
+            std::memcpy(destination + layout.tangentOffset, &tangent, sizeof(tangent));
+        }
+    }
+}
+
+/* Points the attributes of the bound vertex array at the bound vertex buffer, which holds vertices in this layout from offset bytes in */
+void setVertexAttributes(const VertexLayout& layout, const size_t offset = 0)
+{
+    const GLsizei stride = (GLsizei)layout.stride;
+
+    glEnableVertexAttribArray(0); glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset); // Vertex Positions
+
+    if (layout.has(VERTEX_NORMAL)) {
+        glEnableVertexAttribArray(1); glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)(offset + layout.normalOffset)); // Vertex Normals
+    }
+
+    if (layout.has(VERTEX_TEXCOORDS)) {
+        glEnableVertexAttribArray(2); glVertexAttribPointer(2, 2, layout.halfTexCoords ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, stride, (void*)(offset + layout.texCoordsOffset)); // Vertex Texture Coordinates
+    }
+
+    if (layout.has(VERTEX_TANGENT_FRAME)) {
+        glEnableVertexAttribArray(3); glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)(offset + layout.tangentOffset)); // Vertex Tangent Frame
+    }
+}
+
+/* Points the per-instance attributes (locations 4 to 9) of the bound vertex array at InstanceData records of the bound buffer,
+   starting offset bytes in. Advancing once per instance */
+void setInstanceAttributes(const size_t offset)
+{
+    const GLsizei stride = (GLsizei)sizeof(InstanceData);
+
+    // A mat4 attribute takes four locations, one per column
+    for (unsigned int column = 0; column < 4; column++) {
+        glEnableVertexAttribArray(4 + column);
+        glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(4 + column, 1);
+    }
+
+    glEnableVertexAttribArray(8); glVertexAttribIPointer(8, 1, GL_UNSIGNED_INT, stride, (void*)(offset + offsetof(InstanceData, shapeSeed))); // Shape Seeds
+    glVertexAttribDivisor(8, 1);
+    glEnableVertexAttribArray(9); glVertexAttribIPointer(9, 1, GL_UNSIGNED_INT, stride, (void*)(offset + offsetof(InstanceData, textureLayer))); // Texture Layers
+    glVertexAttribDivisor(9, 1);
+}
+
+/* Turns the per-instance attributes of the bound vertex array off again, so plain draws of the same mesh never read them */
+void clearInstanceAttributes(void)
+{
+    for (unsigned int location = 4; location <= 9; location++) {
+        glVertexAttribDivisor(location, 0);
+        glDisableVertexAttribArray(location);
+    }
+}
+
+#endif /* VERTEX_LAYOUT_HEADER */
@@ -10,15 +10,37 @@
 #include <shader.h>
 #include <camera.h>
 #include <model.h>
+#include <model_registry.h>
+#include <gl_resource.h>
+#include <process_memory.h>
+#include <procedural_sphere.h>
+#include <texture_array.h>
+#include <texture_cooker.h>
+#include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <iostream>
 #include <thread>
 #include <chrono>
-
-#include "space/astronimical_object.h"
-#include "space/background_star.h"
-
-#define getRandFloat(min,max) min+((float)rand()/RAND_MAX)*(max-min);
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+
+#include "space/world.h"
+#include "space/bodies.h"
+#include "space/transform_system.h"
+#include "space/render_system.h"
+#include "space/collision_system.h"
+#include "space/time_warp.h"
+#include "space/belt_generator.h"
+#include "space/camera_relative_pass.h"
+#include "space/terrain_system.h"
+#include "space/texture_coverage_pass.h"
+#include "space/ephemeris.h"
+#include "space/state_log.h"
 
 struct EnvironmentColors { 
     float red, green, blue, alpha; 
@@ -56,6 +78,9 @@ bool firstMouse = true;
 /* Timimg */
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
+float lastTitleUpdate = 0.0f;
+
+const double simulationStepsPerSecond = 60.0; // Simulation steps per real second at 1x time warp
 
 /* Environment Options */
 const double sunSize = 1.0f;
@@ -63,6 +88,7 @@ const double sunSize = 1.0f;
 const unsigned int starsAmount = 1000;
 const double starsSize = (float)(sunSize / 40);
 const double starsDistanceFromSun = (float)(sunSize * 85);
+const double sceneRadius = starsDistanceFromSun * 1.1; // Everything drawn lies this close to the sun, the depth range reaches that far
 
 const unsigned int asteroidsAmount = 100;
 const double asteroidsSize_MIN = (float)(sunSize / 600);
@@ -75,8 +101,20 @@ const double asteroidsVelocity_MIN = (float)(sunSize / 85);
 const double asteroidsVelocity_MAX = (float)(sunSize / 40);
 const double asteroidsSpinningVelocity_MIN = (float)(sunSize / 100);
 const double asteroidsSpinningVelocity_MAX = (float)(sunSize / 10);
-const double asteroidsElevation_MIN = -(float)(sunSize / 5);
-const double asteroidsElevation_MAX =  (float)(sunSize / 5);
+const double asteroidsInclinationSpread = 0.01;  // Standard deviation of the asteroid orbits' inclination (radians)
+const double asteroidsRadialExponent = 1.0;      // Belt surface density ~ distance^-exponent
+const double asteroidsSizeExponent = 3.5;        // dN/dD ~ D^-exponent, the collisional equilibrium of a real belt
+const KirkwoodGap asteroidsGaps[] = {             // The 3:1, 5:2, 7:3 and 2:1 resonances, placed where they sit in the real belt
+    { asteroidsDistanceFromSun_MIN + 0.333 * (asteroidsDistanceFromSun_MAX - asteroidsDistanceFromSun_MIN), 0.25, 0.95 },
+    { asteroidsDistanceFromSun_MIN + 0.600 * (asteroidsDistanceFromSun_MAX - asteroidsDistanceFromSun_MIN), 0.25, 0.90 },
+    { asteroidsDistanceFromSun_MIN + 0.708 * (asteroidsDistanceFromSun_MAX - asteroidsDistanceFromSun_MIN), 0.20, 0.80 },
+    { asteroidsDistanceFromSun_MIN + 0.975 * (asteroidsDistanceFromSun_MAX - asteroidsDistanceFromSun_MIN), 0.30, 0.95 }
+};
+const CollisionResponse asteroidsCollisionResponse = COLLISION_BOUNCE;
+const double asteroidsShapeBumps = 0.25;         // Largest bump the rock shader puts on an asteroid, as a fraction of the rock's radius
+const double asteroidsShapeStretch = 0.3;        // Largest squash or stretch of an asteroid along each axis
+const double asteroidsShapeLumps = 1.5;          // Lumps across the rock's radius
+const double asteroidsShapeGrowth = (1.0 + asteroidsShapeBumps) * (1.0 + asteroidsShapeStretch); // How much bigger than the rock model an asteroid can get
 
 
 const double venusSize = (float)(sunSize / 115);
@@ -96,18 +134,109 @@ const double moonRadius = (float)(earthSize * 32);
 const double moonVelocity = (float)(earthSize * 20);
 const double moonSpinningVelocity = 0.0f;
 
+/* The planets share one generated cube sphere of radius 1, scaled to the size of the OBJ spheres the sizes above were tuned for */
+const unsigned int planetSubdivisions = 32; // Grid cells along each cube face edge
+const float venusMeshRadius = 0.60656f;
+const float earthMeshRadius = 3.17403f;
+const float moonMeshRadius = 1.74590f;
+
+/* The planet OBJ files lay their texture crosses out on cubes turned differently from the generated one (the Moon's far off, the
+   Earth's by a few degrees), so each planet gets a fixed orientation, in radians about x then y then z, that turns the generated
+   sphere into its OBJ's cube frame and puts every continent back where the textures were painted */
+const Point3D venusMeshOrientation = { -3.0046, 1.0848, 2.7997 };
+const Point3D earthMeshOrientation = { 0.0450, 0.1063, 0.0515 };
+const Point3D moonMeshOrientation = { 1.9843, -0.3270, -2.6013 };
+
+/* The planets' textures are the layers of texture arrays, resampled to a common size (every map is about 4:3). Layer i belongs
+   to the planet with textureLayer i: Venus, the Earth, the Moon */
+const unsigned int planetTextureWidth = 2048;
+const unsigned int planetTextureHeight = 1536;
+const std::vector<std::string> planetDiffuseFiles = { "Assets/Planets/Venus/Diffuse_1K.png", "Assets/Planets/earth/Diffuse_2K.png", "Assets/Planets/moon/Diffuse.png" };
+
+/* The planets' surface masks, packed into one RGBA texture each: ocean (which gets the specular) in red, night lights in green,
+   clouds in blue and the bump map's height in alpha. The Earth's ocean mask is white on land */
+const std::vector<PackedTextureSources> planetSurfaceSources = {
+    { { {}, {}, {}, { "Assets/Planets/Venus/Bump_1K.png" } } },
+    { { { "Assets/Planets/earth/Ocean_Mask_2K.png", true }, { "Assets/Planets/earth/Night_lights_2K.png" }, { "Assets/Planets/earth/Clouds_2K.png" }, { "Assets/Planets/earth/Bump_2K.png" } } },
+    { { {}, {}, {}, { "Assets/Planets/moon/Bump.png" } } },
+};
+const float planetReliefShading = 0.01f; // Height the bump maps' full range stands for in the planets' lighting, as a fraction of the radius
+
+/* Up close the planets turn into quadtree terrain displaced by their bump maps, up to this fraction of their radius (the real
+   relief, exaggerated a few times so it shows) */
+const float venusTerrainHeight = 0.005f;
+const float earthTerrainHeight = 0.004f;
+const float moonTerrainHeight = 0.01f;
+
 EnvironmentColors envColor = { 0.0f, 0.0f, 0.0f, 1.0f };
 
 struct Point { double x, y, z; };
 
 bool paused = false;
+TimeWarp* timeWarp = NULL;
+
+StateReplay* stateReplay = NULL;     // Set while a state log drives the scene instead of the simulation
+long long replayFrame = 0;           // Frame of the state log on screen
+const long long replayScrubSpeed = 8; // Frames skipped per rendered frame while an arrow key is held
 
-// Lighting
-glm::vec3 lightPos(0.0f, 0.0f, 0.0f);
+unsigned long long generationSeed = 20240127ULL; // Seed of the procedural asteroids and stars (override with --seed N)
+
+const unsigned int ephemerisCoefficients = 16;     // Chebyshev coefficients per coordinate and segment
+const unsigned int ephemerisSegmentsPerMoonOrbit = 8;
+const double ephemerisDefaultDays = 3652.5;        // Ten simulated years
+
+const std::string cookedTextureDirectory = "Cache/Textures"; // Block compressed textures, cooked on first use (or ahead with --cook-textures)
+const std::string cookedModelDirectory = "Cache/Models";     // Imported models packed as the GPU takes them, cooked on first use
+const size_t textureMemoryBudget = (size_t)96 << 20;          // Video memory the textures may take before the least recently used lose their finest mip levels
+
+int bakeEphemeris(const std::string& path, const double days);
+int reportMeshOptimization(const std::string& root);
+int benchmarkObjImport(const std::string& root);
+int benchmarkModelCache(const std::string& root);
+int cookTextures(const std::string& root);
+TextureCookSettings planetTextureSettings(const CookedFormat format);
 
 int main(int argc, char* argv[])
 {
-    srand(static_cast<unsigned int>(glfwGetTime()));
+    const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+    std::string ephemerisPath, bakePath, recordPath, replayPath, meshStatsRoot, objBenchmarkRoot, modelBenchmarkRoot, cookRoot;
+    double bakeDays = ephemerisDefaultDays;
+    bool sequentialLoad = false; // Load everything in turn on this thread as it is needed, to compare the startup time with
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) generationSeed = std::strtoull(argv[++i], NULL, 10);
+        else if (std::strcmp(argv[i], "--ephemeris") == 0 && i + 1 < argc) ephemerisPath = argv[++i];
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--mesh-stats") == 0) meshStatsRoot = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : "Assets";
+        else if (std::strcmp(argv[i], "--obj-benchmark") == 0) objBenchmarkRoot = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : "Assets";
+        else if (std::strcmp(argv[i], "--model-benchmark") == 0) modelBenchmarkRoot = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : "Assets";
+        else if (std::strcmp(argv[i], "--sequential-load") == 0) sequentialLoad = true;
+        else if (std::strcmp(argv[i], "--cook-textures") == 0) cookRoot = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : "Assets";
+        else if (std::strcmp(argv[i], "--bake-ephemeris") == 0 && i + 1 < argc) {
+            bakePath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-') bakeDays = std::strtod(argv[++i], NULL);
+        }
+    }
+
+    // Baking needs no window: it runs the integrator offline, writes the file and quits
+    if (!bakePath.empty()) return bakeEphemeris(bakePath, bakeDays);
+    if (!meshStatsRoot.empty()) return reportMeshOptimization(meshStatsRoot);
+    if (!objBenchmarkRoot.empty()) return benchmarkObjImport(objBenchmarkRoot);
+    if (!modelBenchmarkRoot.empty()) return benchmarkModelCache(modelBenchmarkRoot);
+    if (!cookRoot.empty()) return cookTextures(cookRoot);
+
+    std::cout << "Generation seed: " << generationSeed << std::endl;
+
+    // Importing the model files on the thread pool while the window, the context and the shaders get made
+    const std::string sunModelFile = "Assets/sun/scene.gltf", starModelFile = "Assets/star/star.obj", rockModelFile = "Assets/Rock/rock.obj";
+    ModelRegistry models;
+    models.setCookedDirectory(cookedModelDirectory);
+    if (!sequentialLoad) {
+        models.prefetch(sunModelFile);
+        models.prefetch(starModelFile);
+        models.prefetch(rockModelFile);
+    }
 
 	/* GLFW: Initialization and Configuration */
 	glfwInit();
@@ -143,64 +272,129 @@ int main(int argc, char* argv[])
     // Configure global OpenGL State
     glEnable(GL_DEPTH_TEST);
 
+    // The planet textures get prepared on the workers too, flat placeholder layers stand in for them until the render loop uploads them
+    TextureArray planetDiffuse, planetSurface;
+    planetDiffuse.load(planetDiffuseFiles, planetTextureSettings(COOKED_BC1), cookedTextureDirectory);
+    planetSurface.loadPacked(planetSurfaceSources, planetTextureSettings(COOKED_RGBA8), cookedTextureDirectory);
+    if (sequentialLoad) {
+        planetDiffuse.finish();
+        planetSurface.finish();
+    }
+
     // Build and Compile the application shaders
     Shader lightShader("src/shaders/shader.vs", "src/shaders/shader.fs");
     Shader lightSourceShader("src/shaders/lightShader.vs", "src/shaders/lightShader.fs");
-
-    // Loading all the 3D planet models
-    Model sun_model("Assets/sun/scene.gltf");
-    Model venus_model("Assets/Planets/Venus/Venus_1K.obj");
-    Model earth_model("Assets/Planets/earth/Earth_2K.obj");
-    Model moon_model("Assets/Planets/moon/Moon.obj");
-    Model star_model("Assets/star/star.obj");
-    Model rock_model("Assets/Rock/rock.obj");
-
-    /* Creating all the planets, stars, rocks etc. */
-    AstronomicalObject sun(sun_model, 0, 0, 0, sunSize, NULL); sun.setOrientation(90, 0, 0);
-    AstronomicalObject earth(earth_model, earthRadius, earthVelocity, earthSpinningVelocity, earthSize, &sun);
-    AstronomicalObject venus(venus_model, venusRadius, venusVelocity, venusSpinningVelocity, venusSize, &sun);
-    AstronomicalObject moon(moon_model, moonRadius, moonVelocity, moonSpinningVelocity, moonSize, &earth);
+    Shader rockShader("src/shaders/rock.vs", "src/shaders/shader.fs");
+    Shader planetShader("src/shaders/planet.vs", "src/shaders/planet.fs");
+
+    // Loading all the 3D models and generating the planets, once each: every body drawn with a model holds a handle to the registry's copy
+    reportProcessMemory("before loading the models");
+    TextureCache::global().setCookedDirectory(cookedTextureDirectory);
+    TextureCache::global().setMemoryBudget(textureMemoryBudget);
+
+    const ModelHandle sun_model = models.load(sunModelFile);
+    const ModelHandle planet_model = models.emplace("procedural:planet", generateCubeSphere(planetSubdivisions, 1.0f), "Assets/Planets", std::vector<TextureFile>());
+    const ModelHandle star_model = models.load(starModelFile);
+    const ModelHandle rock_model = models.load(rockModelFile);
+
+    reportProcessMemory("after loading the models");
+    std::cout << "Models loaded " << std::chrono::duration<double>(std::chrono::steady_clock::now() - processStart).count() << " s after start" << (sequentialLoad ? " (sequential load)" : "") << std::endl;
+
+    /* Creating all the planets, stars, rocks etc. Every object is an entity of the world, its kind is its set of components */
+    World world;
+
+    const Entity sun = createCentralBody(world, sun_model, Point3D{ 0, 0, 0 }, sunSize, RENDER_EMISSIVE);
+    world.get<Spin>(sun).orientation = { 90, 0, 0 };
+    const Entity venus = createOrbitingBody(world, planet_model, sun, venusRadius, venusVelocity, venusSpinningVelocity, venusSize * venusMeshRadius, 0, true);
+    const Entity earth = createOrbitingBody(world, planet_model, sun, earthRadius, earthVelocity, earthSpinningVelocity, earthSize * earthMeshRadius, 0, true);
+    const Entity moon = createOrbitingBody(world, planet_model, earth, moonRadius, moonVelocity, moonSpinningVelocity, moonSize * moonMeshRadius, 0, true);
+    const Entity planets[] = { venus, earth, moon };
+    const Point3D planetMeshOrientations[] = { venusMeshOrientation, earthMeshOrientation, moonMeshOrientation };
+    for (unsigned int i = 0; i < 3; i++) {
+        Renderable& renderable = world.get<Renderable>(planets[i]);
+        renderable.pass = RENDER_PLANETS;
+        renderable.textureLayer = i;
+        world.get<Spin>(planets[i]).orientation = planetMeshOrientations[i];
+    }
 
     /* Creating the asteroids */
-    AstronomicalObject* asteroids = new AstronomicalObject[asteroidsAmount];
-    for (unsigned int i = 0; i < asteroidsAmount; i++) {
-        double distance = getRandFloat(asteroidsDistanceFromSun_MIN, asteroidsDistanceFromSun_MAX);
-
-        double elevationLevel = getRandFloat(asteroidsElevation_MIN, asteroidsElevation_MAX);
-
-        double orientX = getRandFloat(asteroidsOrientation_MIN, asteroidsOrientation_MAX);
-        double orientY = getRandFloat(asteroidsOrientation_MIN, asteroidsOrientation_MAX);
-        double orientZ = getRandFloat(asteroidsOrientation_MIN, asteroidsOrientation_MAX);
+    BeltGenerator generator(generationSeed);
 
-        double spinningVelocity = getRandFloat(asteroidsSpinningVelocity_MIN, asteroidsSpinningVelocity_MIN);
-        double velocity = getRandFloat(asteroidsVelocity_MIN, asteroidsVelocity_MAX);
+    BeltProfile asteroidsBelt;
+    asteroidsBelt.innerRadius = asteroidsDistanceFromSun_MIN; asteroidsBelt.outerRadius = asteroidsDistanceFromSun_MAX;
+    asteroidsBelt.radialExponent = asteroidsRadialExponent;
+    asteroidsBelt.gaps.assign(asteroidsGaps, asteroidsGaps + sizeof(asteroidsGaps) / sizeof(asteroidsGaps[0]));
+    asteroidsBelt.inclinationSpread = asteroidsInclinationSpread;
+    asteroidsBelt.minSize = asteroidsSize_MIN; asteroidsBelt.maxSize = asteroidsSize_MAX; asteroidsBelt.sizeExponent = asteroidsSizeExponent;
+    asteroidsBelt.minVelocity = asteroidsVelocity_MIN; asteroidsBelt.maxVelocity = asteroidsVelocity_MAX;
+    asteroidsBelt.minSpinningVelocity = asteroidsSpinningVelocity_MIN; asteroidsBelt.maxSpinningVelocity = asteroidsSpinningVelocity_MAX;
+    asteroidsBelt.minOrientation = asteroidsOrientation_MIN; asteroidsBelt.maxOrientation = asteroidsOrientation_MAX;
 
-        double size = getRandFloat(asteroidsSize_MIN, asteroidsSize_MAX);
+    std::vector<BeltBody> belt;
+    generator.generateBelt(asteroidsBelt, asteroidsAmount, belt);
 
-        AstronomicalObject asteroid = AstronomicalObject(rock_model, distance, velocity, spinningVelocity, size, &sun);
-        asteroid.setLocationY(elevationLevel);
-        asteroid.setStartPositionOffset(rand() % 360);
-        asteroid.setOrientation(orientX, orientY, orientZ);
-        asteroid.setFullSpin(true);
-
-        asteroids[i] = asteroid;
+    for (unsigned int i = 0; i < asteroidsAmount; i++) {
+        const Entity asteroid = createOrbitingBody(world, rock_model, sun, belt[i].distance, belt[i].velocity, belt[i].spinningVelocity, belt[i].size, belt[i].startOffset, false);
+        world.get<Orbit>(asteroid).position.y = belt[i].elevation;
+
+        // Every asteroid draws the same rock mesh, the rock shader gives each its own shape
+        Renderable& renderable = world.get<Renderable>(asteroid);
+        renderable.pass = RENDER_ROCKS;
+        renderable.shapeSeed = belt[i].shapeSeed;
+        world.get<Collider>(asteroid).radius *= asteroidsShapeGrowth;
+
+        Spin& spin = world.get<Spin>(asteroid);
+        spin.orientation = { belt[i].orientationX, belt[i].orientationY, belt[i].orientationZ };
+        spin.fullSpin = true;
     }
 
     /* Creating the stars background */
-    BackgroundStar* stars = new BackgroundStar[starsAmount];
-    for (unsigned int i = 0; i < starsAmount; i++) {
-        BackgroundStar star = BackgroundStar(star_model, starsDistanceFromSun, starsSize, &sun);
-
-        double r = starsDistanceFromSun;
-        double theta = (double)(rand() % 180);
-        double phi = (double)(rand() % 360);
-
-        star.setLocationX(r * sin(theta) * cos(phi));
-        star.setLocationY(r * sin(theta) * sin(phi));
-        star.setLocationZ(r * cos(theta));
+    std::vector<Point3D> starPositions;
+    generator.generateStarField(starsDistanceFromSun, starsAmount, starPositions);
+
+    for (unsigned int i = 0; i < starsAmount; i++)
+        createBackgroundStar(world, star_model, starPositions[i], starsSize);
+
+    std::cout << world.count(ComponentMaskOf<Renderable>::value) << " bodies drawn from " << models.getModelCount() << " resident models" << std::endl;
+    reportProcessMemory("after creating the scene");
+
+    /* Time warp: a simulated day is 1/365.25 of the Earth's year */
+    const double stepsPerDay = (2.0 * glm::pi<double>() / world.get<Orbit>(earth).angularVelocity) / 365.25;
+    TimeWarp warp(world, simulationStepsPerSecond, stepsPerDay);
+    timeWarp = &warp;
+
+    /* With an ephemeris file the planets follow its recorded orbits, and the Time Warp only spins them */
+    Ephemeris ephemeris;
+    bool useEphemeris = false;
+    if (!ephemerisPath.empty()) {
+        useEphemeris = ephemeris.open(ephemerisPath) && ephemeris.bind(world, venus, "Venus") && ephemeris.bind(world, earth, "Earth") && ephemeris.bind(world, moon, "Moon");
+        std::cout << (useEphemeris ? "Playing back the planets from " : "Falling back to integrated orbits, could not use ") << ephemerisPath << std::endl;
+    }
 
-        stars[i] = star;
+    /* The systems that run over the world every frame */
+    TransformSystem transformSystem(world);
+    CollisionSystem collisionSystem(world, 2.0 * asteroidsSize_MAX * asteroidsShapeGrowth * rock_model->BoundingRadius, asteroidsCollisionResponse); // Grid cells fit two of the biggest asteroids
+    CameraRelativePass cameraRelativePass(world);
+    TextureCoveragePass textureCoveragePass(world);
+    RenderSystem renderSystem(world);
+
+    TerrainSystem terrainSystem(world);
+    terrainSystem.add(venus, "Assets/Planets/Venus/Bump_1K.png", 1.0f, venusTerrainHeight);
+    terrainSystem.add(earth, "Assets/Planets/earth/Bump_2K.png", 1.0f, earthTerrainHeight);
+    terrainSystem.add(moon, "Assets/Planets/moon/Bump.png", 1.0f, moonTerrainHeight);
+
+    /* Recording or replaying every frame's body states and camera pose (the stars never move, they are left out) */
+    StateRecorder recorder;
+    if (!recordPath.empty() && recorder.open(recordPath, world, generationSeed)) std::cout << "Recording to " << recordPath << std::endl;
+
+    StateReplay replay;
+    if (!replayPath.empty() && replay.open(replayPath, world, generationSeed) && replay.getFrameCount() > 0) {
+        stateReplay = &replay;
+        std::cout << "Replaying " << replay.getFrameCount() << " frames from " << replayPath << std::endl;
     }
+    float replayStart = 0.0f;
+    long long replayRenderedFrames = 0;
+    bool texturesReported = false, planetTexturesReported = false, firstFrameReported = false;
 
     /* Application Render Loop */
     while (!glfwWindowShouldClose(window)) {
@@ -212,69 +406,484 @@ int main(int argc, char* argv[])
         // Processing the input
         processInput(window);
 
+        // Streaming in the textures the workers have decoded, a few MB per frame
+        TextureCache& textures = TextureCache::global();
+        textures.update();
+        if (!texturesReported && textures.getLoadingCount() == 0) {
+            std::cout << "Every texture streamed in " << currentFrame << " s after start" << std::endl;
+            textures.report();
+            texturesReported = true;
+        }
+        planetDiffuse.update();
+        planetSurface.update();
+        if (!planetTexturesReported && !planetDiffuse.isLoading() && !planetSurface.isLoading()) {
+            std::cout << "Planet textures: " << planetDiffuse.getLayerCount() << " layers of " << planetDiffuse.getWidth() << "x" << planetDiffuse.getHeight() << ", diffuse " << std::fixed << std::setprecision(1)
+                << planetDiffuse.getBytes() / (1024.0 * 1024.0) << " MB, surface masks " << planetSurface.getBytes() / (1024.0 * 1024.0) << " MB" << std::defaultfloat << std::endl;
+            planetTexturesReported = true;
+        }
+
+        if (stateReplay != NULL) {
+            // Replaying: the log places every body and the camera, nothing gets simulated
+            if (replayFrame >= (long long)replay.getFrameCount()) {
+                const double seconds = currentFrame - replayStart;
+                if (replayRenderedFrames > 0)
+                    std::cout << "Replay: " << replayRenderedFrames << " frames in " << seconds << " s (" << 1000.0 * seconds / replayRenderedFrames << " ms/frame)" << std::endl;
+                replayFrame = 0;
+            }
+            if (replayFrame == 0) { replayStart = currentFrame; replayRenderedFrames = 0; }
+
+            CameraPose pose;
+            replay.apply((uint64_t)replayFrame, pose);
+            camera.SetPose(pose.position, pose.yaw, pose.pitch, pose.zoom);
+
+            if (currentFrame - lastTitleUpdate >= 0.5f) {
+                std::ostringstream title;
+                title << "GraphicsAssignment: Planet Simluation | replay frame " << replayFrame << " / " << replay.getFrameCount() << " (simulation step " << replay.getSimulationTime((uint64_t)replayFrame) << ")";
+                glfwSetWindowTitle(window, title.str().c_str());
+                lastTitleUpdate = currentFrame;
+            }
+
+            if (!warp.isPaused()) { replayFrame++; replayRenderedFrames++; }
+        }
+        else {
+            // Advancing the simulation, and reporting how fast it runs in the window title
+            warp.advance(deltaTime);
+            if (useEphemeris) ephemeris.apply(world, warp.getSimulationTime());
+            if (currentFrame - lastTitleUpdate >= 0.5f) {
+                std::ostringstream title;
+                title << "GraphicsAssignment: Planet Simluation | warp " << warp.getWarpFactor() << "x (achieved " << (int)warp.getAchievedWarpFactor()
+                      << "x, moon sub-steps " << warp.getLevelSubsteps(2) << ") | " << warp.getDaysPerSecond() << " simulated days/s";
+                if (terrainSystem.getDrawnChunks() > 0) title << " | terrain " << terrainSystem.getDrawnChunks() << " chunks, " << terrainSystem.getDrawnTriangles() << " triangles";
+                glfwSetWindowTitle(window, title.str().c_str());
+                lastTitleUpdate = currentFrame;
+            }
+
+            // Updating the world positions (double precision), then letting the asteroids bounce off (or merge with) whatever they hit
+            transformSystem.update();
+
+            if (!warp.isPaused())
+                collisionSystem.resolve();
+
+            CameraPose pose = { camera.Position, camera.Yaw, camera.Pitch, camera.Zoom };
+            recorder.record(warp.getSimulationTime(), pose);
+        }
+
+        // Turning every world position into a float transformation relative to the camera
+        cameraRelativePass.run(camera.Position);
+
+        // Telling the texture cache how large every model is on screen, it streams the mip levels in and out accordingly
+        textureCoveragePass.run((float)SCR_HEIGHT, glm::radians(camera.Zoom));
+
+        // Picking the terrain chunks of the planets nearby, and uploading the ones the workers finished
+        terrainSystem.update((float)SCR_HEIGHT, glm::radians(camera.Zoom));
+
         // Rendering
         glClearColor(envColor.red, envColor.green, envColor.blue, envColor.alpha);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
-        // Don't forget to enable shader before setting uniforms
+        // Don't forget to enable shader before setting uniforms. Lighting happens in camera-relative space, where the viewer sits at the origin
+        const Point3D sunPosition = world.get<Transform>(sun).position;
+        const glm::dvec3 lightPos = glm::dvec3(sunPosition.x, sunPosition.y, sunPosition.z) - camera.Position;
         lightShader.use();
         lightShader.setVec3("objectColor", 1.0f, 1.0f, 1.0f);
         lightShader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
-        lightShader.setVec3("lightPos", lightPos);
-        lightShader.setVec3("viewPos", camera.Position);
+        lightShader.setVec3("lightPos", glm::vec3(lightPos));
+        lightShader.setVec3("viewPos", glm::vec3(0.0f));
 
         // View/Projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        // The near plane moves in when a planet's surface comes closer than it, or the terrain would get clipped away. There is no far
+        // plane: the shaders write a logarithmic depth, log2(distance) mapped from [near, far] onto [0, 1], whose precision is the same
+        // fraction of the distance everywhere. With the usual depth, a near plane this close would z-fight everything past a few units
+        const float nearPlane = (float)glm::clamp(0.5 * terrainSystem.getNearestSurfaceDistance(), 1e-5, 0.1);
+        const float farDepth = (float)(glm::length(camera.Position) + sceneRadius);
+        const float logDepthScale = 1.0f / std::log2(farDepth / nearPlane);
+        const glm::vec2 logDepth(logDepthScale, -std::log2(nearPlane) * logDepthScale);
+        glm::mat4 projection = glm::infinitePerspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, nearPlane);
         glm::mat4 view = camera.GetViewMatrix();
         lightShader.setMat4("projection", projection);
+        lightShader.setVec2("logDepth", logDepth);
         lightShader.setMat4("view", view);
-
-        //Rendering Venus
-        venus.updatePosition();
-        venus.draw(lightShader);
-
-        // Rendering the Earth
-        earth.updatePosition();
-        earth.draw(lightShader);
-
-        // Rendering the Moon
-        moon.updatePosition();
-        moon.draw(lightShader);
-
-        // Rendering the asteroids around the sun
-        for (unsigned int i = 0; i < asteroidsAmount; i++) {
-            asteroids[i].updatePosition();
-            asteroids[i].draw(lightShader);
-        }
+        renderSystem.draw(lightShader, RENDER_LIT);
+
+        // Rendering the planets around the sun, all of them in one instanced draw with one texture array. The terrain takes its layer from a uniform
+        planetShader.use();
+        planetShader.setVec3("objectColor", 1.0f, 1.0f, 1.0f);
+        planetShader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
+        planetShader.setVec3("lightPos", glm::vec3(lightPos));
+        planetShader.setVec3("viewPos", glm::vec3(0.0f));
+        planetShader.setMat4("projection", projection);
+        planetShader.setVec2("logDepth", logDepth);
+        planetShader.setMat4("view", view);
+        planetShader.setFloat("reliefHeight", planetReliefShading);
+        planetDiffuse.bind(0);
+        planetShader.setInt("planetDiffuse", 0);
+        planetSurface.bind(1);
+        planetShader.setInt("planetSurface", 1);
+        planetShader.setBool("instanced", true);
+        renderSystem.drawInstanced(planetShader, RENDER_PLANETS);
+        planetShader.setBool("instanced", false);
+        terrainSystem.draw(planetShader);
+
+        // Rendering the asteroids, all of them in one instanced draw
+        rockShader.use();
+        rockShader.setVec3("objectColor", 1.0f, 1.0f, 1.0f);
+        rockShader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
+        rockShader.setVec3("lightPos", glm::vec3(lightPos));
+        rockShader.setVec3("viewPos", glm::vec3(0.0f));
+        rockShader.setMat4("projection", projection);
+        rockShader.setVec2("logDepth", logDepth);
+        rockShader.setMat4("view", view);
+        rockShader.setFloat("displacement", (float)(asteroidsShapeBumps * rock_model->BoundingRadius));
+        rockShader.setFloat("noiseFrequency", (float)(asteroidsShapeLumps / rock_model->BoundingRadius));
+        rockShader.setFloat("stretch", (float)asteroidsShapeStretch);
+        renderSystem.drawInstanced(rockShader, RENDER_ROCKS);
         
         // Render Light Source
         lightSourceShader.use();
         lightSourceShader.setMat4("projection", projection);
+        lightSourceShader.setVec2("logDepth", logDepth);
         lightSourceShader.setMat4("view", view);
 
-        // Rendering the sun
-        sun.updatePosition();
-        sun.draw(lightSourceShader);
-
-        // Rendering the stars backgound
-        for (unsigned int i = 0; i < starsAmount; i++) {
-            stars[i].updatePosition();
-            stars[i].draw(lightSourceShader);
-        }
+        // Rendering the sun and the stars backgound
+        renderSystem.draw(lightSourceShader, RENDER_EMISSIVE);
 
         // GLFW: Swap Buffers and poll IO events (keys pressed/released, mouse moved etc.)
         glfwSwapBuffers(window);
         glfwPollEvents();
+        if (!firstFrameReported) {
+            std::cout << "First frame " << std::chrono::duration<double>(std::chrono::steady_clock::now() - processStart).count() << " s after start" << (sequentialLoad ? " (sequential load)" : "") << std::endl;
+            firstFrameReported = true;
+        }
+
+        // Free the GL objects of everything released this frame: models no body uses any more, textures no model uses, then the queued names
+        models.collect();
+        TextureCache::global().collect();
+        GLDeletionQueue::global().drain();
     }
 
-    delete[] stars;
-    delete[] asteroids;
+    recorder.close();
+    stateReplay = NULL;
+
 
     // GLFW: Terminate, clearing all previously allocated GLFW recourses
     glfwTerminate();
     return 0;
 }
 
+/* Integrates the sun, Venus, the Earth and the Moon for the given number of simulated days and stores their orbits as an
+   ephemeris file, sampling each Chebyshev segment at its nodes */
+int bakeEphemeris(const std::string& path, const double days)
+{
+    World world;
+    const Entity sun = createCentralBody(world, ModelHandle(), Point3D{ 0, 0, 0 }, sunSize, RENDER_EMISSIVE);
+    const Entity venus = createOrbitingBody(world, ModelHandle(), sun, venusRadius, venusVelocity, venusSpinningVelocity, venusSize, 0, true);
+    const Entity earth = createOrbitingBody(world, ModelHandle(), sun, earthRadius, earthVelocity, earthSpinningVelocity, earthSize, 0, true);
+    const Entity moon = createOrbitingBody(world, ModelHandle(), earth, moonRadius, moonVelocity, moonSpinningVelocity, moonSize, 0, true);
+
+    const double stepsPerDay = (2.0 * glm::pi<double>() / world.get<Orbit>(earth).angularVelocity) / 365.25;
+    TimeWarp warp(world, simulationStepsPerSecond, stepsPerDay);
+
+    // The Moon is the fastest body, its orbit sets the segment length
+    const double segmentLength = 2.0 * glm::pi<double>() / world.get<Orbit>(moon).angularVelocity / ephemerisSegmentsPerMoonOrbit;
+    const unsigned int segmentCount = (unsigned int)std::max(1.0, std::ceil(days * stepsPerDay / segmentLength));
+
+    EphemerisWriter writer(0.0, segmentLength, ephemerisCoefficients, segmentCount);
+    const unsigned int sunBody = writer.addBody("Sun");
+    const unsigned int venusBody = writer.addBody("Venus", sunBody);
+    const unsigned int earthBody = writer.addBody("Earth", sunBody);
+    const unsigned int moonBody = writer.addBody("Moon", earthBody);
+
+    const Entity bodies[] = { sun, venus, earth, moon };
+    const unsigned int bodyIndices[] = { sunBody, venusBody, earthBody, moonBody };
+    const unsigned int bodiesAmount = sizeof(bodies) / sizeof(bodies[0]);
+
+    std::vector<Point3D> samples((size_t)bodiesAmount * ephemerisCoefficients);
+    for (unsigned int segment = 0; segment < segmentCount; segment++) {
+        for (unsigned int node = 0; node < ephemerisCoefficients; node++) {
+            // The sub-step budget may cut a step short, keep stepping until the node is reached
+            const double nodeEpoch = writer.nodeEpoch(segment, node);
+            while (warp.getSimulationTime() < nodeEpoch)
+                if (warp.advanceSteps(nodeEpoch - warp.getSimulationTime()) <= 0.0) break;
+
+            // Positions relative to the parent are exactly the orbit positions (the sun, the root, has none and stays put)
+            for (unsigned int b = 0; b < bodiesAmount; b++)
+                samples[(size_t)b * ephemerisCoefficients + node] = world.has<Orbit>(bodies[b]) ? world.get<Orbit>(bodies[b]).position : world.get<Transform>(bodies[b]).position;
+        }
+
+        for (unsigned int b = 0; b < bodiesAmount; b++)
+            writer.setSegment(bodyIndices[b], segment, &samples[(size_t)b * ephemerisCoefficients]);
+    }
+
+    if (!writer.write(path)) return -1;
+
+    std::cout << "Baked " << days << " days (" << segmentCount << " segments of " << segmentLength << " steps) into " << path << std::endl;
+    return 0;
+}
+
+/* Runs the mesh import stage over every model file under a directory, without a window, and prints what welding and
+   reordering do to each asset: vertex counts and ACMR before and after */
+int reportMeshOptimization(const std::string& root)
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(root, error)) {
+        std::cout << "ERROR::MESH_STATS:: " << root << " is not a directory" << std::endl;
+        return -1;
+    }
+
+    Assimp::Importer importer;
+    MeshOptimizationStats total;
+    unsigned int assets = 0;
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (std::filesystem::recursive_directory_iterator entry(root, error), end; !error && entry != end; entry.increment(error)) {
+        const std::string extension = entry->path().extension().string();
+        if (!entry->is_regular_file(error) || extension.empty() || !importer.IsExtensionSupported(extension)) continue;
+
+        const std::string path = entry->path().generic_string();
+        const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) {
+            std::cout << "ERROR::ASSIMP:: " << path << ": " << importer.GetErrorString() << std::endl;
+            continue;
+        }
+
+        const unsigned int meshCount = scene->mNumMeshes;
+        MeshOptimizationStats stats;
+        for (unsigned int i = 0; i < meshCount; i++) {
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            extractMeshGeometry(scene->mMeshes[i], vertices, indices);
+            stats.add(optimizeMesh(vertices, indices));
+        }
+        importer.FreeScene();
+
+        std::cout << path << ": " << meshCount << " meshes, " << stats.triangles << " triangles, vertices " << stats.verticesBefore << " -> " << stats.verticesAfter
+            << ", ACMR " << stats.acmrBefore << " -> " << stats.acmrAfter << std::endl;
+        total.add(stats);
+        assets++;
+    }
+
+    std::cout << assets << " assets, " << total.triangles << " triangles, vertices " << total.verticesBefore << " -> " << total.verticesAfter
+        << ", ACMR " << total.acmrBefore << " -> " << total.acmrAfter << std::endl;
+    return 0;
+}
+
+/* Imports every OBJ file under a directory through ASSIMP and through the native parser, without a window, and prints the best of
+   three times of each and the throughput in MB/s. Both read the file and build the same triangles with normals and tangents */
+int benchmarkObjImport(const std::string& root)
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(root, error)) {
+        std::cout << "ERROR::OBJ_BENCHMARK:: " << root << " is not a directory" << std::endl;
+        return -1;
+    }
+
+    const unsigned int runs = 3;
+    double assimpTotal = 0.0, nativeTotal = 0.0, megabytes = 0.0;
+    Assimp::Importer importer;
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (std::filesystem::recursive_directory_iterator entry(root, error), end; !error && entry != end; entry.increment(error)) {
+        std::string extension = entry->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        if (!entry->is_regular_file(error) || extension != ".obj") continue;
+
+        const std::string path = entry->path().generic_string();
+        const double size = entry->file_size(error) / (1024.0 * 1024.0);
+        double assimpBest = 0.0, nativeBest = 0.0;
+        bool imported = true;
+
+        for (unsigned int run = 0; run < runs && imported; run++) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            imported = importer.ReadFile(path, MODEL_IMPORT_FLAGS) != NULL;
+            importer.FreeScene();
+            const double assimpTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            ObjModel model;
+            imported = importObj(path, true, model) && imported;
+            const double nativeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (run == 0 || assimpTime < assimpBest) assimpBest = assimpTime;
+            if (run == 0 || nativeTime < nativeBest) nativeBest = nativeTime;
+        }
+        if (!imported) {
+            std::cout << "ERROR::OBJ_BENCHMARK:: cannot import " << path << std::endl;
+            continue;
+        }
+
+        std::cout << path << ": " << size << " MB, ASSIMP " << assimpBest * 1000.0 << " ms (" << size / assimpBest << " MB/s), native "
+            << nativeBest * 1000.0 << " ms (" << size / nativeBest << " MB/s), " << assimpBest / nativeBest << "x" << std::endl;
+        assimpTotal += assimpBest;
+        nativeTotal += nativeBest;
+        megabytes += size;
+    }
+
+    if (nativeTotal > 0.0)
+        std::cout << megabytes << " MB of OBJ, ASSIMP " << megabytes / assimpTotal << " MB/s, native " << megabytes / nativeTotal << " MB/s on "
+            << ThreadPool::global().size() + 1 << " threads, " << assimpTotal / nativeTotal << "x" << std::endl;
+    return 0;
+}
+
+/* Times the three ways a model reaches the GPU at startup, for every model file under a directory, without a window: a cold import
+   (no cooked model, the source read from the disk), the cooked model read from the disk (the source evicted too, though a current
+   cooked model only needs its size and time), and the cooked model already in the page cache. Best of three runs each. The cooked blocks get copied out the way glBufferData copies them, so that every mapped page is
+   read. The models are cooked into a scratch directory, removed after */
+int benchmarkModelCache(const std::string& root)
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(root, error)) {
+        std::cout << "ERROR::MODEL_BENCHMARK:: " << root << " is not a directory" << std::endl;
+        return -1;
+    }
+
+    const std::string scratch = (std::filesystem::temp_directory_path(error) / "model-benchmark").generic_string();
+    const unsigned int runs = 3;
+    double coldTotal = 0.0, diskTotal = 0.0, warmTotal = 0.0;
+    bool evicted = true;
+    Assimp::Importer importer;
+    std::vector<unsigned char> staging;
+
+    // Imports the file the way the registry does, and reads the cooked blocks through like the upload would
+    const auto timeImport = [&](const std::string& path, ModelImport& import) {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        import = importModel(path, true, scratch);
+        if (import.cooked) {
+            staging.resize(import.cooked->getVertexBytes() + import.cooked->getIndexBytes());
+            std::memcpy(staging.data(), import.cooked->getVertexData(), import.cooked->getVertexBytes());
+            std::memcpy(staging.data() + import.cooked->getVertexBytes(), import.cooked->getIndexData(), import.cooked->getIndexBytes());
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (std::filesystem::recursive_directory_iterator entry(root, error), end; !error && entry != end; entry.increment(error)) {
+        const std::string extension = entry->path().extension().string();
+        if (!entry->is_regular_file(error) || extension.empty() || !importer.IsExtensionSupported(extension)) continue;
+
+        const std::string path = entry->path().generic_string();
+        const std::string cookedPath = cookedModelPath(scratch, path, cookedModelKey(MODEL_IMPORT_FLAGS, true));
+
+        double cold = 0.0, disk = 0.0, warm = 0.0;
+        size_t cookedBytes = 0;
+        bool cooked = true, native = false;
+        for (unsigned int run = 0; run < runs && cooked && !native; run++) {
+            ModelImport import;
+            std::filesystem::remove(cookedPath, error);
+            evicted = MappedFile::evict(path) && evicted;
+            const double time = timeImport(path, import);
+            cold = run == 0 ? time : std::min(cold, time);
+            cooked = import.cooked != NULL;
+            native = import.gltf != NULL;
+            if (cooked) cookedBytes = import.cooked->getFileBytes();
+        }
+        if (native) { std::cout << path << ": drawn from its own glTF buffers, not cooked" << std::endl; continue; }
+        if (!cooked) { std::cout << "ERROR::MODEL_BENCHMARK:: cannot import and cook " << path << std::endl; continue; }
+
+        for (unsigned int run = 0; run < runs; run++) {
+            ModelImport import;
+            evicted = MappedFile::evict(cookedPath) && MappedFile::evict(path) && evicted;
+            const double time = timeImport(path, import);
+            disk = run == 0 ? time : std::min(disk, time);
+        }
+        for (unsigned int run = 0; run < runs; run++) {
+            ModelImport import;
+            const double time = timeImport(path, import);
+            warm = run == 0 ? time : std::min(warm, time);
+        }
+
+        std::cout << path << ": cold import " << cold << " ms, cooked from disk " << disk << " ms, cooked in page cache " << warm << " ms, "
+            << cookedBytes / 1024.0 << " KB cooked" << std::endl;
+        coldTotal += cold;
+        diskTotal += disk;
+        warmTotal += warm;
+    }
+    std::filesystem::remove_all(scratch, error);
+
+    std::cout << "Total: cold import " << coldTotal << " ms, cooked from disk " << diskTotal << " ms, cooked in page cache " << warmTotal << " ms" << std::endl;
+    if (!evicted) std::cout << "The OS kept some files in its page cache, the disk times above are partly page cache times" << std::endl;
+    return 0;
+}
+
+/* Cooks every image under a directory into the cooked texture cache, without a window, then the planet texture arrays, and prints
+   the format each one got, its video memory uncompressed and cooked, and how long it took. Textures already cooked with the
+   current settings are skipped */
+int cookTextures(const std::string& root)
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(root, error)) {
+        std::cout << "ERROR::COOK_TEXTURES:: " << root << " is not a directory" << std::endl;
+        return -1;
+    }
+
+    size_t uncompressedBytes = 0, cookedBytes = 0;
+    unsigned int cooked = 0, current = 0, failed = 0;
+
+    // Cooks one texture with the given function unless its cooked file is current already
+    const auto cookOne = [&](const std::string& name, const uint64_t hash, const TextureCookSettings& settings, const std::function<bool(const std::string&, CookedTextureStats*)>& cook) {
+        const std::string output = cookedTexturePath(cookedTextureDirectory, hash, settings);
+        CookedTexture existing;
+        if (existing.open(output, hash, settings)) { current++; return; }
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        CookedTextureStats stats;
+        if (!cook(output, &stats)) { std::cout << "ERROR::COOK_TEXTURES:: cannot cook " << name << std::endl; failed++; return; }
+        const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << name << ": " << cookedFormatName(stats.format) << ", " << stats.width << "x" << stats.height << ", " << stats.levels << " levels, "
+            << stats.uncompressedBytes / (1024.0 * 1024.0) << " MB -> " << stats.cookedBytes / (1024.0 * 1024.0) << " MB in " << milliseconds << " ms" << std::endl;
+        uncompressedBytes += stats.uncompressedBytes;
+        cookedBytes += stats.cookedBytes;
+        cooked++;
+    };
+
+    const auto cookFile = [&](const std::string& path, const TextureCookSettings& settings) {
+        MappedFile file;
+        if (!file.open(path)) { std::cout << "ERROR::COOK_TEXTURES:: cannot read " << path << std::endl; failed++; return; }
+
+        const uint64_t hash = contentHash(file.getData(), file.getSize());
+        cookOne(path, hash, settings, [&](const std::string& output, CookedTextureStats* stats) { return cookTexture(file.getData(), file.getSize(), hash, settings, output, stats); });
+    };
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (std::filesystem::recursive_directory_iterator entry(root, error), end; !error && entry != end; entry.increment(error)) {
+        std::string extension = entry->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        if (!entry->is_regular_file(error) || (extension != ".png" && extension != ".jpg" && extension != ".jpeg" && extension != ".tga" && extension != ".bmp")) continue;
+
+        cookFile(entry->path().generic_string(), TextureCookSettings());
+    }
+
+    // The planet texture arrays, the diffuse layers as they are and the surface masks packed
+    for (size_t i = 0; i < planetDiffuseFiles.size(); i++) cookFile(planetDiffuseFiles[i], planetTextureSettings(COOKED_BC1));
+    for (size_t i = 0; i < planetSurfaceSources.size(); i++) {
+        const PackedTextureSources& sources = planetSurfaceSources[i];
+        const TextureCookSettings settings = planetTextureSettings(COOKED_RGBA8);
+        MappedFile files[4];
+        uint64_t hash;
+        if (!openPackedSources(sources, files, hash)) { std::cout << "ERROR::COOK_TEXTURES:: cannot read the surface masks of planet layer " << i << std::endl; failed++; continue; }
+
+        cookOne("surface masks of planet layer " + std::to_string(i), hash, settings, [&](const std::string& output, CookedTextureStats* stats) {
+            std::vector<uint8_t> rgba;
+            unsigned int width, height;
+            return packTextureChannels(sources, files, settings, rgba, width, height) && cookImage(rgba, width, height, 4, hash, settings, output, stats);
+        });
+    }
+
+    std::cout << cooked << " textures cooked into " << cookedTextureDirectory << ", " << current << " already current, " << failed << " failed, video memory "
+        << uncompressedBytes / (1024.0 * 1024.0) << " MB -> " << cookedBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+    return failed == 0 ? 0 : -1;
+}
+
+/* How the planet texture arrays get cooked: resampled to the layer size, all in one format */
+TextureCookSettings planetTextureSettings(const CookedFormat format)
+{
+    TextureCookSettings settings;
+    settings.width = planetTextureWidth;
+    settings.height = planetTextureHeight;
+    settings.format = format;
+    return settings;
+}
+
 /* GLFW: Whenever the window size changed (by OS or user resize) this callback function executes */
 void processInput(GLFWwindow* window)
 {
@@ -287,9 +896,18 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) camera.ProcessKeyBoard(UP, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_LEFT_ALT) == GLFW_PRESS) camera.ProcessKeyBoard(DOWN, deltaTime);
 
-    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !AstronomicalObject::simulationPaused) { AstronomicalObject::simulationPaused = true; std::this_thread::sleep_for(std::chrono::milliseconds(200)); }
-    else if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && AstronomicalObject::simulationPaused) { AstronomicalObject::simulationPaused = false; std::this_thread::sleep_for(std::chrono::milliseconds(200)); }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && timeWarp != NULL) { timeWarp->setPaused(!timeWarp->isPaused()); std::this_thread::sleep_for(std::chrono::milliseconds(200)); }
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS) { TextureCache::global().reportResidency(); std::this_thread::sleep_for(std::chrono::milliseconds(200)); }
     
+    // Scrubbing through a replay
+    if (stateReplay != NULL) {
+        if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) replayFrame = std::min(replayFrame + replayScrubSpeed, (long long)stateReplay->getFrameCount() - 1);
+        if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) replayFrame = std::max(replayFrame - replayScrubSpeed, 0LL);
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS && timeWarp != NULL) { timeWarp->speedUp(); std::this_thread::sleep_for(std::chrono::milliseconds(200)); }
+    else if (glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS && timeWarp != NULL) { timeWarp->slowDown(); std::this_thread::sleep_for(std::chrono::milliseconds(200)); }
+
     if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && camera.MovementSpeed == SPEED) { camera.MovementSpeed = SLOWER_SPEED; std::this_thread::sleep_for(std::chrono::milliseconds(100)); }
     else if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && camera.MovementSpeed == SLOWER_SPEED) { camera.MovementSpeed = SPEED; std::this_thread::sleep_for(std::chrono::milliseconds(100)); }
 }
@@ -297,6 +915,8 @@ void processInput(GLFWwindow* window)
 /* GLFW: Whenever the window size changed (by OS or user resize) this callback function executes */
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
+    (void)window;
+
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
@@ -305,6 +925,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 /* GLFW: Whenever the mouse moves, this callback is called */
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
+    (void)window;
     float xpos = static_cast<float>(xposIn);
     float ypos = static_cast<float>(yposIn);
 
@@ -322,8 +943,6 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 /* GLFW: Whenever the mouse scroll wheel scrolls, this callback is called */
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
-    camera.ProcessMouseScroll(static_cast<float>(yoffset));
-}
-
+    (void)window; (void)xoffset;
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
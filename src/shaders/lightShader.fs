@@ -2,10 +2,13 @@
 out vec4 FragColor;
 
 in vec2 TexCoords;
+in float ViewDepth;
 
 uniform sampler2D texture_diffuse1;
+uniform vec2 logDepth; // Scale and bias turning log2 of the view depth into the [0, 1] depth range
 
 void main()
 {
 	FragColor = texture(texture_diffuse1, TexCoords);
+	gl_FragDepth = log2(ViewDepth) * logDepth.x + logDepth.y;
 }
\ No newline at end of file
@@ -3,6 +3,7 @@ layout (location = 0) in vec3 aPos;
 layout (location = 2) in vec2 aTexCoords;
 
 out vec2 TexCoords;
+out float ViewDepth; // Distance in front of the camera (clip w), for the logarithmic depth
 
 uniform mat4 model;
 uniform mat4 view;
@@ -12,4 +13,5 @@ void main()
 {
 	TexCoords = aTexCoords;
 	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	ViewDepth = gl_Position.w;
 }
\ No newline at end of file
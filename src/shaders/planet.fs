@@ -0,0 +1,67 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 FragPos;
+in vec3 Normal;
+flat in int Layer;
+flat in float Radius;
+in float ViewDepth;
+
+uniform sampler2DArray planetDiffuse; // One layer per planet
+uniform sampler2DArray planetSurface; // Packed masks: ocean in r, night lights in g, clouds in b, height in a
+
+uniform vec3 objectColor;
+uniform vec3 lightColor;
+uniform vec3 lightPos;
+uniform vec3 viewPos;
+uniform vec2 logDepth; // Scale and bias turning log2 of the view depth into the [0, 1] depth range
+
+uniform float reliefHeight; // Height of the full bump range, as a fraction of the radius
+
+// Tilts the normal along the screen space slope of the height (bump mapping without tangents, after Mikkelsen)
+vec3 perturbNormal(vec3 position, vec3 normal, float height)
+{
+    vec3 dpdx = dFdx(position);
+    vec3 dpdy = dFdy(position);
+    vec3 r1 = cross(dpdy, normal);
+    vec3 r2 = cross(normal, dpdx);
+    float determinant = dot(dpdx, r1);
+    vec3 gradient = sign(determinant) * (dFdx(height) * r1 + dFdy(height) * r2);
+    return normalize(abs(determinant) * normal - gradient);
+}
+
+void main()
+{
+    vec3 coordinates = vec3(TexCoords, float(Layer));
+    vec4 albedo = texture(planetDiffuse, coordinates);
+    vec4 surface = texture(planetSurface, coordinates);
+    float ocean = surface.r;
+    float lights = surface.g;
+    float clouds = surface.b;
+
+    vec3 sphereNormal = normalize(Normal);
+    vec3 norm = perturbNormal(FragPos, sphereNormal, surface.a * reliefHeight * Radius);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 viewDir = normalize(viewPos - FragPos);
+
+    // Diffuse, on the bumped ground
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 ground = albedo.rgb * diff * lightColor;
+
+    // Specular, sharp on the oceans and faint on land
+    float specularStrength = mix(0.05, 0.6, ocean);
+    vec3 reflectDir = reflect(-lightDir, mix(norm, sphereNormal, ocean));
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), mix(16.0, 64.0, ocean));
+    ground += specularStrength * spec * lightColor;
+
+    // Night lights, fading in past the terminator
+    float night = 1.0 - smoothstep(-0.15, 0.1, dot(sphereNormal, lightDir));
+    ground += lights * night * vec3(1.0, 0.8, 0.55);
+
+    // Clouds over everything, lit on the smooth sphere
+    vec3 cloudColor = max(dot(sphereNormal, lightDir), 0.0) * lightColor;
+    vec3 result = mix(ground, cloudColor, clouds) * objectColor;
+    FragColor = vec4(result, albedo.a);
+    gl_FragDepth = log2(ViewDepth) * logDepth.x + logDepth.y;
+}
@@ -0,0 +1,41 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aNormal; // Octahedral encoded unit normal in xy
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 4) in mat4 aModel;  // Per instance: model matrix, relative to the camera
+layout (location = 9) in uint aLayer;  // Per instance: the planet's layer of the texture arrays
+
+out vec2 TexCoords;
+out vec3 FragPos;
+out vec3 Normal;
+flat out int Layer;
+flat out float Radius; // Of the planet, in camera-relative units
+out float ViewDepth; // Distance in front of the camera (clip w), for the logarithmic depth
+
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform bool instanced; // False for single draws (the terrain), which take the model matrix and layer from the uniforms
+uniform mat4 model;
+uniform int layer;
+
+// Unfolds an octahedral encoded unit vector
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec3 vector = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (vector.z < 0.0) vector.xy = (1.0 - abs(vector.yx)) * vec2(vector.x >= 0.0 ? 1.0 : -1.0, vector.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(vector);
+}
+
+void main()
+{
+    mat4 modelMatrix = instanced ? aModel : model;
+    Layer = instanced ? int(aLayer) : layer;
+    Radius = length(modelMatrix[0].xyz);
+
+    TexCoords = aTexCoords;
+    FragPos = vec3(modelMatrix * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(modelMatrix))) * octahedralDecode(aNormal.xy);
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+    ViewDepth = gl_Position.w;
+}
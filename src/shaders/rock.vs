@@ -0,0 +1,80 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aNormal; // Octahedral encoded unit normal in xy
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 4) in mat4 aModel;  // Per instance: model matrix, relative to the camera
+layout (location = 8) in uint aSeed;   // Per instance: seed of the rock's shape
+
+out vec2 TexCoords;
+out vec3 FragPos;
+out vec3 Normal;
+out float ViewDepth; // Distance in front of the camera (clip w), for the logarithmic depth
+
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform float displacement;   // Largest bump along the normal, in model units
+uniform float noiseFrequency; // Bumps per model unit
+uniform float stretch;        // Largest squash or stretch along each axis, as a fraction
+
+// Unfolds an octahedral encoded unit vector
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec3 vector = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (vector.z < 0.0) vector.xy = (1.0 - abs(vector.yx)) * vec2(vector.x >= 0.0 ? 1.0 : -1.0, vector.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(vector);
+}
+
+// Integer hash (lowbias32), the same seed always gives the same rock
+uint hash(uint x)
+{
+    x ^= x >> 16u; x *= 0x7feb352du;
+    x ^= x >> 15u; x *= 0x846ca68bu;
+    x ^= x >> 16u;
+    return x;
+}
+
+float unitFloat(uint x) { return float(x >> 8u) * (1.0 / 16777216.0); } // [0, 1)
+
+// Value noise in [-1, 1]: random values on the integer lattice of the seed's own noise field, smoothly interpolated
+float latticeValue(ivec3 cell) { return unitFloat(hash(uint(cell.x) ^ hash(uint(cell.y) ^ hash(uint(cell.z) ^ aSeed)))) * 2.0 - 1.0; }
+
+float valueNoise(vec3 p)
+{
+    ivec3 cell = ivec3(floor(p));
+    vec3 f = fract(p);
+    vec3 w = f * f * f * (f * (f * 6.0 - 15.0) + 10.0); // Quintic fade, continuous normals across cells
+
+    float x00 = mix(latticeValue(cell), latticeValue(cell + ivec3(1, 0, 0)), w.x);
+    float x10 = mix(latticeValue(cell + ivec3(0, 1, 0)), latticeValue(cell + ivec3(1, 1, 0)), w.x);
+    float x01 = mix(latticeValue(cell + ivec3(0, 0, 1)), latticeValue(cell + ivec3(1, 0, 1)), w.x);
+    float x11 = mix(latticeValue(cell + ivec3(0, 1, 1)), latticeValue(cell + ivec3(1, 1, 1)), w.x);
+    return mix(mix(x00, x10, w.y), mix(x01, x11, w.y), w.z);
+}
+
+// Two octaves: big lumps that change the silhouette, smaller ones on top. Shifted away from the origin, so the lattice stays positive
+float shapeNoise(vec3 p) { return (valueNoise(p + 512.0) + 0.35 * valueNoise(2.03 * p + 529.0)) / 1.35; }
+
+// The instance's rock: the shared mesh bumped along its normals, then squashed or stretched per axis
+vec3 shapePoint(vec3 position, vec3 normal, vec3 scale) { return scale * (position + normal * displacement * shapeNoise(position * noiseFrequency)); }
+
+void main()
+{
+    vec3 scale = 1.0 + stretch * (vec3(unitFloat(hash(aSeed ^ 0x68e31da4u)), unitFloat(hash(aSeed ^ 0xb5297a4du)), unitFloat(hash(aSeed ^ 0x1b56c4e9u))) * 2.0 - 1.0);
+
+    vec3 normal = octahedralDecode(aNormal.xy);
+    vec3 position = shapePoint(aPos, normal, scale);
+
+    // The new normal, from two nearby points of the displaced surface: tangent x bitangent = normal keeps it facing out
+    vec3 tangent = normalize(cross(normal, abs(normal.x) > 0.9 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+    vec3 bitangent = cross(normal, tangent);
+    float epsilon = 0.05 / noiseFrequency;
+    vec3 alongTangent = shapePoint(aPos + tangent * epsilon, normal, scale) - position;
+    vec3 alongBitangent = shapePoint(aPos + bitangent * epsilon, normal, scale) - position;
+
+    TexCoords = aTexCoords;
+    FragPos = vec3(aModel * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(aModel))) * normalize(cross(alongTangent, alongBitangent));
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+    ViewDepth = gl_Position.w;
+}
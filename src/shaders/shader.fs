@@ -4,6 +4,7 @@ out vec4 FragColor;
 in vec2 TexCoords;
 in vec3 FragPos;
 in vec3 Normal;
+in float ViewDepth;
 
 uniform sampler2D texture_diffuse1;
 
@@ -11,6 +12,7 @@ uniform vec3 objectColor;
 uniform vec3 lightColor;
 uniform vec3 lightPos;
 uniform vec3 viewPos;
+uniform vec2 logDepth; // Scale and bias turning log2 of the view depth into the [0, 1] depth range
 
 void main()
 {    
@@ -33,4 +35,5 @@ void main()
 
     vec3 result = (ambient + diffuse + specular) * objectColor;
     FragColor = texture(texture_diffuse1, TexCoords) * vec4(result, 1.0);
+    gl_FragDepth = log2(ViewDepth) * logDepth.x + logDepth.y;
 }
\ No newline at end of file
@@ -1,20 +1,37 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec4 aNormal; // Octahedral encoded unit normal in xy (w = 0), or a plain normal from a glTF file (w = 1)
 layout (location = 2) in vec2 aTexCoords;
 
 out vec2 TexCoords;
 out vec3 FragPos;
 out vec3 Normal;
+out float ViewDepth; // Distance in front of the camera (clip w), for the logarithmic depth
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Unfolds an octahedral encoded unit vector
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec3 vector = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (vector.z < 0.0) vector.xy = (1.0 - abs(vector.yx)) * vec2(vector.x >= 0.0 ? 1.0 : -1.0, vector.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(vector);
+}
+
+// A normal fetched from three components gets w = 1, the packed ones store w = 0: which reads back as 0 or 1/3 depending on the
+// snorm rule of the GL version, so the test is against the middle
+vec3 decodeNormal(vec4 normal)
+{
+    return normal.w > 0.5 ? normalize(normal.xyz) : octahedralDecode(normal.xy);
+}
+
 void main()
 {
     TexCoords = aTexCoords;    
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = mat3(transpose(inverse(model))) * decodeNormal(aNormal);
     gl_Position = projection * view * vec4(FragPos, 1.0);
+    ViewDepth = gl_Position.w;
 }
\ No newline at end of file
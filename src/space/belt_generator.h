@@ -0,0 +1,177 @@
+/* Filename: belt_generator.h */
+
+#ifndef BELT_GENERATOR_HEADER
+#define BELT_GENERATOR_HEADER
+
+#include <thread_pool.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "components.h"
+#include "counter_rng.h"
+
+/* A resonance gap in the belt: the density around the given distance is cut down by depth (0 none, 1 empty) */
+typedef struct KirkwoodGap {
+	double distance, width, depth;
+} KirkwoodGap;
+
+/* The density profile of an asteroid belt */
+typedef struct BeltProfile {
+	double innerRadius, outerRadius;         // Distance range from the orbit object
+	double radialExponent;                   // Surface density falls off as distance^-radialExponent (1 keeps the distance uniform)
+	std::vector<KirkwoodGap> gaps;           // Resonance gaps carved out of the belt
+	double inclinationSpread;                // Standard deviation of the orbit inclination, in radians
+	double minSize, maxSize, sizeExponent;   // Sizes follow a power law dN/dD ~ D^-sizeExponent between minSize and maxSize
+	double minVelocity, maxVelocity;         // Orbital velocity range
+	double minSpinningVelocity, maxSpinningVelocity;
+	double minOrientation, maxOrientation;
+} BeltProfile;
+
+/* One generated asteroid, ready to become an Astronomical Object */
+typedef struct BeltBody {
+	double distance, elevation, startOffset;
+	double orientationX, orientationY, orientationZ;
+	double size, velocity, spinningVelocity;
+	uint32_t shapeSeed; // Seed of the procedural shape variation the rock shader applies
+} BeltBody;
+
+/* Inverse CDF sampler of a power law density x^-exponent truncated to [min, max]. The constants are worked out once, so that a
+   sample costs at most one pow */
+typedef struct PowerLawSampler {
+	double min, low, span, inversePower;
+	int kind; // 0 uniform, 1 log-uniform, 2 general power law
+
+	PowerLawSampler(const double min, const double max, const double exponent);
+	double inline sample(const double u) const;
+} PowerLawSampler;
+
+PowerLawSampler::PowerLawSampler(const double min, const double max, const double exponent)
+{
+	this->min = min;
+	this->inversePower = 1.0;
+
+	if (std::fabs(exponent) < 1e-9) { this->kind = 0; this->low = min; this->span = max - min; }
+	else if (std::fabs(exponent - 1.0) < 1e-9) { this->kind = 1; this->low = 0.0; this->span = std::log(max / min); }
+	else {
+		const double power = 1.0 - exponent;
+		this->kind = 2;
+		this->low = std::pow(min, power);
+		this->span = std::pow(max, power) - this->low;
+		this->inversePower = 1.0 / power;
+	}
+}
+
+double PowerLawSampler::sample(const double u) const
+{
+	if (this->kind == 0) return this->low + u * this->span;
+	if (this->kind == 1) return this->min * std::exp(u * this->span);
+	return std::pow(this->low + u * this->span, this->inversePower);
+}
+
+/* Class that procedurally generates asteroid belts and star fields. Each object is built only from (seed, index), so the
+   generation runs in parallel and the same seed always gives the same sky */
+class BeltGenerator {
+private:
+	static const unsigned int CHUNK_SIZE = 4096;
+	static const unsigned int MAX_GAP_ATTEMPTS = 8; // Distance redraws before a body is accepted inside a gap anyway
+
+	CounterRng rng;
+
+	// Streams: which random block of an object a value comes from
+	enum { STREAM_SHAPE = 0, STREAM_MOTION = 1, STREAM_SPIN = 2, STREAM_STAR = 3, STREAM_VARIATION = 4, STREAM_DISTANCE = 16 };
+
+	double sampleDistance(const BeltProfile& profile, const PowerLawSampler& distances, const uint64_t index) const;
+	BeltBody generateBody(const BeltProfile& profile, const PowerLawSampler& distances, const PowerLawSampler& sizes, const uint64_t index) const;
+
+public:
+	BeltGenerator(const uint64_t seed) : rng(seed) {}
+
+	void generateBelt(const BeltProfile& profile, const size_t count, std::vector<BeltBody>& bodies) const;
+	void generateStarField(const double radius, const size_t count, std::vector<Point3D>& positions) const;
+};
+
+/* Draws a distance from the radial profile, redrawing (from the next stream) whenever a gap rejects it */
+double BeltGenerator::sampleDistance(const BeltProfile& profile, const PowerLawSampler& distances, const uint64_t index) const
+{
+	double distance = profile.innerRadius;
+
+	for (unsigned int attempt = 0; attempt < MAX_GAP_ATTEMPTS; attempt++) {
+		const RandomBlock random = this->rng.block(index, STREAM_DISTANCE + attempt);
+		distance = distances.sample(random.unit(0));
+
+		double keep = 1.0;
+		for (size_t g = 0; g < profile.gaps.size(); g++) {
+			const double offset = (distance - profile.gaps[g].distance) / profile.gaps[g].width;
+			if (offset * offset < 36.0) keep *= 1.0 - profile.gaps[g].depth * std::exp(-0.5 * offset * offset); // Further than 6 widths a gap has no effect
+		}
+
+		if (random.unit(1) < keep) break;
+	}
+
+	return distance;
+}
+
+/* Generates asteroid number index of a belt */
+BeltBody BeltGenerator::generateBody(const BeltProfile& profile, const PowerLawSampler& distances, const PowerLawSampler& sizes, const uint64_t index) const
+{
+	const RandomBlock shape = this->rng.block(index, STREAM_SHAPE);
+	const RandomBlock motion = this->rng.block(index, STREAM_MOTION);
+	BeltBody body;
+
+	body.distance = this->sampleDistance(profile, distances, index);
+
+	// Gaussian inclination (Box-Muller), turned into a height above the orbit plane at that distance
+	const double gaussian = std::sqrt(-2.0 * std::log(1.0 - motion.unit(0))) * std::cos(2.0 * 3.14159265358979323846 * motion.unit(1));
+	body.elevation = body.distance * std::tan(gaussian * profile.inclinationSpread);
+
+	body.startOffset = motion.range(2, 0.0, 360.0);
+	body.velocity = motion.range(3, profile.minVelocity, profile.maxVelocity);
+
+	body.orientationX = shape.range(0, profile.minOrientation, profile.maxOrientation);
+	body.orientationY = shape.range(1, profile.minOrientation, profile.maxOrientation);
+	body.orientationZ = shape.range(2, profile.minOrientation, profile.maxOrientation);
+
+	body.size = sizes.sample(shape.unit(3));
+	body.spinningVelocity = this->rng.block(index, STREAM_SPIN).range(0, profile.minSpinningVelocity, profile.maxSpinningVelocity);
+	body.shapeSeed = this->rng.block(index, STREAM_VARIATION).words[0];
+
+	return body;
+}
+
+/* Generates a whole belt in parallel */
+void BeltGenerator::generateBelt(const BeltProfile& profile, const size_t count, std::vector<BeltBody>& bodies) const
+{
+	bodies.resize(count);
+
+	// Over the belt's surface dN ~ r * r^-radialExponent dr
+	const PowerLawSampler distances(profile.innerRadius, profile.outerRadius, profile.radialExponent - 1.0);
+	const PowerLawSampler sizes(profile.minSize, profile.maxSize, profile.sizeExponent);
+
+	ThreadPool::global().parallelFor(count, CHUNK_SIZE, [this, &profile, &distances, &sizes, &bodies](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) bodies[i] = this->generateBody(profile, distances, sizes, i);
+	});
+}
+
+/* Generates stars spread uniformly over a sphere of the given radius, in parallel */
+void BeltGenerator::generateStarField(const double radius, const size_t count, std::vector<Point3D>& positions) const
+{
+	positions.resize(count);
+
+	ThreadPool::global().parallelFor(count, CHUNK_SIZE, [this, radius, &positions](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const RandomBlock random = this->rng.block(i, STREAM_STAR);
+
+			const double z = random.range(0, -1.0, 1.0);
+			const double phi = random.range(1, 0.0, 2.0 * 3.14159265358979323846);
+			const double ring = std::sqrt(1.0 - z * z);
+
+			positions[i].x = radius * ring * std::cos(phi);
+			positions[i].y = radius * ring * std::sin(phi);
+			positions[i].z = radius * z;
+		}
+	});
+}
+
+#endif /* BELT_GENERATOR_HEADER */
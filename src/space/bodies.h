@@ -0,0 +1,88 @@
+/* Filename: bodies.h */
+
+#ifndef BODIES_HEADER
+#define BODIES_HEADER
+
+#include <cmath>
+
+#include "world.h"
+
+/* The component sets of the kinds of objects in the scene */
+static const ComponentMask CENTRAL_BODY_COMPONENTS = ComponentMaskOf<Transform, Spin, Renderable, Collider>::value;
+static const ComponentMask ORBITING_BODY_COMPONENTS = ComponentMaskOf<Transform, Orbit, Spin, Renderable, Parent, Collider>::value;
+static const ComponentMask BACKGROUND_STAR_COMPONENTS = ComponentMaskOf<Transform, Renderable, StaticTag>::value;
+
+/* Creates the root of a hierarchy (the sun): it does not orbit anything and stays at the given position */
+Entity createCentralBody(World& world, const ModelHandle& model, const Point3D& position, const double scaleFactor, const RenderPass pass)
+{
+	const Entity entity = world.create(CENTRAL_BODY_COMPONENTS);
+
+	Transform& transform = world.get<Transform>(entity);
+	transform.position = position;
+	transform.scale = scaleFactor;
+
+	Renderable& renderable = world.get<Renderable>(entity);
+	renderable.model = model;
+	renderable.pass = pass;
+
+	Collider& collider = world.get<Collider>(entity);
+	collider.radius = model ? model->BoundingRadius : 0.0;
+	collider.obstacle = true;
+
+	return entity;
+}
+
+/* Puts an orbit at angle theta of its starting circular orbit, moving at the circular orbit's speed */
+void placeOnOrbit(Orbit& orbit, const double theta)
+{
+	const double speed = orbit.distance * orbit.angularVelocity;
+	orbit.position.x = orbit.distance * cos(theta);
+	orbit.position.z = orbit.distance * sin(theta);
+	orbit.velocity = { -speed * sin(theta), 0.0, speed * cos(theta) };
+}
+
+/* Creates a body on a circular orbit around its parent. The velocity is the square root of the angular velocity in radians per
+   simulation step, and startOffset moves the body along its orbit by startOffset * velocity radians. Obstacles (planets)
+   take part in collisions without being moved by them */
+Entity createOrbitingBody(World& world, const ModelHandle& model, const Entity parent, const double distanceFromParent, const double velocity, const double spinningVelocity, const double scaleFactor, const double startOffset, const bool obstacle)
+{
+	const unsigned int parentDepth = world.has<Parent>(parent) ? world.get<Parent>(parent).depth : 0;
+	const Entity entity = world.create(ORBITING_BODY_COMPONENTS);
+
+	world.get<Transform>(entity).scale = scaleFactor;
+
+	// Start on a circular orbit: the pull of the parent is whatever keeps a body at this radius moving at this angular velocity
+	Orbit& orbit = world.get<Orbit>(entity);
+	orbit.distance = distanceFromParent;
+	orbit.angularVelocity = velocity * velocity;
+	orbit.gravitationalParameter = orbit.angularVelocity * orbit.angularVelocity * distanceFromParent * distanceFromParent * distanceFromParent;
+	placeOnOrbit(orbit, startOffset * velocity);
+
+	world.get<Spin>(entity).velocity = spinningVelocity;
+	world.get<Renderable>(entity).model = model;
+	world.get<Parent>(entity) = Parent{ parent, parentDepth + 1 };
+
+	Collider& collider = world.get<Collider>(entity);
+	collider.radius = model ? model->BoundingRadius : 0.0;
+	collider.obstacle = obstacle;
+
+	return entity;
+}
+
+/* Creates a background star, fixed at the given world position */
+Entity createBackgroundStar(World& world, const ModelHandle& model, const Point3D& position, const double scaleFactor)
+{
+	const Entity entity = world.create(BACKGROUND_STAR_COMPONENTS);
+
+	Transform& transform = world.get<Transform>(entity);
+	transform.position = position;
+	transform.scale = scaleFactor;
+
+	Renderable& renderable = world.get<Renderable>(entity);
+	renderable.model = model;
+	renderable.pass = RENDER_EMISSIVE;
+
+	return entity;
+}
+
+#endif /* BODIES_HEADER */
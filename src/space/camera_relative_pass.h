@@ -0,0 +1,59 @@
+/* Filename: camera_relative_pass.h */
+
+#ifndef CAMERA_RELATIVE_PASS_HEADER
+#define CAMERA_RELATIVE_PASS_HEADER
+
+#include <thread_pool.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "world.h"
+
+/* Class that turns the double precision world Transform of every Renderable entity into a float model matrix relative to the
+   camera, once per frame and in one batch. The GPU then only ever sees small camera-relative numbers, so real solar system
+   distances render without jitter while the shaders stay in single precision */
+class CameraRelativePass {
+private:
+	static const unsigned int CHUNK_SIZE = 1024;
+
+	World& world;
+
+	void run(Archetype& archetype, const glm::dvec3& cameraPosition);
+
+public:
+	CameraRelativePass(World& world) : world(world) {}
+
+	void run(const glm::dvec3& cameraPosition);
+};
+
+/* Rebuilds the camera-relative model matrix of every Renderable entity */
+void CameraRelativePass::run(const glm::dvec3& cameraPosition)
+{
+	this->world.forEach(ComponentMaskOf<Transform, Renderable>::value, 0, [this, &cameraPosition](Archetype& archetype) { this->run(archetype, cameraPosition); });
+}
+
+/* Rebuilds the model matrices of one archetype. The subtraction happens in double precision, so only the small camera-relative
+   offset is ever rounded to float */
+void CameraRelativePass::run(Archetype& archetype, const glm::dvec3& cameraPosition)
+{
+	const Transform* transforms = archetype.column<Transform>();
+	Renderable* renderables = archetype.column<Renderable>();
+
+	ThreadPool::global().parallelFor(archetype.size(), CHUNK_SIZE, [transforms, renderables, &cameraPosition](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const Transform& transform = transforms[i];
+			const glm::vec3 offset((float)(transform.position.x - cameraPosition.x), (float)(transform.position.y - cameraPosition.y), (float)(transform.position.z - cameraPosition.z));
+			const float scale = (float)transform.scale;
+
+			// The models are flipped upside down (negative y scale), as they always have been
+			renderables[i].transformation = glm::translate(glm::mat4(1.0f), offset) * glm::scale(glm::mat4(1.0f), glm::vec3(scale, -scale, scale)) * glm::mat4_cast(transform.rotation);
+
+			// Models drawn from their files' vertices as they are (glTF) still need their node transform
+			const Model* model = renderables[i].model.get();
+			if (model != NULL && model->HasRootTransform) renderables[i].transformation *= model->RootTransform;
+		}
+	});
+}
+
+#endif /* CAMERA_RELATIVE_PASS_HEADER */
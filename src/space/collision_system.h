@@ -0,0 +1,345 @@
+/* Filename: collision_system.h */
+
+#ifndef COLLISION_SYSTEM_HEADER
+#define COLLISION_SYSTEM_HEADER
+
+#include <thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "world.h"
+
+/* The ways two touching bodies can react to each other */
+enum CollisionResponse { COLLISION_BOUNCE, COLLISION_MERGE };
+
+/* A pair of overlapping bounding spheres found during a frame */
+typedef struct Contact {
+	unsigned int first, second; // Collider indexes (the order in which the colliders were gathered)
+	bool againstObstacle;       // Whether second is an obstacle
+	double depth;               // How deep the two spheres overlap
+	Point3D normal;             // Unit vector pointing from first towards second
+} Contact;
+
+/* Class that finds and resolves collisions between many small bodies (asteroids) and a few big obstacles (planets). Every
+   entity with a Collider takes part: obstacles only push, orbiting non-obstacles get pushed */
+class CollisionSystem {
+private:
+	static const unsigned int CHUNK_SIZE = 1024; // Bodies handled by one parallel job
+
+	World& world;
+	double minCellSize;         // The grid cell is never smaller than this, even when every body is tiny
+	CollisionResponse response; // What happens to two bodies that touch
+
+	// Per-frame scratch storage (structure of arrays), kept between frames so that nothing gets reallocated once warmed up
+	std::vector<double> posX, posY, posZ, radius;     // Radius is 0 for colliders that do not go in the grid (obstacles, inactive bodies)
+	std::vector<Archetype*> owner;                   // Where each collider's components live
+	std::vector<uint32_t> ownerRow;
+	std::vector<std::vector<uint32_t>> chunkObstacles;
+	std::vector<uint32_t> obstacles;                 // Collider indexes of the active obstacles
+	std::vector<double> obstacleRadius;
+	std::vector<int32_t> cellX, cellY, cellZ;
+	std::vector<uint32_t> slotOfBody, slotStart, slotFill, sortedBodies;
+	std::vector<std::vector<Contact>> chunkContacts;
+	std::vector<size_t> chunkCandidates;
+	std::vector<double> chunkMaxRadius;
+
+	uint32_t tableMask;         // Spatial hash table size minus one (the size is a power of two)
+	size_t candidateCount, contactCount;
+
+	static inline uint32_t hashCell(const int32_t x, const int32_t y, const int32_t z, const uint32_t mask);
+	static void displace(Orbit& orbit, const double dx, const double dy, const double dz);
+
+	template<typename Component> Component inline& component(const uint32_t collider) { return this->owner[collider]->column<Component>()[this->ownerRow[collider]]; }
+
+	unsigned int gather(void);
+	void buildGrid(const unsigned int count);
+	void findContacts(const unsigned int count);
+	void respond(void);
+
+public:
+	CollisionSystem(World& world, const double minCellSize, const CollisionResponse response);
+
+	void resolve(void);
+
+	void inline setResponse(const CollisionResponse response) { this->response = response; }
+	size_t inline getCandidateCount(void) const { return this->candidateCount; } // Pairs that shared a neighbourhood in the last frame
+	size_t inline getContactCount(void) const { return this->contactCount; }     // Pairs that actually touched in the last frame
+};
+
+/* Collision System's Constructor */
+CollisionSystem::CollisionSystem(World& world, const double minCellSize, const CollisionResponse response) : world(world)
+{
+	this->minCellSize = minCellSize;
+	this->response = response;
+	this->tableMask = 0;
+	this->candidateCount = this->contactCount = 0;
+}
+
+/* Detects every touching pair among the bodies and between the bodies and the obstacles, then makes them react */
+void CollisionSystem::resolve(void)
+{
+	this->candidateCount = this->contactCount = 0;
+
+	const unsigned int count = this->gather();
+	if (count == 0) return;
+
+	this->buildGrid(count);
+	this->findContacts(count);
+	this->respond();
+}
+
+/* Maps a grid cell to a slot of the spatial hash table */
+uint32_t CollisionSystem::hashCell(const int32_t x, const int32_t y, const int32_t z, const uint32_t mask)
+{
+	return (((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)z * 83492791u)) & mask;
+}
+
+/* Gathers the bounding spheres of every collider (structure of arrays, in parallel) and lists the active obstacles. Returns the
+   number of colliders */
+unsigned int CollisionSystem::gather(void)
+{
+	ThreadPool& pool = ThreadPool::global();
+	unsigned int count = 0;
+
+	this->obstacles.clear(); this->obstacleRadius.clear();
+	this->chunkMaxRadius.clear();
+
+	this->world.forEach(ComponentMaskOf<Transform, Collider>::value, 0, [this, &pool, &count](Archetype& archetype) {
+		const size_t first = count, size = archetype.size(), chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		count += (unsigned int)size;
+
+		this->posX.resize(count); this->posY.resize(count); this->posZ.resize(count); this->radius.resize(count);
+		this->owner.resize(count); this->ownerRow.resize(count);
+		this->chunkObstacles.resize(chunks);
+
+		const size_t chunkBase = this->chunkMaxRadius.size();
+		this->chunkMaxRadius.resize(chunkBase + chunks, 0.0);
+
+		// Only orbiting bodies can be pushed around, anything else that collides acts as an obstacle
+		const Transform* transforms = archetype.column<Transform>();
+		const Collider* colliders = archetype.column<Collider>();
+		const bool movable = archetype.has<Orbit>() && archetype.has<Parent>();
+		Archetype* owner = &archetype;
+
+		// Inactive bodies and obstacles get a zero radius, and so never enter the grid
+		pool.parallelFor(size, CHUNK_SIZE, [this, transforms, colliders, movable, owner, first, chunkBase](size_t begin, size_t end) {
+			std::vector<uint32_t>& chunkObstacles = this->chunkObstacles[begin / CHUNK_SIZE];
+			double maxRadius = 0.0;
+			chunkObstacles.clear();
+
+			for (size_t row = begin; row < end; row++) {
+				const size_t i = first + row;
+				const Transform& transform = transforms[row];
+				const bool obstacle = colliders[row].obstacle || !movable;
+
+				this->posX[i] = transform.position.x; this->posY[i] = transform.position.y; this->posZ[i] = transform.position.z;
+				this->radius[i] = transform.active && !obstacle ? transform.scale * colliders[row].radius : 0.0;
+				this->owner[i] = owner; this->ownerRow[i] = (uint32_t)row;
+
+				if (transform.active && obstacle) chunkObstacles.push_back((uint32_t)i);
+				maxRadius = std::max(maxRadius, this->radius[i]);
+			}
+			this->chunkMaxRadius[chunkBase + begin / CHUNK_SIZE] = maxRadius;
+		});
+
+		for (size_t c = 0; c < chunks; c++)
+			for (size_t k = 0; k < this->chunkObstacles[c].size(); k++) {
+				const uint32_t i = this->chunkObstacles[c][k];
+				this->obstacles.push_back(i);
+				this->obstacleRadius.push_back(transforms[this->ownerRow[i]].scale * colliders[this->ownerRow[i]].radius);
+			}
+	});
+
+	return count;
+}
+
+/* Broadphase: bins every body into a uniform grid stored as a counting-sorted spatial hash */
+void CollisionSystem::buildGrid(const unsigned int count)
+{
+	ThreadPool& pool = ThreadPool::global();
+
+	this->cellX.resize(count); this->cellY.resize(count); this->cellZ.resize(count);
+	this->slotOfBody.resize(count); this->sortedBodies.resize(count);
+
+	// Merged bodies grow, so the cell always fits the largest body currently alive and neighbours stay one cell apart
+	double maxRadius = 0.0;
+	for (size_t c = 0; c < this->chunkMaxRadius.size(); c++) maxRadius = std::max(maxRadius, this->chunkMaxRadius[c]);
+	const double inverseCellSize = 1.0 / std::max(this->minCellSize, 2.0 * maxRadius);
+
+	uint32_t tableSize = 1;
+	while (tableSize < 2 * count) tableSize <<= 1;
+	const uint32_t mask = this->tableMask = tableSize - 1;
+
+	// 1. Compute each body's cell and hash slot
+	pool.parallelFor(count, CHUNK_SIZE, [this, inverseCellSize, mask](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			this->cellX[i] = (int32_t)std::floor(this->posX[i] * inverseCellSize);
+			this->cellY[i] = (int32_t)std::floor(this->posY[i] * inverseCellSize);
+			this->cellZ[i] = (int32_t)std::floor(this->posZ[i] * inverseCellSize);
+			this->slotOfBody[i] = hashCell(this->cellX[i], this->cellY[i], this->cellZ[i], mask);
+		}
+	});
+
+	// 2. Counting sort by slot, O(N): afterwards the bodies of slot s are sortedBodies[slotStart[s] .. slotStart[s + 1])
+	this->slotStart.assign(tableSize + 1, 0);
+	for (unsigned int i = 0; i < count; i++)
+		if (this->radius[i] > 0.0) this->slotStart[this->slotOfBody[i] + 1]++;
+
+	for (uint32_t s = 0; s < tableSize; s++) this->slotStart[s + 1] += this->slotStart[s];
+
+	this->slotFill.assign(this->slotStart.begin(), this->slotStart.end() - 1);
+	for (unsigned int i = 0; i < count; i++)
+		if (this->radius[i] > 0.0) this->sortedBodies[this->slotFill[this->slotOfBody[i]]++] = i;
+}
+
+/* Narrowphase: exact sphere tests against the 27 neighbouring cells of every body, and against every obstacle */
+void CollisionSystem::findContacts(const unsigned int count)
+{
+	const size_t chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	const uint32_t mask = this->tableMask;
+
+	this->chunkContacts.resize(chunks);
+	this->chunkCandidates.assign(chunks, 0);
+
+	ThreadPool::global().parallelFor(count, CHUNK_SIZE, [this, mask](size_t begin, size_t end) {
+		const size_t chunk = begin / CHUNK_SIZE;
+		std::vector<Contact>& contacts = this->chunkContacts[chunk];
+		size_t candidates = 0;
+		contacts.clear();
+
+		for (size_t i = begin; i < end; i++) {
+			if (this->radius[i] <= 0.0) continue;
+
+			for (int dx = -1; dx <= 1; dx++)
+			for (int dy = -1; dy <= 1; dy++)
+			for (int dz = -1; dz <= 1; dz++) {
+				const int32_t cx = this->cellX[i] + dx, cy = this->cellY[i] + dy, cz = this->cellZ[i] + dz;
+				const uint32_t slot = hashCell(cx, cy, cz, mask);
+
+				for (uint32_t k = this->slotStart[slot]; k < this->slotStart[slot + 1]; k++) {
+					const uint32_t j = this->sortedBodies[k];
+
+					// Every pair is reported once (by its lower index), and bodies that only share a hash slot are skipped
+					if (j <= i || this->cellX[j] != cx || this->cellY[j] != cy || this->cellZ[j] != cz) continue;
+					candidates++;
+
+					const double ox = this->posX[j] - this->posX[i], oy = this->posY[j] - this->posY[i], oz = this->posZ[j] - this->posZ[i];
+					const double reach = this->radius[i] + this->radius[j];
+					const double distanceSquared = ox * ox + oy * oy + oz * oz;
+					if (distanceSquared >= reach * reach) continue;
+
+					const double distance = std::sqrt(distanceSquared);
+					Contact contact = { (unsigned int)i, j, false, reach - distance, { 0.0, 1.0, 0.0 } };
+					if (distance > 0.0) contact.normal = { ox / distance, oy / distance, oz / distance };
+					contacts.push_back(contact);
+				}
+			}
+
+			// The obstacles are few and large, so they are tested directly instead of being put in the grid
+			for (size_t o = 0; o < this->obstacles.size(); o++) {
+				const uint32_t j = this->obstacles[o];
+				candidates++;
+
+				const double ox = this->posX[j] - this->posX[i], oy = this->posY[j] - this->posY[i], oz = this->posZ[j] - this->posZ[i];
+				const double reach = this->radius[i] + this->obstacleRadius[o];
+				const double distanceSquared = ox * ox + oy * oy + oz * oz;
+				if (distanceSquared >= reach * reach) continue;
+
+				const double distance = std::sqrt(distanceSquared);
+				Contact contact = { (unsigned int)i, j, true, reach - distance, { 0.0, 1.0, 0.0 } };
+				if (distance > 0.0) contact.normal = { ox / distance, oy / distance, oz / distance };
+				contacts.push_back(contact);
+			}
+		}
+
+		this->chunkCandidates[chunk] = candidates;
+	});
+
+	for (size_t c = 0; c < chunks; c++) {
+		this->candidateCount += this->chunkCandidates[c];
+		this->contactCount += this->chunkContacts[c].size();
+	}
+}
+
+/* Makes every touching pair react. Runs serially in chunk order, so the outcome does not depend on thread timing */
+void CollisionSystem::respond(void)
+{
+	for (size_t c = 0; c < this->chunkContacts.size(); c++)
+	for (size_t k = 0; k < this->chunkContacts[c].size(); k++) {
+		const Contact& contact = this->chunkContacts[c][k];
+		Transform& first = this->component<Transform>(contact.first);
+		Orbit& firstOrbit = this->component<Orbit>(contact.first);
+		if (!first.active) continue;
+
+		if (contact.againstObstacle) {
+			// A planet swallows the rock when merging, otherwise the rock gets pushed back out of the planet and its
+			// orbital velocity is mirrored about the contact plane (the planet's own motion is ignored)
+			if (this->response == COLLISION_MERGE) { first.active = false; continue; }
+
+			displace(firstOrbit, -contact.normal.x * contact.depth, -contact.normal.y * contact.depth, -contact.normal.z * contact.depth);
+
+			const double approachSpeed = firstOrbit.velocity.x * contact.normal.x + firstOrbit.velocity.z * contact.normal.z;
+			if (approachSpeed > 0.0) {
+				firstOrbit.velocity.x -= 2.0 * approachSpeed * contact.normal.x;
+				firstOrbit.velocity.z -= 2.0 * approachSpeed * contact.normal.z;
+			}
+			continue;
+		}
+
+		Transform& second = this->component<Transform>(contact.second);
+		Orbit& secondOrbit = this->component<Orbit>(contact.second);
+		if (!second.active) continue;
+
+		const bool sameParent = this->component<Parent>(contact.first).entity == this->component<Parent>(contact.second).entity;
+
+		// Every rock shares the same density, so the mass goes with the cube of the scale
+		const double firstMass = first.scale * first.scale * first.scale;
+		const double secondMass = second.scale * second.scale * second.scale;
+
+		if (this->response == COLLISION_MERGE) {
+			const bool firstSurvives = firstMass >= secondMass;
+			Transform& survivor = firstSurvives ? first : second;
+			Transform& absorbed = firstSurvives ? second : first;
+			Orbit& survivorOrbit = firstSurvives ? firstOrbit : secondOrbit;
+			const Orbit& absorbedOrbit = firstSurvives ? secondOrbit : firstOrbit;
+
+			// Keep the total volume, and the total momentum when both rocks move in the same frame
+			if (sameParent) {
+				const double survivorMass = std::max(firstMass, secondMass), absorbedMass = std::min(firstMass, secondMass);
+				survivorOrbit.velocity.x = (survivorMass * survivorOrbit.velocity.x + absorbedMass * absorbedOrbit.velocity.x) / (firstMass + secondMass);
+				survivorOrbit.velocity.z = (survivorMass * survivorOrbit.velocity.z + absorbedMass * absorbedOrbit.velocity.z) / (firstMass + secondMass);
+			}
+			survivor.scale = std::cbrt(firstMass + secondMass);
+			absorbed.active = false;
+			continue;
+		}
+
+		// Bounce: push the two rocks apart along the contact normal (the lighter one moves more), then
+		// exchange momentum along the normal as a perfectly elastic collision would
+		const double totalMass = firstMass + secondMass;
+		const double firstShare = contact.depth * secondMass / totalMass, secondShare = contact.depth * firstMass / totalMass;
+		displace(firstOrbit, -contact.normal.x * firstShare, -contact.normal.y * firstShare, -contact.normal.z * firstShare);
+		displace(secondOrbit, contact.normal.x * secondShare, contact.normal.y * secondShare, contact.normal.z * secondShare);
+
+		// Both rocks orbit the same object, so their orbital velocities share a frame and can be compared directly
+		const double closingSpeed = (secondOrbit.velocity.x - firstOrbit.velocity.x) * contact.normal.x + (secondOrbit.velocity.z - firstOrbit.velocity.z) * contact.normal.z;
+		if (!sameParent || closingSpeed >= 0.0) continue;
+
+		const double impulse = -2.0 * closingSpeed / (1.0 / firstMass + 1.0 / secondMass);
+		firstOrbit.velocity.x -= impulse / firstMass * contact.normal.x; firstOrbit.velocity.z -= impulse / firstMass * contact.normal.z;
+		secondOrbit.velocity.x += impulse / secondMass * contact.normal.x; secondOrbit.velocity.z += impulse / secondMass * contact.normal.z;
+	}
+}
+
+/* Moves a body by a world space offset. Every parent only translates its children, so the offset applies to the orbit position as is */
+void CollisionSystem::displace(Orbit& orbit, const double dx, const double dy, const double dz)
+{
+	orbit.position.x += dx;
+	orbit.position.y += dy;
+	orbit.position.z += dz;
+}
+
+#endif /* COLLISION_SYSTEM_HEADER */
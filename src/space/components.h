@@ -0,0 +1,81 @@
+/* Filename: components.h */
+
+#ifndef COMPONENTS_HEADER
+#define COMPONENTS_HEADER
+
+#include <model_registry.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+
+/* Structure that represents a point in the 3D world */
+typedef struct Point3D {
+	double x, y, z;
+} Point3D;
+
+/* Handle of an entity of the World. The generation tells a destroyed entity apart from a newer one reusing its index */
+typedef struct Entity {
+	uint32_t index, generation;
+} Entity;
+
+bool inline operator==(const Entity& first, const Entity& second) { return first.index == second.index && first.generation == second.generation; }
+bool inline operator!=(const Entity& first, const Entity& second) { return !(first == second); }
+
+/* The shader pass an entity is drawn in. RENDER_ROCKS is lit too, but drawn instanced with a procedural shape per instance.
+   RENDER_PLANETS are lit and instanced, each instance samples its own layer of the planet texture arrays */
+enum RenderPass { RENDER_LIT, RENDER_EMISSIVE, RENDER_ROCKS, RENDER_PLANETS };
+
+/* Where a body is in the 3D world */
+typedef struct Transform {
+	Point3D position{ 0, 0, 0 };                  // World coordinates, including every parent's offset (refreshed by the TransformSystem)
+	glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f }; // Spin and orientation
+	double scale = 1.0;
+	bool active = true;                           // Cleared when another body absorbs this one
+} Transform;
+
+/* Central force orbit around the Parent, integrated by the TimeWarp */
+typedef struct Orbit {
+	Point3D position{ 0, 0, 0 };    // Relative to the parent
+	Point3D velocity{ 0, 0, 0 };    // Relative to the parent (x and z only, the orbit plane), per simulation step
+	double gravitationalParameter = 0.0; // Pull of the parent, chosen so that the starting orbit is a circle of the requested radius and speed
+	double distance = 0.0;          // Radius of the starting circular orbit
+	double angularVelocity = 0.0;   // Radians per simulation step on the starting circular orbit
+	bool integrate = true;          // False when something else (an ephemeris) drives the orbit
+} Orbit;
+
+/* Rotation of a body around itself */
+typedef struct Spin {
+	double angle = 0.0, velocity = 0.0; // Current angle, and radians per simulation step
+	Point3D orientation{ 0, 0, 0 };     // Fixed rotation applied after the spin
+	bool fullSpin = false;              // Spin around every axis instead of y only
+} Spin;
+
+/* How a body gets drawn */
+typedef struct Renderable {
+	ModelHandle model;                // Shared with every body drawn with the same asset
+	RenderPass pass = RENDER_LIT;
+	glm::mat4 transformation{ 1.0f }; // Model matrix relative to the camera (refreshed by the CameraRelativePass)
+	bool visible = true;              // Cleared while something else draws the body (the TerrainSystem, up close)
+	uint32_t shapeSeed = 0;           // Drives the shape variation of RENDER_ROCKS instances
+	uint32_t textureLayer = 0;        // Layer of the texture arrays RENDER_PLANETS instances (and their terrain) sample
+} Renderable;
+
+/* Marks entities that never move (the background stars), which the simulation and the state log leave alone */
+typedef struct StaticTag {
+} StaticTag;
+
+/* The entity a body orbits */
+typedef struct Parent {
+	Entity entity{ 0, 0 };
+	unsigned int depth = 1; // How many parents stand between the body and the root of the hierarchy (planets 1, moons 2)
+} Parent;
+
+/* Bounding sphere used by the CollisionSystem */
+typedef struct Collider {
+	double radius = 0.0;   // At scale 1, the Transform's scale multiplies it
+	bool obstacle = false; // Obstacles (planets) push bodies away but never move themselves
+} Collider;
+
+#endif /* COMPONENTS_HEADER */
@@ -0,0 +1,67 @@
+/* Filename: counter_rng.h */
+
+#ifndef COUNTER_RNG_HEADER
+#define COUNTER_RNG_HEADER
+
+#include <cstdint>
+
+/* Four random 32 bit words, the output of one generator call */
+typedef struct RandomBlock {
+	uint32_t words[4];
+
+	double inline unit(const unsigned int lane) const { return this->words[lane] * (1.0 / 4294967296.0); } // Uniform in [0, 1)
+	double inline range(const unsigned int lane, const double min, const double max) const { return min + this->unit(lane) * (max - min); }
+} RandomBlock;
+
+/* Counter based random number generator (Philox4x32-10). There is no hidden state: the numbers for object i come straight
+   from (seed, i, stream), so objects can be generated in any order, on any thread, and always turn out the same */
+class CounterRng {
+private:
+	uint32_t key[2]; // The seed, split in two words
+
+	static inline void mulhilo(const uint32_t a, const uint32_t b, uint32_t& hi, uint32_t& lo);
+
+public:
+	CounterRng(const uint64_t seed);
+
+	RandomBlock block(const uint64_t index, const uint32_t stream) const; // The stream tells apart the blocks one object needs
+};
+
+/* Counter RNG's Constructor */
+CounterRng::CounterRng(const uint64_t seed)
+{
+	this->key[0] = (uint32_t)seed;
+	this->key[1] = (uint32_t)(seed >> 32);
+}
+
+/* Full 64 bit product of two 32 bit words, split into its high and low halves */
+void CounterRng::mulhilo(const uint32_t a, const uint32_t b, uint32_t& hi, uint32_t& lo)
+{
+	const uint64_t product = (uint64_t)a * b;
+	hi = (uint32_t)(product >> 32);
+	lo = (uint32_t)product;
+}
+
+/* Returns the random block of an object: ten Philox rounds over the counter (index, stream) under the seed */
+RandomBlock CounterRng::block(const uint64_t index, const uint32_t stream) const
+{
+	uint32_t counter[4] = { (uint32_t)index, (uint32_t)(index >> 32), stream, 0 };
+	uint32_t roundKey[2] = { this->key[0], this->key[1] };
+
+	for (unsigned int round = 0; round < 10; round++) {
+		uint32_t hi0, lo0, hi1, lo1;
+		mulhilo(0xD2511F53u, counter[0], hi0, lo0);
+		mulhilo(0xCD9E8D57u, counter[2], hi1, lo1);
+
+		const uint32_t next[4] = { hi1 ^ counter[1] ^ roundKey[0], lo1, hi0 ^ counter[3] ^ roundKey[1], lo0 };
+		counter[0] = next[0]; counter[1] = next[1]; counter[2] = next[2]; counter[3] = next[3];
+
+		roundKey[0] += 0x9E3779B9u;
+		roundKey[1] += 0xBB67AE85u;
+	}
+
+	RandomBlock result = { { counter[0], counter[1], counter[2], counter[3] } };
+	return result;
+}
+
+#endif /* COUNTER_RNG_HEADER */
@@ -0,0 +1,308 @@
+/* Filename: ephemeris.h */
+
+#ifndef EPHEMERIS_HEADER
+#define EPHEMERIS_HEADER
+
+#include <mapped_file.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "world.h"
+
+/*
+   Ephemeris file layout (little endian):
+     EphemerisHeader
+     EphemerisBodyEntry[bodyCount]
+     for every body, at its dataOffset: segmentCount segments of 3 * coefficientCount doubles (the x, y and z Chebyshev series)
+
+   Positions are relative to the body's parent, exactly like an Orbit's position, and time is measured in
+   simulation steps. Segment k of a body covers [startEpoch + k * segmentLength, startEpoch + (k + 1) * segmentLength].
+*/
+static const char EPHEMERIS_MAGIC[8] = { 'G', 'A', 'E', 'P', 'H', 'E', 'M', '1' };
+static const uint32_t EPHEMERIS_VERSION = 1;
+static const uint32_t EPHEMERIS_NO_PARENT = 0xFFFFFFFFu;
+
+typedef struct EphemerisHeader {
+	char magic[8];
+	uint32_t version, bodyCount;
+} EphemerisHeader;
+
+typedef struct EphemerisBodyEntry {
+	char name[32];
+	uint32_t parentIndex, coefficientCount, segmentCount, reserved;
+	double startEpoch, segmentLength;
+	uint64_t dataOffset;
+} EphemerisBodyEntry;
+
+/* Class that plays back planetary positions from a memory mapped ephemeris file. Looking a body up is O(1) (the segment index
+   follows from the epoch) and only the segments the simulation actually reaches are ever read from disk */
+class Ephemeris {
+private:
+	MappedFile file;
+	std::vector<EphemerisBodyEntry> bodies;
+	mutable std::vector<int64_t> currentSegment; // Last segment evaluated per body, so that the next one gets prefetched once
+
+	std::vector<Entity> boundEntities;
+	std::vector<unsigned int> boundBodies;
+
+	static double evaluateSeries(const double* coefficients, const unsigned int count, const double tau, double& derivative);
+
+public:
+	bool open(const std::string& path);
+
+	int findBody(const std::string& name) const;
+	bool evaluate(const unsigned int body, const double epoch, Point3D& position, Point3D& velocity) const;
+
+	bool bind(World& world, const Entity entity, const std::string& name); // Lets the ephemeris drive that entity's Orbit
+	void apply(World& world, const double epoch);                         // Moves every bound entity to where it is at the epoch
+};
+
+/* Maps an ephemeris file and validates its tables */
+bool Ephemeris::open(const std::string& path)
+{
+	this->bodies.clear();
+
+	if (!this->file.open(path)) {
+		std::cout << "ERROR::EPHEMERIS:: Could not map " << path << std::endl;
+		return false;
+	}
+
+	EphemerisHeader header;
+	if (this->file.getSize() < sizeof(header)) { this->file.close(); std::cout << "ERROR::EPHEMERIS:: Truncated file " << path << std::endl; return false; }
+	std::memcpy(&header, this->file.getData(), sizeof(header));
+
+	if (std::memcmp(header.magic, EPHEMERIS_MAGIC, sizeof(EPHEMERIS_MAGIC)) != 0 || header.version != EPHEMERIS_VERSION ||
+		this->file.getSize() < sizeof(header) + (size_t)header.bodyCount * sizeof(EphemerisBodyEntry)) {
+		this->file.close();
+		std::cout << "ERROR::EPHEMERIS:: Not a version " << EPHEMERIS_VERSION << " ephemeris: " << path << std::endl;
+		return false;
+	}
+
+	this->bodies.resize(header.bodyCount);
+	std::memcpy(this->bodies.data(), this->file.getData() + sizeof(header), header.bodyCount * sizeof(EphemerisBodyEntry));
+
+	for (unsigned int i = 0; i < header.bodyCount; i++) {
+		const EphemerisBodyEntry& body = this->bodies[i];
+		const uint64_t dataSize = (uint64_t)body.segmentCount * 3 * body.coefficientCount * sizeof(double);
+
+		if (body.coefficientCount == 0 || body.segmentCount == 0 || body.segmentLength <= 0.0 || body.dataOffset % sizeof(double) != 0 ||
+			body.dataOffset + dataSize > this->file.getSize()) {
+			this->bodies.clear(); this->file.close();
+			std::cout << "ERROR::EPHEMERIS:: Corrupt body table in " << path << std::endl;
+			return false;
+		}
+		this->bodies[i].name[sizeof(body.name) - 1] = '\0';
+	}
+
+	this->currentSegment.assign(header.bodyCount, -1);
+	return true;
+}
+
+/* Returns the index of the body with the given name, or -1 */
+int Ephemeris::findBody(const std::string& name) const
+{
+	for (unsigned int i = 0; i < this->bodies.size(); i++)
+		if (name == this->bodies[i].name) return (int)i;
+
+	return -1;
+}
+
+/* Sums a Chebyshev series at tau in [-1, 1], together with its derivative with respect to tau */
+double Ephemeris::evaluateSeries(const double* coefficients, const unsigned int count, const double tau, double& derivative)
+{
+	// T(n+1) = 2 tau T(n) - T(n-1), and T'(n) = n U(n-1) with U(n+1) = 2 tau U(n) - U(n-1)
+	double previousT = 1.0, currentT = tau;
+	double previousU = 0.0, currentU = 1.0;
+
+	double value = coefficients[0];
+	derivative = 0.0;
+
+	for (unsigned int n = 1; n < count; n++) {
+		value += coefficients[n] * currentT;
+		derivative += coefficients[n] * n * currentU;
+
+		const double nextT = 2.0 * tau * currentT - previousT;
+		const double nextU = 2.0 * tau * currentU - previousU;
+		previousT = currentT; currentT = nextT;
+		previousU = currentU; currentU = nextU;
+	}
+
+	return value;
+}
+
+/* Evaluates a body's position (relative to its parent) and velocity (per simulation step) at an epoch. Epochs outside the
+   file are clamped to its first or last segment, and false is returned */
+bool Ephemeris::evaluate(const unsigned int body, const double epoch, Point3D& position, Point3D& velocity) const
+{
+	const EphemerisBodyEntry& entry = this->bodies[body];
+
+	const double segmentPosition = (epoch - entry.startEpoch) / entry.segmentLength;
+	const bool inside = segmentPosition >= 0.0 && segmentPosition <= (double)entry.segmentCount;
+	const int64_t segment = std::min(std::max((int64_t)std::floor(segmentPosition), (int64_t)0), (int64_t)entry.segmentCount - 1);
+	const double tau = std::min(std::max(2.0 * (segmentPosition - segment) - 1.0, -1.0), 1.0);
+
+	const size_t segmentBytes = 3 * entry.coefficientCount * sizeof(double);
+	const double* coefficients = reinterpret_cast<const double*>(this->file.getData() + entry.dataOffset + segment * segmentBytes);
+
+	// Entering a new segment: ask the OS to start paging in the one after it while this one is in use
+	if (segment != this->currentSegment[body]) {
+		this->currentSegment[body] = segment;
+		if (segment + 1 < (int64_t)entry.segmentCount) this->file.prefetch((size_t)(entry.dataOffset + (segment + 1) * segmentBytes), segmentBytes);
+	}
+
+	const double stepsToTau = 2.0 / entry.segmentLength;
+	double dx, dy, dz;
+	position.x = evaluateSeries(coefficients, entry.coefficientCount, tau, dx);
+	position.y = evaluateSeries(coefficients + entry.coefficientCount, entry.coefficientCount, tau, dy);
+	position.z = evaluateSeries(coefficients + 2 * entry.coefficientCount, entry.coefficientCount, tau, dz);
+	velocity = { dx * stepsToTau, dy * stepsToTau, dz * stepsToTau };
+
+	return inside;
+}
+
+/* Lets the ephemeris drive an entity's Orbit (the TimeWarp stops integrating it), matching it to a body by name */
+bool Ephemeris::bind(World& world, const Entity entity, const std::string& name)
+{
+	const int body = this->findBody(name);
+	if (body < 0) {
+		std::cout << "ERROR::EPHEMERIS:: No body named " << name << std::endl;
+		return false;
+	}
+
+	world.get<Orbit>(entity).integrate = false;
+	this->boundEntities.push_back(entity);
+	this->boundBodies.push_back((unsigned int)body);
+	return true;
+}
+
+/* Moves every bound entity to where the ephemeris has it at the epoch */
+void Ephemeris::apply(World& world, const double epoch)
+{
+	for (size_t i = 0; i < this->boundEntities.size(); i++) {
+		Orbit& orbit = world.get<Orbit>(this->boundEntities[i]);
+		this->evaluate(this->boundBodies[i], epoch, orbit.position, orbit.velocity);
+	}
+}
+
+/* Class that fits Chebyshev segments to sampled body positions and writes an ephemeris file */
+class EphemerisWriter {
+private:
+	typedef struct Track {
+		std::string name;
+		uint32_t parentIndex;
+		std::vector<double> coefficients; // segmentCount * 3 * coefficientCount
+	} Track;
+
+	std::vector<Track> tracks;
+	double startEpoch, segmentLength;
+	unsigned int coefficientCount, segmentCount;
+
+public:
+	EphemerisWriter(const double startEpoch, const double segmentLength, const unsigned int coefficientCount, const unsigned int segmentCount);
+
+	unsigned int addBody(const std::string& name, const uint32_t parentIndex = EPHEMERIS_NO_PARENT);
+	double nodeEpoch(const unsigned int segment, const unsigned int node) const; // Epochs to sample, node 0 is the earliest
+	void setSegment(const unsigned int body, const unsigned int segment, const Point3D* samples); // One sample per node, in node order
+	bool write(const std::string& path) const;
+
+	unsigned int inline getNodeCount(void) const { return this->coefficientCount; }
+	unsigned int inline getSegmentCount(void) const { return this->segmentCount; }
+};
+
+/* Ephemeris Writer's Constructor */
+EphemerisWriter::EphemerisWriter(const double startEpoch, const double segmentLength, const unsigned int coefficientCount, const unsigned int segmentCount)
+{
+	this->startEpoch = startEpoch;
+	this->segmentLength = segmentLength;
+	this->coefficientCount = coefficientCount;
+	this->segmentCount = segmentCount;
+}
+
+/* Adds a body and returns its index */
+unsigned int EphemerisWriter::addBody(const std::string& name, const uint32_t parentIndex)
+{
+	Track track;
+	track.name = name.substr(0, 31);
+	track.parentIndex = parentIndex;
+	track.coefficients.assign((size_t)this->segmentCount * 3 * this->coefficientCount, 0.0);
+
+	this->tracks.push_back(track);
+	return (unsigned int)this->tracks.size() - 1;
+}
+
+/* Chebyshev nodes of the first kind, cos(pi (k + 1/2) / n), mapped onto the segment in increasing time order */
+double EphemerisWriter::nodeEpoch(const unsigned int segment, const unsigned int node) const
+{
+	const unsigned int k = this->coefficientCount - 1 - node;
+	const double tau = std::cos(3.14159265358979323846 * (k + 0.5) / this->coefficientCount);
+
+	return this->startEpoch + (segment + 0.5 * (tau + 1.0)) * this->segmentLength;
+}
+
+/* Interpolates a segment through the samples taken at its nodes (a discrete cosine transform) */
+void EphemerisWriter::setSegment(const unsigned int body, const unsigned int segment, const Point3D* samples)
+{
+	const unsigned int n = this->coefficientCount;
+	double* coefficients = &this->tracks[body].coefficients[(size_t)segment * 3 * n];
+
+	for (unsigned int j = 0; j < n; j++) {
+		double sumX = 0.0, sumY = 0.0, sumZ = 0.0;
+
+		for (unsigned int node = 0; node < n; node++) {
+			const unsigned int k = n - 1 - node;
+			const double weight = std::cos(3.14159265358979323846 * j * (k + 0.5) / n);
+			sumX += samples[node].x * weight; sumY += samples[node].y * weight; sumZ += samples[node].z * weight;
+		}
+
+		const double scale = (j == 0 ? 1.0 : 2.0) / n;
+		coefficients[j] = sumX * scale;
+		coefficients[n + j] = sumY * scale;
+		coefficients[2 * n + j] = sumZ * scale;
+	}
+}
+
+/* Writes the ephemeris file */
+bool EphemerisWriter::write(const std::string& path) const
+{
+	std::ofstream output(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!output) {
+		std::cout << "ERROR::EPHEMERIS:: Could not create " << path << std::endl;
+		return false;
+	}
+
+	EphemerisHeader header;
+	std::memcpy(header.magic, EPHEMERIS_MAGIC, sizeof(EPHEMERIS_MAGIC));
+	header.version = EPHEMERIS_VERSION;
+	header.bodyCount = (uint32_t)this->tracks.size();
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	uint64_t dataOffset = sizeof(header) + this->tracks.size() * sizeof(EphemerisBodyEntry);
+	for (size_t i = 0; i < this->tracks.size(); i++) {
+		EphemerisBodyEntry entry;
+		std::memset(&entry, 0, sizeof(entry));
+		std::memcpy(entry.name, this->tracks[i].name.c_str(), this->tracks[i].name.size()); // Names were cut to 31 characters, the rest stays zero
+		entry.parentIndex = this->tracks[i].parentIndex;
+		entry.coefficientCount = this->coefficientCount;
+		entry.segmentCount = this->segmentCount;
+		entry.startEpoch = this->startEpoch;
+		entry.segmentLength = this->segmentLength;
+		entry.dataOffset = dataOffset;
+		output.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+
+		dataOffset += this->tracks[i].coefficients.size() * sizeof(double);
+	}
+
+	for (size_t i = 0; i < this->tracks.size(); i++)
+		output.write(reinterpret_cast<const char*>(this->tracks[i].coefficients.data()), this->tracks[i].coefficients.size() * sizeof(double));
+
+	return output.good();
+}
+
+#endif /* EPHEMERIS_HEADER */
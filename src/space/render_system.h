@@ -0,0 +1,95 @@
+/* Filename: render_system.h */
+
+#ifndef RENDER_SYSTEM_HEADER
+#define RENDER_SYSTEM_HEADER
+
+#include <gl_resource.h>
+#include <shader.h>
+#include <vertex_layout.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "world.h"
+
+/* Class that draws every active Renderable entity of a render pass, using the model matrices of the CameraRelativePass */
+class RenderSystem {
+private:
+	/* One instance of an instanced pass, and the model it is an instance of */
+	typedef struct Instance {
+		Model* model;
+		InstanceData data;
+	} Instance;
+
+	World& world;
+
+	std::vector<Instance> instances;        // This frame's instances, grouped by model
+	std::vector<InstanceData> instanceData; // The same, as uploaded
+	GLBuffer instanceBuffer;
+
+public:
+	RenderSystem(World& world) : world(world) {}
+
+	void draw(Shader& shader, const RenderPass pass);
+	void drawInstanced(Shader& shader, const RenderPass pass); // One draw call per model (and mesh), whatever the number of entities
+};
+
+/* Draws the entities of a render pass with the given (already bound) shader */
+void RenderSystem::draw(Shader& shader, const RenderPass pass)
+{
+	this->world.forEach(ComponentMaskOf<Transform, Renderable>::value, 0, [&shader, pass](Archetype& archetype) {
+		const Transform* transforms = archetype.column<Transform>();
+		const Renderable* renderables = archetype.column<Renderable>();
+
+		for (size_t i = 0; i < archetype.size(); i++) {
+			const Renderable& renderable = renderables[i];
+			if (renderable.pass != pass || !renderable.model || !renderable.visible || !transforms[i].active) continue;
+
+			shader.setMat4("model", renderable.transformation);
+			renderable.model->Draw(shader);
+		}
+	});
+}
+
+/* Draws the entities of a render pass as instances of their models, with the given (already bound) shader: the model matrices,
+   shape seeds and texture layers go to the GPU in one buffer, the shader reads them as per-instance attributes */
+void RenderSystem::drawInstanced(Shader& shader, const RenderPass pass)
+{
+	this->instances.clear();
+	this->world.forEach(ComponentMaskOf<Transform, Renderable>::value, 0, [this, pass](Archetype& archetype) {
+		const Transform* transforms = archetype.column<Transform>();
+		const Renderable* renderables = archetype.column<Renderable>();
+
+		for (size_t i = 0; i < archetype.size(); i++) {
+			const Renderable& renderable = renderables[i];
+			if (renderable.pass != pass || !renderable.model || !renderable.visible || !transforms[i].active) continue;
+
+			const Instance instance = { renderable.model.get(), { renderable.transformation, renderable.shapeSeed, renderable.textureLayer } };
+			this->instances.push_back(instance);
+		}
+	});
+	if (this->instances.empty()) return;
+
+	std::stable_sort(this->instances.begin(), this->instances.end(), [](const Instance& a, const Instance& b) { return std::less<Model*>()(a.model, b.model); });
+
+	this->instanceData.resize(this->instances.size());
+	for (size_t i = 0; i < this->instances.size(); i++) this->instanceData[i] = this->instances[i].data;
+
+	// Orphaning the buffer every frame, so the upload never waits for last frame's draws
+	if (!this->instanceBuffer) this->instanceBuffer = GLBuffer::generate();
+	const GLsizeiptr bytes = (GLsizeiptr)(this->instanceData.size() * sizeof(InstanceData));
+	glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer.get());
+	glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, this->instanceData.data());
+
+	for (size_t first = 0; first < this->instances.size();) {
+		size_t last = first + 1;
+		while (last < this->instances.size() && this->instances[last].model == this->instances[first].model) last++;
+
+		this->instances[first].model->DrawInstanced(shader, this->instanceBuffer.get(), first * sizeof(InstanceData), (GLsizei)(last - first));
+		first = last;
+	}
+}
+
+#endif /* RENDER_SYSTEM_HEADER */
@@ -0,0 +1,435 @@
+/* Filename: state_log.h */
+
+#ifndef STATE_LOG_HEADER
+#define STATE_LOG_HEADER
+
+#include <mapped_file.h>
+#include <thread_pool.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "world.h"
+
+/*
+   State log layout (little endian):
+     StateLogHeader
+     chunks, each one StateChunkHeader, then frameCount StateFrameRecord, then frameCount * bodyCount StateBodyRecord (frame major)
+     chunk table: chunkCount uint64 file offsets, at chunkTableOffset
+
+   The bodies are every entity with a Transform and without a StaticTag, in the World's archetype order. Every chunk but the
+   last holds framesPerChunk frames, so the chunk of a frame is a division away. Positions are stored as
+   unsigned 32 bit steps from the chunk's origin, rotations as "smallest three" quaternions packed in 32 bits, and a body whose
+   scale is 0 no longer exists (another body absorbed it).
+*/
+static const char STATE_LOG_MAGIC[8] = { 'G', 'A', 'S', 'T', 'A', 'T', 'E', '1' };
+static const uint32_t STATE_LOG_VERSION = 2; // 2: planets drawn at their procedural sphere scale, older logs replay them wrong
+
+typedef struct StateLogHeader {
+	char magic[8];
+	uint32_t version, bodyCount, framesPerChunk, chunkCount;
+	uint64_t frameCount, seed, chunkTableOffset;
+} StateLogHeader;
+
+typedef struct StateChunkHeader {
+	uint32_t firstFrame, frameCount;
+	double origin[3], step; // Quantization grid of the chunk's positions
+} StateChunkHeader;
+
+typedef struct StateFrameRecord {
+	double simulationTime;
+	double cameraPosition[3];
+	float cameraYaw, cameraPitch, cameraZoom, reserved;
+} StateFrameRecord;
+
+typedef struct StateBodyRecord {
+	uint32_t position[3];
+	uint32_t rotation;
+	float scale;
+} StateBodyRecord;
+
+/* The camera's pose, as it gets recorded and replayed */
+typedef struct CameraPose {
+	glm::dvec3 position;
+	float yaw, pitch, zoom;
+} CameraPose;
+
+/* Packs a unit quaternion as its three smallest components (10 bits each) plus the index of the largest one (2 bits) */
+static inline uint32_t packRotation(const glm::quat& rotation)
+{
+	const float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+
+	unsigned int largest = 0;
+	for (unsigned int i = 1; i < 4; i++)
+		if (std::fabs(components[i]) > std::fabs(components[largest])) largest = i;
+
+	// q and -q are the same rotation: flip the sign so that the dropped component is positive
+	const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+	uint32_t packed = largest << 30;
+	unsigned int shift = 20;
+
+	for (unsigned int i = 0; i < 4; i++) {
+		if (i == largest) continue;
+		const float normalized = std::min(std::max((sign * components[i] * 1.41421356f + 1.0f) * 0.5f, 0.0f), 1.0f); // The others lie in [-1/sqrt(2), 1/sqrt(2)]
+		packed |= (uint32_t)std::lround(normalized * 1023.0f) << shift;
+		shift -= 10;
+	}
+
+	return packed;
+}
+
+/* Inverse of packRotation */
+static inline glm::quat unpackRotation(const uint32_t packed)
+{
+	const unsigned int largest = packed >> 30;
+	float components[4];
+	float sum = 0.0f;
+	unsigned int shift = 20;
+
+	for (unsigned int i = 0; i < 4; i++) {
+		if (i == largest) continue;
+		components[i] = (((packed >> shift) & 1023u) / 1023.0f * 2.0f - 1.0f) * 0.70710678f;
+		sum += components[i] * components[i];
+		shift -= 10;
+	}
+	components[largest] = std::sqrt(std::max(1.0f - sum, 0.0f));
+
+	return glm::quat(components[3], components[0], components[1], components[2]);
+}
+
+/* The entities a state log covers: everything that has a Transform and can move */
+static const ComponentMask STATE_LOG_REQUIRED = ComponentMaskOf<Transform>::value;
+static const ComponentMask STATE_LOG_EXCLUDED = ComponentMaskOf<StaticTag>::value;
+
+/* Class that records the state of the World's bodies and the camera, frame after frame, into a state log. Frames are kept at
+   full precision until a chunk fills up, then the chunk gets quantized and written in one go.
+   One record per rendered frame, not per simulation step: the TimeWarp's sub-steps only exist inside its integrator (every
+   level takes its own count of them), world positions and collisions are only worked out once per frame, so a frame is the
+   smallest state the World ever holds. Under time warp consecutive records are many simulation steps apart (each one keeps its
+   simulation time), a replay shows what was on screen and scrubbing moves through frames, not steps */
+class StateRecorder {
+private:
+	std::ofstream output;
+	World* world;
+	std::vector<uint64_t> chunkOffsets;
+	StateLogHeader header;
+
+	// The chunk being filled
+	std::vector<StateFrameRecord> frames;
+	std::vector<Point3D> positions;
+	std::vector<uint32_t> rotations;
+	std::vector<float> scales;
+
+	void flushChunk(void);
+
+public:
+	StateRecorder(void) : world(NULL) {}
+	~StateRecorder(void) { this->close(); }
+
+	bool open(const std::string& path, World& world, const uint64_t seed, const uint32_t framesPerChunk = 256);
+	void record(const double simulationTime, const CameraPose& camera);
+	void close(void);
+
+	bool inline isOpen(void) { return this->output.is_open(); }
+};
+
+/* Creates the log and writes a provisional header (its counts get filled in by close) */
+bool StateRecorder::open(const std::string& path, World& world, const uint64_t seed, const uint32_t framesPerChunk)
+{
+	this->close();
+
+	this->output.open(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!this->output) {
+		std::cout << "ERROR::STATE_LOG:: Could not create " << path << std::endl;
+		return false;
+	}
+
+	this->world = &world;
+	this->chunkOffsets.clear();
+
+	std::memset(&this->header, 0, sizeof(this->header));
+	std::memcpy(this->header.magic, STATE_LOG_MAGIC, sizeof(STATE_LOG_MAGIC));
+	this->header.version = STATE_LOG_VERSION;
+	this->header.bodyCount = (uint32_t)world.count(STATE_LOG_REQUIRED, STATE_LOG_EXCLUDED);
+	this->header.framesPerChunk = std::max(framesPerChunk, 1u);
+	this->header.seed = seed;
+	this->output.write(reinterpret_cast<const char*>(&this->header), sizeof(this->header));
+
+	return true;
+}
+
+/* Captures the current state of every body and the camera as the next frame */
+void StateRecorder::record(const double simulationTime, const CameraPose& camera)
+{
+	if (!this->output.is_open()) return;
+
+	StateFrameRecord frame;
+	frame.simulationTime = simulationTime;
+	frame.cameraPosition[0] = camera.position.x; frame.cameraPosition[1] = camera.position.y; frame.cameraPosition[2] = camera.position.z;
+	frame.cameraYaw = camera.yaw; frame.cameraPitch = camera.pitch; frame.cameraZoom = camera.zoom;
+	frame.reserved = 0.0f;
+	this->frames.push_back(frame);
+
+	// Bodies created after open are not part of the log
+	size_t remaining = this->header.bodyCount;
+	this->world->forEach(STATE_LOG_REQUIRED, STATE_LOG_EXCLUDED, [this, &remaining](Archetype& archetype) {
+		const Transform* transforms = archetype.column<Transform>();
+		const size_t count = std::min(archetype.size(), remaining);
+
+		for (size_t i = 0; i < count; i++) {
+			this->positions.push_back(transforms[i].position);
+			this->rotations.push_back(packRotation(transforms[i].rotation));
+			this->scales.push_back(transforms[i].active ? (float)transforms[i].scale : 0.0f);
+		}
+		remaining -= count;
+	});
+	for (; remaining > 0; remaining--) { this->positions.push_back(Point3D{ 0, 0, 0 }); this->rotations.push_back(0); this->scales.push_back(0.0f); }
+
+	if (this->frames.size() == this->header.framesPerChunk) this->flushChunk();
+}
+
+/* Quantizes the buffered frames against the chunk's bounding box and writes them out */
+void StateRecorder::flushChunk(void)
+{
+	if (this->frames.empty()) return;
+
+	StateChunkHeader chunk;
+	chunk.firstFrame = (uint32_t)this->header.frameCount;
+	chunk.frameCount = (uint32_t)this->frames.size();
+
+	Point3D low = { 0, 0, 0 }, high = { 0, 0, 0 };
+	if (!this->positions.empty()) low = high = this->positions[0];
+	for (size_t i = 1; i < this->positions.size(); i++) {
+		low.x = std::min(low.x, this->positions[i].x); high.x = std::max(high.x, this->positions[i].x);
+		low.y = std::min(low.y, this->positions[i].y); high.y = std::max(high.y, this->positions[i].y);
+		low.z = std::min(low.z, this->positions[i].z); high.z = std::max(high.z, this->positions[i].z);
+	}
+
+	// One step size for all three axes keeps the error the same in every direction
+	const double extent = std::max(high.x - low.x, std::max(high.y - low.y, high.z - low.z));
+	chunk.origin[0] = low.x; chunk.origin[1] = low.y; chunk.origin[2] = low.z;
+	chunk.step = extent > 0.0 ? extent / 4294967295.0 : 1.0;
+
+	std::vector<StateBodyRecord> records(this->positions.size());
+	const double inverseStep = 1.0 / chunk.step;
+	for (size_t i = 0; i < records.size(); i++) {
+		records[i].position[0] = (uint32_t)std::llround((this->positions[i].x - low.x) * inverseStep);
+		records[i].position[1] = (uint32_t)std::llround((this->positions[i].y - low.y) * inverseStep);
+		records[i].position[2] = (uint32_t)std::llround((this->positions[i].z - low.z) * inverseStep);
+		records[i].rotation = this->rotations[i];
+		records[i].scale = this->scales[i];
+	}
+
+	this->chunkOffsets.push_back((uint64_t)this->output.tellp());
+	this->output.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+	this->output.write(reinterpret_cast<const char*>(this->frames.data()), this->frames.size() * sizeof(StateFrameRecord));
+	this->output.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(StateBodyRecord));
+
+	// Pad to 8 bytes, so that the doubles of the next chunk (and of the chunk table) stay aligned once mapped
+	const char padding[8] = { 0 };
+	const size_t written = records.size() * sizeof(StateBodyRecord);
+	if (written % 8 != 0) this->output.write(padding, 8 - written % 8);
+
+	this->header.frameCount += chunk.frameCount;
+	this->frames.clear(); this->positions.clear(); this->rotations.clear(); this->scales.clear();
+}
+
+/* Writes the last partial chunk and the chunk table, completes the header and closes the log */
+void StateRecorder::close(void)
+{
+	if (!this->output.is_open()) return;
+
+	this->flushChunk();
+
+	this->header.chunkCount = (uint32_t)this->chunkOffsets.size();
+	this->header.chunkTableOffset = (uint64_t)this->output.tellp();
+	this->output.write(reinterpret_cast<const char*>(this->chunkOffsets.data()), this->chunkOffsets.size() * sizeof(uint64_t));
+
+	this->output.seekp(0);
+	this->output.write(reinterpret_cast<const char*>(&this->header), sizeof(this->header));
+
+	if (!this->output.good()) std::cout << "ERROR::STATE_LOG:: Failed writing the state log" << std::endl;
+	else std::cout << "Recorded " << this->header.frameCount << " frames of " << this->header.bodyCount << " bodies" << std::endl;
+
+	this->output.close();
+}
+
+/* Class that replays a memory mapped state log onto a World built the same way as the recorded one. Any frame can be reached
+   directly, which is what makes scrubbing back and forth cheap */
+class StateReplay {
+private:
+	static const unsigned int CHUNK_SIZE = 4096; // Bodies decoded together
+
+	MappedFile file;
+	StateLogHeader header;
+	const uint64_t* chunkOffsets;
+	World* world;
+	int64_t currentChunk;
+
+	const StateChunkHeader* chunkOf(const uint64_t frame) const;
+
+public:
+	StateReplay(void) : chunkOffsets(NULL), world(NULL), currentChunk(-1) {}
+
+	bool open(const std::string& path, World& world, const uint64_t seed);
+
+	uint64_t inline getFrameCount(void) const { return this->header.frameCount; }
+	uint64_t inline getSeed(void) const { return this->header.seed; }
+	double getSimulationTime(const uint64_t frame) const;
+
+	void apply(const uint64_t frame, CameraPose& camera); // Puts every body and the camera where they were at the frame
+};
+
+/* Maps a state log and checks every chunk of it, and checks it against the bodies it will drive: a log recorded with another
+   seed drives asteroids of other shapes, it is refused too */
+bool StateReplay::open(const std::string& path, World& world, const uint64_t seed)
+{
+	std::memset(&this->header, 0, sizeof(this->header));
+	this->currentChunk = -1;
+
+	if (!this->file.open(path)) {
+		std::cout << "ERROR::STATE_LOG:: Could not map " << path << std::endl;
+		return false;
+	}
+
+	if (this->file.getSize() >= sizeof(this->header)) std::memcpy(&this->header, this->file.getData(), sizeof(this->header));
+
+	if (std::memcmp(this->header.magic, STATE_LOG_MAGIC, sizeof(STATE_LOG_MAGIC)) == 0 && this->header.version != STATE_LOG_VERSION) {
+		std::cout << "ERROR::STATE_LOG:: " << path << " is a version " << this->header.version << " state log, this build replays version " << STATE_LOG_VERSION << ": record it again" << std::endl;
+		std::memset(&this->header, 0, sizeof(this->header));
+		this->file.close();
+		return false;
+	}
+
+	const uint64_t tableSize = (uint64_t)this->header.chunkCount * sizeof(uint64_t);
+	if (std::memcmp(this->header.magic, STATE_LOG_MAGIC, sizeof(STATE_LOG_MAGIC)) != 0 || this->header.version != STATE_LOG_VERSION ||
+		this->header.chunkTableOffset % sizeof(uint64_t) != 0 || this->header.chunkTableOffset + tableSize > this->file.getSize() ||
+		this->header.framesPerChunk == 0 || (uint64_t)this->header.chunkCount * this->header.framesPerChunk < this->header.frameCount) {
+		std::memset(&this->header, 0, sizeof(this->header));
+		this->file.close();
+		std::cout << "ERROR::STATE_LOG:: Not a complete version " << STATE_LOG_VERSION << " state log: " << path << std::endl;
+		return false;
+	}
+
+	// Every chunk has to follow the previous one in the file and in frames, be full (but the last), and end before the chunk table
+	const uint64_t* chunkOffsets = reinterpret_cast<const uint64_t*>(this->file.getData() + this->header.chunkTableOffset);
+	uint64_t frames = 0, chunkEnd = sizeof(StateLogHeader);
+	uint32_t chunks = 0;
+	for (; chunks < this->header.chunkCount && frames < this->header.frameCount; chunks++) {
+		const uint64_t offset = chunkOffsets[chunks];
+		if (offset % sizeof(uint64_t) != 0 || offset < chunkEnd || offset > this->header.chunkTableOffset ||
+			this->header.chunkTableOffset - offset < sizeof(StateChunkHeader)) break;
+
+		StateChunkHeader chunk;
+		std::memcpy(&chunk, this->file.getData() + offset, sizeof(chunk));
+		const uint64_t space = this->header.chunkTableOffset - offset - sizeof(StateChunkHeader);
+		const uint64_t expected = std::min<uint64_t>(this->header.framesPerChunk, this->header.frameCount - frames);
+		if (chunk.firstFrame != frames || chunk.frameCount != expected ||
+			chunk.frameCount * sizeof(StateFrameRecord) > space ||
+			(uint64_t)chunk.frameCount * this->header.bodyCount > (space - chunk.frameCount * sizeof(StateFrameRecord)) / sizeof(StateBodyRecord)) break;
+
+		frames += chunk.frameCount;
+		chunkEnd = offset + sizeof(StateChunkHeader) + chunk.frameCount * sizeof(StateFrameRecord) + (uint64_t)chunk.frameCount * this->header.bodyCount * sizeof(StateBodyRecord);
+	}
+	if (frames != this->header.frameCount || chunks != this->header.chunkCount) {
+		std::memset(&this->header, 0, sizeof(this->header));
+		this->file.close();
+		std::cout << "ERROR::STATE_LOG:: Corrupt chunk table in " << path << std::endl;
+		return false;
+	}
+
+	const size_t bodyCount = world.count(STATE_LOG_REQUIRED, STATE_LOG_EXCLUDED);
+	if (this->header.bodyCount != bodyCount) {
+		std::cout << "ERROR::STATE_LOG:: " << path << " holds " << this->header.bodyCount << " bodies, the scene has " << bodyCount << std::endl;
+		std::memset(&this->header, 0, sizeof(this->header));
+		this->file.close();
+		return false;
+	}
+
+	if (this->header.seed != seed) {
+		std::cout << "ERROR::STATE_LOG:: " << path << " was recorded with seed " << this->header.seed << ", the scene has seed " << seed << " (replay it with --seed " << this->header.seed << ")" << std::endl;
+		std::memset(&this->header, 0, sizeof(this->header));
+		this->file.close();
+		return false;
+	}
+
+	this->chunkOffsets = chunkOffsets;
+	this->world = &world;
+	return true;
+}
+
+/* Returns the chunk holding a frame */
+const StateChunkHeader* StateReplay::chunkOf(const uint64_t frame) const
+{
+	return reinterpret_cast<const StateChunkHeader*>(this->file.getData() + this->chunkOffsets[frame / this->header.framesPerChunk]);
+}
+
+/* Returns the simulation time at which a frame was recorded */
+double StateReplay::getSimulationTime(const uint64_t frame) const
+{
+	if (frame >= this->header.frameCount) return 0.0;
+
+	const StateChunkHeader* chunk = this->chunkOf(frame);
+	const StateFrameRecord* frames = reinterpret_cast<const StateFrameRecord*>(chunk + 1);
+
+	return frames[frame - chunk->firstFrame].simulationTime;
+}
+
+/* Decodes a frame onto the bodies (in parallel) and the camera */
+void StateReplay::apply(const uint64_t frame, CameraPose& camera)
+{
+	if (frame >= this->header.frameCount) return;
+
+	const int64_t chunkIndex = (int64_t)(frame / this->header.framesPerChunk);
+	const StateChunkHeader* chunk = this->chunkOf(frame);
+	const StateFrameRecord* frames = reinterpret_cast<const StateFrameRecord*>(chunk + 1);
+	const size_t local = (size_t)(frame - chunk->firstFrame);
+
+	// Entering a new chunk: have the OS page in the next one while this one plays
+	if (chunkIndex != this->currentChunk) {
+		this->currentChunk = chunkIndex;
+		if (chunkIndex + 1 < (int64_t)this->header.chunkCount) {
+			const uint64_t next = this->chunkOffsets[chunkIndex + 1];
+			const uint64_t end = chunkIndex + 2 < (int64_t)this->header.chunkCount ? this->chunkOffsets[chunkIndex + 2] : this->header.chunkTableOffset;
+			this->file.prefetch((size_t)next, (size_t)(end - next));
+		}
+	}
+
+	const StateFrameRecord& record = frames[local];
+	camera.position = glm::dvec3(record.cameraPosition[0], record.cameraPosition[1], record.cameraPosition[2]);
+	camera.yaw = record.cameraYaw; camera.pitch = record.cameraPitch; camera.zoom = record.cameraZoom;
+
+	const StateBodyRecord* records = reinterpret_cast<const StateBodyRecord*>(frames + chunk->frameCount) + local * this->header.bodyCount;
+
+	this->world->forEach(STATE_LOG_REQUIRED, STATE_LOG_EXCLUDED, [records, chunk](Archetype& archetype) mutable {
+		Transform* transforms = archetype.column<Transform>();
+		const StateBodyRecord* archetypeRecords = records;
+		records += archetype.size();
+
+		ThreadPool::global().parallelFor(archetype.size(), CHUNK_SIZE, [transforms, archetypeRecords, chunk](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				Transform& transform = transforms[i];
+				const StateBodyRecord& state = archetypeRecords[i];
+
+				transform.position.x = chunk->origin[0] + state.position[0] * chunk->step;
+				transform.position.y = chunk->origin[1] + state.position[1] * chunk->step;
+				transform.position.z = chunk->origin[2] + state.position[2] * chunk->step;
+
+				transform.active = state.scale > 0.0f;
+				if (transform.active) transform.scale = state.scale;
+				transform.rotation = unpackRotation(state.rotation);
+			}
+		});
+	});
+}
+
+#endif /* STATE_LOG_HEADER */
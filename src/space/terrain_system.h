@@ -0,0 +1,455 @@
+/* Filename: terrain_system.h */
+
+#ifndef TERRAIN_SYSTEM_HEADER
+#define TERRAIN_SYSTEM_HEADER
+
+#include <gl_resource.h>
+#include <procedural_sphere.h>
+#include <shader.h>
+#include <stb_image.h>
+#include <thread_pool.h>
+#include <vertex_layout.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "world.h"
+
+/* Height Map Structure. A grayscale bump map kept on the CPU, sampled with the texture coordinates of the planet's surface */
+typedef struct HeightMap {
+	int width = 0, height = 0;
+	std::vector<uint16_t> texels; // Rows bottom up, like the textures stb_image flips on load
+
+	float sample(const glm::vec2& texCoords) const; // Bilinear height in [0, 1]
+} HeightMap;
+
+float HeightMap::sample(const glm::vec2& texCoords) const
+{
+	const float x = glm::clamp(texCoords.x, 0.0f, 1.0f) * (this->width - 1), y = glm::clamp(texCoords.y, 0.0f, 1.0f) * (this->height - 1);
+	const int x0 = (int)x, y0 = (int)y;
+	const int x1 = std::min(x0 + 1, this->width - 1), y1 = std::min(y0 + 1, this->height - 1);
+	const float fx = x - x0, fy = y - y0;
+
+	const float bottom = glm::mix((float)this->texels[(size_t)y0 * this->width + x0], (float)this->texels[(size_t)y0 * this->width + x1], fx);
+	const float top = glm::mix((float)this->texels[(size_t)y1 * this->width + x0], (float)this->texels[(size_t)y1 * this->width + x1], fx);
+	return glm::mix(bottom, top, fy) / 65535.0f;
+}
+
+/* Loads a bump map as 16-bit heights (8-bit files get widened). Returns NULL if the file cannot be read */
+std::shared_ptr<const HeightMap> loadHeightMap(const std::string& path)
+{
+	// Bottom row first like the diffuse textures, set for this thread: texture decoding on the pool's workers leaves their flag off
+	stbi_set_flip_vertically_on_load_thread(1);
+
+	int width, height, channels;
+	stbi_us* data = stbi_load_16(path.c_str(), &width, &height, &channels, 1);
+	if (!data) {
+		std::cout << "ERROR::TERRAIN:: Could not load the height map " << path << std::endl;
+		return std::shared_ptr<const HeightMap>();
+	}
+
+	std::shared_ptr<HeightMap> heightMap = std::make_shared<HeightMap>();
+	heightMap->width = width;
+	heightMap->height = height;
+	heightMap->texels.assign(data, data + (size_t)width * height);
+	stbi_image_free(data);
+
+	return heightMap;
+}
+
+/* What a worker hands back for one chunk: its vertices, packed for upload, and what the level of detail selection needs */
+typedef struct TerrainChunkGeometry {
+	std::vector<unsigned char> vertices;
+	glm::vec3 centre{ 0.0f };    // Bounding sphere, in model space
+	float boundingRadius = 0.0f;
+	float error = 0.0f;          // Largest distance between the chunk and the surface it stands for, in model space
+} TerrainChunkGeometry;
+
+/* Grid cells along each chunk edge. A chunk is a (cells + 1)^2 grid plus a skirt along its border, which hangs down and hides
+   the cracks against neighbours of another level */
+static const unsigned int TERRAIN_CHUNK_CELLS = 16;
+static const unsigned int TERRAIN_CHUNK_SIDE = TERRAIN_CHUNK_CELLS + 1;
+static const unsigned int TERRAIN_CHUNK_VERTICES = TERRAIN_CHUNK_SIDE * TERRAIN_CHUNK_SIDE + 4 * TERRAIN_CHUNK_CELLS;
+static const unsigned int TERRAIN_CHUNK_TRIANGLES = 2 * TERRAIN_CHUNK_CELLS * TERRAIN_CHUNK_CELLS + 8 * TERRAIN_CHUNK_CELLS;
+
+/* The grid vertices along the border of a chunk, counter-clockwise seen from outside, the order the skirt follows */
+static unsigned int terrainBorderVertex(const unsigned int k)
+{
+	const unsigned int n = TERRAIN_CHUNK_CELLS, side = TERRAIN_CHUNK_SIDE;
+	if (k < n) return k;                                  // Bottom edge, left to right
+	if (k < 2 * n) return (k - n) * side + n;             // Right edge, bottom up
+	if (k < 3 * n) return n * side + (3 * n - k);         // Top edge, right to left
+	return (4 * n - k) * side;                            // Left edge, top down
+}
+
+/* The triangles of every chunk, which all share one index buffer: the grid, then the skirt walls */
+std::vector<unsigned short> terrainChunkIndices(void)
+{
+	const unsigned int n = TERRAIN_CHUNK_CELLS, side = TERRAIN_CHUNK_SIDE, skirt = side * side;
+	std::vector<unsigned short> indices;
+	indices.reserve(3 * TERRAIN_CHUNK_TRIANGLES);
+
+	for (unsigned int j = 0; j < n; j++)
+		for (unsigned int i = 0; i < n; i++) {
+			const unsigned int corner = j * side + i;
+			const unsigned int quad[6] = { corner, corner + 1, corner + side + 1, corner, corner + side + 1, corner + side };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+
+	// Each wall faces away from the chunk: border vertices e0 -> e1, their skirt vertices s0 and s1 below
+	for (unsigned int k = 0; k < 4 * n; k++) {
+		const unsigned int next = (k + 1) % (4 * n);
+		const unsigned int e0 = terrainBorderVertex(k), e1 = terrainBorderVertex(next), s0 = skirt + k, s1 = skirt + next;
+		const unsigned int wall[6] = { e0, s0, e1, e1, s0, s1 };
+		indices.insert(indices.end(), wall, wall + 6);
+	}
+
+	return indices;
+}
+
+/* The vertex layout of the chunks: full float texture coordinates, deep chunks step finer than half floats can */
+static const VertexLayout& terrainVertexLayout(void)
+{
+	static const VertexLayout layout = makeVertexLayout(VERTEX_NORMAL | VERTEX_TEXCOORDS, false);
+	return layout;
+}
+
+/* Builds the chunk covering the square [s, s + size] x [t, t + size] of a cube face's equal-angle grid, displaced by the height
+   map: radius * (1 + heightScale * height). Runs on the worker threads, it only reads the height map */
+TerrainChunkGeometry generateTerrainChunk(const HeightMap& heightMap, const float radius, const float heightScale, const unsigned int f, const float s, const float t, const float size)
+{
+	const CubeSphereFace& face = CUBE_SPHERE_FACES[f];
+	const unsigned int n = TERRAIN_CHUNK_CELLS, side = TERRAIN_CHUNK_SIDE, ring = side + 2;
+	const float step = size / n;
+
+	// The surface point at grid position (i, j) of the chunk. Points past the face edge (the normals' ring) keep the height of the edge
+	auto surfacePoint = [&](const float i, const float j) {
+		const float gs = s + i * step, gt = t + j * step;
+		const float height = heightMap.sample(cubeSphereTexCoords(face, glm::clamp(gs, 0.0f, 1.0f), glm::clamp(gt, 0.0f, 1.0f)));
+		return cubeSphereDirection(face, gs, gt) * (radius * (1.0f + heightScale * height));
+	};
+
+	// The grid with a ring of extra points around it, so every normal is a central difference, the same on both sides of a border
+	std::vector<glm::vec3> points((size_t)ring * ring);
+	for (unsigned int j = 0; j < ring; j++)
+		for (unsigned int i = 0; i < ring; i++) points[(size_t)j * ring + i] = surfacePoint((float)i - 1.0f, (float)j - 1.0f);
+
+	auto point = [&points, ring](const unsigned int i, const unsigned int j) -> const glm::vec3& { return points[(size_t)(j + 1) * ring + (i + 1)]; };
+
+	std::vector<Vertex> vertices(TERRAIN_CHUNK_VERTICES, Vertex());
+	glm::vec3 lower(std::numeric_limits<float>::max()), upper(-std::numeric_limits<float>::max());
+
+	for (unsigned int j = 0; j < side; j++)
+		for (unsigned int i = 0; i < side; i++) {
+			Vertex& vertex = vertices[(size_t)j * side + i];
+			vertex.Position = point(i, j);
+			vertex.TexCoords = cubeSphereTexCoords(face, s + i * step, t + j * step);
+
+			// right x up points out of the surface
+			const glm::vec3 alongRight = points[(size_t)(j + 1) * ring + (i + 2)] - points[(size_t)(j + 1) * ring + i];
+			const glm::vec3 alongUp = points[(size_t)(j + 2) * ring + (i + 1)] - points[(size_t)j * ring + (i + 1)];
+			vertex.Normal = glm::normalize(glm::cross(alongRight, alongUp));
+
+			lower = glm::min(lower, vertex.Position);
+			upper = glm::max(upper, vertex.Position);
+		}
+
+	TerrainChunkGeometry chunk;
+
+	// The error: how far the true surface at each cell centre lies from the flat cell the chunk draws there
+	for (unsigned int j = 0; j < n; j++)
+		for (unsigned int i = 0; i < n; i++) {
+			const glm::vec3 drawn = 0.25f * (point(i, j) + point(i + 1, j) + point(i, j + 1) + point(i + 1, j + 1));
+			chunk.error = std::max(chunk.error, glm::length(surfacePoint(i + 0.5f, j + 0.5f) - drawn));
+		}
+
+	// The skirt hangs deeper than any crack against a neighbour: those stay within the error of the coarser of the two chunks
+	const float skirtDepth = 2.0f * chunk.error + 0.05f * radius * size * glm::half_pi<float>();
+	for (unsigned int k = 0; k < 4 * n; k++) {
+		const Vertex& border = vertices[terrainBorderVertex(k)];
+		Vertex& vertex = vertices[(size_t)side * side + k];
+		vertex = border;
+		vertex.Position = border.Position - glm::normalize(border.Position) * skirtDepth;
+	}
+
+	chunk.centre = 0.5f * (lower + upper);
+	for (unsigned int v = 0; v < TERRAIN_CHUNK_VERTICES; v++) chunk.boundingRadius = std::max(chunk.boundingRadius, glm::length(vertices[v].Position - chunk.centre));
+
+	packVertices(terrainVertexLayout(), vertices, chunk.vertices);
+	return chunk;
+}
+
+/* One square of a cube face. It splits into four children of half its size when its error looks too big on screen */
+typedef struct TerrainNode {
+	unsigned int face = 0, level = 0;
+	float s = 0.0f, t = 0.0f, size = 1.0f;         // The square of the face's equal-angle grid it covers, in [0, 1]
+
+	std::future<TerrainChunkGeometry> generating; // Valid while a worker builds the chunk
+	GLVertexArray VAO;                            // Set once the chunk is uploaded
+	GLBuffer VBO;
+	glm::vec3 centre{ 0.0f };
+	float boundingRadius = 0.0f, error = 0.0f;
+
+	unsigned long long lastUsed = 0;              // Last frame the selection reached the node
+	std::unique_ptr<TerrainNode> children[4];
+
+	bool inline isResident(void) const { return (bool)this->VAO; }
+} TerrainNode;
+
+/* The quadtree terrain of one planet */
+typedef struct PlanetTerrain {
+	Entity body{ 0, 0 };
+	float radius = 0.0f, heightScale = 0.0f;                   // Model space radius of the sphere, and the height of the tallest peak as a fraction of it
+	std::shared_future<std::shared_ptr<const HeightMap>> heightMap;
+
+	std::unique_ptr<TerrainNode> roots[6];                      // One per cube face, created once the camera first comes near
+	std::vector<TerrainNode*> drawn;                           // The chunks this frame's selection picked
+	unsigned long long lastNear = 0;                           // Last frame the camera was near enough
+} PlanetTerrain;
+
+/* Class that draws the planets the camera comes near as chunked quadtree terrain, displaced by their bump maps. Each planet
+   is a quadtree per cube face; a chunk splits while its geometric error projects to more than a few pixels, so detail follows
+   the camera and the triangle count stays bounded. Chunks are built on the worker threads and uploaded a few per frame within
+   a byte budget, and whatever the camera left behind for a while is freed. Further away, the planets' own models draw them */
+class TerrainSystem {
+private:
+	static const unsigned int MAX_LEVEL = 12;        // Deepest split, a 2K height map has no detail left well before it
+	static const unsigned int MAX_GENERATING = 16;   // Chunks being built at once, across every planet
+	static const unsigned int KEEP_FRAMES = 120;     // Frames an unused chunk stays resident, so moving back and forth does not rebuild it
+
+	World& world;
+	std::vector<std::unique_ptr<PlanetTerrain>> terrains;
+	std::vector<TerrainNode*> generating;            // Nodes whose chunk a worker is building
+	GLBuffer indices;                                // The index buffer every chunk shares
+
+	float pixelError;          // Screen-space error a chunk may show before it splits, in pixels
+	float activationRadii;     // The terrain takes over within this many radii of a planet's centre
+	size_t uploadBudget;       // Vertex bytes uploaded per frame at most
+	unsigned long long frame;
+
+	size_t drawnChunks, residentChunks, uploadedBytes;
+	double nearestSurface;
+
+	void select(PlanetTerrain& terrain, TerrainNode& node, const glm::vec3& camera, const float pixelsPerRadian); // Picks the chunks to draw under a node
+	void request(PlanetTerrain& terrain, TerrainNode& node);                                                       // Queues the chunk of a node on the workers
+	void prune(std::unique_ptr<TerrainNode>& node, const bool release);                                             // Frees the subtrees the selection left alone for KEEP_FRAMES
+	void upload(TerrainNode& node, TerrainChunkGeometry& chunk);
+
+public:
+	TerrainSystem(World& world, const float pixelError = 2.0f, const float activationRadii = 6.0f, const size_t uploadBudget = 256 * 1024);
+
+	TerrainSystem(const TerrainSystem&) = delete;
+	TerrainSystem& operator=(const TerrainSystem&) = delete;
+
+	void add(const Entity body, const std::string& heightMapPath, const float radius, const float heightScale); // Gives a planet a terrain, its height map loads on the workers
+
+	void update(const float viewportHeight, const float fieldOfView); // Selects, builds and uploads the chunks (after the CameraRelativePass, on the GL thread)
+	void draw(Shader& shader);                                        // Draws the selected chunks with the given (already bound) planet shader
+
+	size_t inline getDrawnChunks(void) const { return this->drawnChunks; }
+	size_t inline getDrawnTriangles(void) const { return this->drawnChunks * TERRAIN_CHUNK_TRIANGLES; }
+	size_t inline getResidentChunks(void) const { return this->residentChunks; }
+	size_t inline getUploadedBytes(void) const { return this->uploadedBytes; } // This frame's
+	double inline getNearestSurfaceDistance(void) const { return this->nearestSurface; } // World distance from the camera down to the highest peak of the closest planet
+};
+
+TerrainSystem::TerrainSystem(World& world, const float pixelError, const float activationRadii, const size_t uploadBudget)
+	: world(world), pixelError(pixelError), activationRadii(activationRadii), uploadBudget(uploadBudget), frame(0), drawnChunks(0), residentChunks(0), uploadedBytes(0),
+	  nearestSurface(std::numeric_limits<double>::infinity())
+{
+}
+
+void TerrainSystem::add(const Entity body, const std::string& heightMapPath, const float radius, const float heightScale)
+{
+	std::unique_ptr<PlanetTerrain> terrain(new PlanetTerrain());
+	terrain->body = body;
+	terrain->radius = radius;
+	terrain->heightScale = heightScale;
+	terrain->heightMap = ThreadPool::global().submit([heightMapPath] { return loadHeightMap(heightMapPath); }).share();
+
+	this->terrains.push_back(std::move(terrain));
+}
+
+void TerrainSystem::update(const float viewportHeight, const float fieldOfView)
+{
+	this->frame++;
+	this->drawnChunks = 0;
+	this->uploadedBytes = 0;
+	this->nearestSurface = std::numeric_limits<double>::infinity();
+
+	// A chunk's error e at distance d covers e / d radians, this many pixels each
+	const float pixelsPerRadian = viewportHeight / (2.0f * std::tan(0.5f * fieldOfView));
+
+	for (size_t p = 0; p < this->terrains.size(); p++) {
+		PlanetTerrain& terrain = *this->terrains[p];
+		terrain.drawn.clear();
+		if (!this->world.isAlive(terrain.body)) continue;
+
+		const Transform& transform = this->world.get<Transform>(terrain.body);
+		Renderable& renderable = this->world.get<Renderable>(terrain.body);
+		renderable.visible = true;
+
+		// The camera sits at the origin of camera-relative space, in model space it is wherever the inverse model matrix puts it
+		const glm::vec3 camera = glm::vec3(glm::inverse(renderable.transformation) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+		const float distance = glm::length(camera);
+		this->nearestSurface = std::min(this->nearestSurface, (distance - terrain.radius * (1.0f + terrain.heightScale)) * transform.scale);
+
+		const bool heightMapReady = terrain.heightMap.valid() && terrain.heightMap.wait_for(std::chrono::seconds(0)) == std::future_status::ready && terrain.heightMap.get();
+		if (!transform.active || !heightMapReady || distance > this->activationRadii * terrain.radius) {
+			if (terrain.roots[0] && this->frame - terrain.lastNear > KEEP_FRAMES)
+				for (unsigned int f = 0; f < 6; f++) this->prune(terrain.roots[f], true);
+			continue;
+		}
+		terrain.lastNear = this->frame;
+
+		// The six faces have to be there before the terrain can take over from the model
+		bool rootsResident = true;
+		for (unsigned int f = 0; f < 6; f++) {
+			if (!terrain.roots[f]) {
+				terrain.roots[f].reset(new TerrainNode());
+				terrain.roots[f]->face = f;
+			}
+			if (!terrain.roots[f]->isResident()) { this->request(terrain, *terrain.roots[f]); rootsResident = false; }
+		}
+		if (!rootsResident) continue;
+
+		renderable.visible = false;
+		for (unsigned int f = 0; f < 6; f++) {
+			this->select(terrain, *terrain.roots[f], camera, pixelsPerRadian);
+			this->prune(terrain.roots[f], false);
+		}
+		this->drawnChunks += terrain.drawn.size();
+	}
+
+	// Uploading the finished chunks, coarse levels first since finer ones are no use without them, at least one per frame
+	std::stable_sort(this->generating.begin(), this->generating.end(), [](const TerrainNode* a, const TerrainNode* b) { return a->level < b->level; });
+	for (size_t i = 0; i < this->generating.size();) {
+		TerrainNode& node = *this->generating[i];
+		if (node.generating.wait_for(std::chrono::seconds(0)) != std::future_status::ready) { i++; continue; }
+
+		TerrainChunkGeometry chunk = node.generating.get();
+		this->upload(node, chunk);
+		this->uploadedBytes += chunk.vertices.size();
+		this->generating.erase(this->generating.begin() + i);
+
+		if (this->uploadedBytes >= this->uploadBudget) break;
+	}
+}
+
+void TerrainSystem::select(PlanetTerrain& terrain, TerrainNode& node, const glm::vec3& camera, const float pixelsPerRadian)
+{
+	node.lastUsed = this->frame;
+
+	// Nearest point of the bounding sphere, but never closer than the camera's own size on the model's scale
+	const float distance = std::max(glm::length(camera - node.centre) - node.boundingRadius, 1e-6f * terrain.radius);
+
+	if (node.error * pixelsPerRadian > this->pixelError * distance && node.level < MAX_LEVEL) {
+		bool childrenResident = true;
+		for (unsigned int c = 0; c < 4; c++) {
+			if (!node.children[c]) {
+				TerrainNode* child = new TerrainNode();
+				child->face = node.face;
+				child->level = node.level + 1;
+				child->size = 0.5f * node.size;
+				child->s = node.s + (c & 1) * child->size;
+				child->t = node.t + (c >> 1) * child->size;
+				node.children[c].reset(child);
+			}
+
+			TerrainNode& child = *node.children[c];
+			child.lastUsed = this->frame;
+			if (!child.isResident()) { this->request(terrain, child); childrenResident = false; }
+		}
+
+		// Until all four are there, the node keeps standing in for them
+		if (childrenResident) {
+			for (unsigned int c = 0; c < 4; c++) this->select(terrain, *node.children[c], camera, pixelsPerRadian);
+			return;
+		}
+	}
+
+	terrain.drawn.push_back(&node);
+}
+
+void TerrainSystem::request(PlanetTerrain& terrain, TerrainNode& node)
+{
+	if (node.generating.valid() || this->generating.size() >= MAX_GENERATING) return;
+
+	// The job gets copies of everything it reads, so a chunk dropped meanwhile simply discards its result
+	const std::shared_ptr<const HeightMap> heightMap = terrain.heightMap.get();
+	const float radius = terrain.radius, heightScale = terrain.heightScale, s = node.s, t = node.t, size = node.size;
+	const unsigned int face = node.face;
+
+	node.generating = ThreadPool::global().submit([heightMap, radius, heightScale, face, s, t, size] { return generateTerrainChunk(*heightMap, radius, heightScale, face, s, t, size); });
+	this->generating.push_back(&node);
+}
+
+void TerrainSystem::prune(std::unique_ptr<TerrainNode>& node, const bool release)
+{
+	if (!node) return;
+
+	const bool stale = release || this->frame - node->lastUsed > KEEP_FRAMES;
+	for (unsigned int c = 0; c < 4; c++) this->prune(node->children[c], stale);
+	if (!stale) return;
+
+	if (node->generating.valid()) this->generating.erase(std::remove(this->generating.begin(), this->generating.end(), node.get()), this->generating.end());
+	if (node->isResident()) this->residentChunks--;
+	node.reset(); // The buffers go to the deletion queue
+}
+
+void TerrainSystem::upload(TerrainNode& node, TerrainChunkGeometry& chunk)
+{
+	if (!this->indices) {
+		const std::vector<unsigned short> chunkIndices = terrainChunkIndices();
+		glBindVertexArray(0);
+		this->indices = GLBuffer::generate();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indices.get());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, chunkIndices.size() * sizeof(unsigned short), chunkIndices.data(), GL_STATIC_DRAW);
+	}
+
+	node.VBO = GLBuffer::generate();
+	glBindBuffer(GL_ARRAY_BUFFER, node.VBO.get());
+	glBufferData(GL_ARRAY_BUFFER, chunk.vertices.size(), chunk.vertices.data(), GL_STATIC_DRAW);
+
+	node.VAO = GLVertexArray::generate();
+	glBindVertexArray(node.VAO.get());
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indices.get());
+	setVertexAttributes(terrainVertexLayout());
+	glBindVertexArray(0);
+
+	node.centre = chunk.centre;
+	node.boundingRadius = chunk.boundingRadius;
+	node.error = chunk.error;
+	this->residentChunks++;
+}
+
+void TerrainSystem::draw(Shader& shader)
+{
+	for (size_t p = 0; p < this->terrains.size(); p++) {
+		const PlanetTerrain& terrain = *this->terrains[p];
+		if (terrain.drawn.empty()) continue;
+
+		// The terrain wears the planet's layer of the texture arrays the caller bound
+		const Renderable& renderable = this->world.get<Renderable>(terrain.body);
+		shader.setMat4("model", renderable.transformation);
+		shader.setInt("layer", (int)renderable.textureLayer);
+		for (size_t i = 0; i < terrain.drawn.size(); i++) {
+			glBindVertexArray(terrain.drawn[i]->VAO.get());
+			glDrawElements(GL_TRIANGLES, 3 * TERRAIN_CHUNK_TRIANGLES, GL_UNSIGNED_SHORT, 0);
+		}
+	}
+
+	glBindVertexArray(0);
+}
+
+#endif /* TERRAIN_SYSTEM_HEADER */
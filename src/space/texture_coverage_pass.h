@@ -0,0 +1,57 @@
+/* Filename: texture_coverage_pass.h */
+
+#ifndef TEXTURE_COVERAGE_PASS_HEADER
+#define TEXTURE_COVERAGE_PASS_HEADER
+
+#include <texture_cache.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "world.h"
+
+/* Class that works out, once per frame, how large on screen every model gets drawn, and tells the TextureCache so that it
+   streams in the mip levels that size needs. Runs after the CameraRelativePass, whose matrices place the models */
+class TextureCoveragePass {
+private:
+	World& world;
+	std::unordered_map<Model*, float> coverage; // Largest screen size of each model this frame, its instances share the textures
+
+public:
+	TextureCoveragePass(World& world) : world(world) {}
+
+	void run(const float viewportHeight, const float fovY);
+};
+
+/* Requires the textures of every active Renderable's model at the largest size any of its bodies covers. The size is that of the
+   bounding sphere seen from its nearest surface point, so a planet filling the screen asks for the texel density up close */
+void TextureCoveragePass::run(const float viewportHeight, const float fovY)
+{
+	const float pixelsPerRadian = viewportHeight / (2.0f * std::tan(0.5f * fovY));
+
+	this->coverage.clear();
+	this->world.forEach(ComponentMaskOf<Transform, Renderable>::value, 0, [this, pixelsPerRadian](Archetype& archetype) {
+		const Transform* transforms = archetype.column<Transform>();
+		const Renderable* renderables = archetype.column<Renderable>();
+
+		for (size_t i = 0; i < archetype.size(); i++) {
+			const Renderable& renderable = renderables[i];
+			if (!renderable.model || !transforms[i].active) continue;
+
+			const float radius = renderable.model->BoundingRadius * (float)transforms[i].scale;
+			if (radius <= 0.0f) continue;
+			const float distance = glm::length(glm::vec3(renderable.transformation[3]));
+			const float size = 2.0f * radius * pixelsPerRadian / std::max(distance - radius, 1e-3f * radius);
+
+			float& largest = this->coverage[renderable.model.get()];
+			largest = std::max(largest, size);
+		}
+	});
+
+	for (std::unordered_map<Model*, float>::const_iterator it = this->coverage.begin(); it != this->coverage.end(); ++it) it->first->requireTextures(it->second);
+}
+
+#endif /* TEXTURE_COVERAGE_PASS_HEADER */
@@ -0,0 +1,230 @@
+/* Filename: time_warp.h */
+
+#ifndef TIME_WARP_HEADER
+#define TIME_WARP_HEADER
+
+#include <thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "world.h"
+
+/* Class that advances the simulation clock at a chosen multiple of real time. Every hierarchy level (planets around the sun,
+   moons around their planets) is integrated in batches with its own number of sub-steps, so that fast orbits stay accurate
+   while slow ones take big steps */
+class TimeWarp {
+private:
+	static const unsigned int CHUNK_SIZE = 512; // Bodies integrated together, small enough for their state to stay in the L1 cache
+
+	World& world; // Orbits (with a Parent) get integrated, Spins get turned
+
+	double warpFactor;          // Requested multiple of real time
+	double stepsPerSecond;      // Simulation steps per wall-clock second at 1x
+	double stepsPerDay;         // Simulation steps in a simulated day
+	double maxAnglePerSubstep;  // How far (in radians) the fastest body of a level may travel around its orbit in one sub-step
+	double substepBudget;       // Body sub-steps a single level may spend per frame
+	bool paused;
+
+	double requestedSteps, achievedSteps; // Simulation steps asked for and actually taken during the last frame
+	double simulationTime;                // Simulation steps taken since the start
+	std::vector<unsigned int> levelSubsteps;   // Sub-steps each level took during the last frame
+	std::vector<double> levelAngularVelocity;  // Fastest angular velocity of each level, measured before stepping
+	std::vector<size_t> levelBodies;           // Integrated bodies of each level
+
+	double reportSteps, reportSeconds, daysPerSecond; // Rolling measurement of the simulated days per wall-clock second
+
+	static void integrateOrbits(double* x, double* z, double* vx, double* vz, const double* gm, const size_t count, const double stepSize, const unsigned int substeps);
+
+	void measureLevels(void);
+	void advanceOrbits(Archetype& archetype, const double steps);
+	void advanceSpins(Archetype& archetype, const double steps);
+
+public:
+	static constexpr double MIN_WARP = 1.0;
+	static constexpr double MAX_WARP = 1000000.0;
+
+	TimeWarp(World& world, const double stepsPerSecond, const double stepsPerDay, const double maxAnglePerSubstep = 0.01, const double substepBudget = 4000000.0);
+
+	void advance(const double realDeltaTime);
+	double advanceSteps(const double requested); // Advances by up to the given simulation steps (ignoring pause), returns the steps actually taken
+
+	void inline setWarpFactor(const double value) { this->warpFactor = std::min(std::max(value, MIN_WARP), MAX_WARP); }
+	void inline speedUp(void) { this->setWarpFactor(this->warpFactor * 10.0); }
+	void inline slowDown(void) { this->setWarpFactor(this->warpFactor / 10.0); }
+
+	void inline setPaused(const bool value) { this->paused = value; }
+	bool inline isPaused(void) const { return this->paused; }
+
+	double inline getWarpFactor(void) const { return this->warpFactor; }
+	double inline getAchievedWarpFactor(void) const { return this->requestedSteps > 0 ? this->warpFactor * this->achievedSteps / this->requestedSteps : 0.0; }
+	double inline getDaysPerSecond(void) const { return this->daysPerSecond; }
+	double inline getSimulationTime(void) const { return this->simulationTime; }
+	unsigned int inline getLevelSubsteps(const unsigned int level) const { return level < this->levelSubsteps.size() ? this->levelSubsteps[level] : 0; }
+};
+
+constexpr double TimeWarp::MIN_WARP;
+constexpr double TimeWarp::MAX_WARP;
+
+/* Time Warp's Constructor */
+TimeWarp::TimeWarp(World& world, const double stepsPerSecond, const double stepsPerDay, const double maxAnglePerSubstep, const double substepBudget) : world(world)
+{
+	this->warpFactor = MIN_WARP;
+	this->stepsPerSecond = stepsPerSecond;
+	this->stepsPerDay = stepsPerDay;
+	this->maxAnglePerSubstep = maxAnglePerSubstep;
+	this->substepBudget = substepBudget;
+	this->paused = false;
+
+	this->requestedSteps = this->achievedSteps = this->simulationTime = 0;
+	this->reportSteps = this->reportSeconds = this->daysPerSecond = 0;
+}
+
+/* Advances the simulation by the real time that passed since the last frame, times the warp factor */
+void TimeWarp::advance(const double realDeltaTime)
+{
+	this->requestedSteps = this->achievedSteps = 0;
+	std::fill(this->levelSubsteps.begin(), this->levelSubsteps.end(), 0);
+
+	if (!this->paused) {
+		// A long stall (window dragged, breakpoint hit) must not turn into one giant leap
+		this->requestedSteps = this->warpFactor * std::min(realDeltaTime, 0.25) * this->stepsPerSecond;
+		this->achievedSteps = this->advanceSteps(this->requestedSteps);
+	}
+
+	// Refresh the measured rate twice a second
+	this->reportSteps += this->achievedSteps;
+	this->reportSeconds += realDeltaTime;
+	if (this->reportSeconds >= 0.5) {
+		this->daysPerSecond = (this->reportSteps / this->stepsPerDay) / this->reportSeconds;
+		this->reportSteps = this->reportSeconds = 0;
+	}
+}
+
+/* Advances every orbit and spin by up to the given simulation steps and returns how many were actually taken */
+double TimeWarp::advanceSteps(const double requested)
+{
+	this->measureLevels();
+
+	// The levels share one clock, so the level that runs out of sub-step budget first decides how far everyone gets
+	double steps = requested;
+	for (unsigned int level = 1; level < this->levelBodies.size(); level++) {
+		if (this->levelBodies[level] == 0) continue;
+
+		const double maxSubsteps = std::max(1.0, std::floor(this->substepBudget / this->levelBodies[level]));
+		if (this->levelAngularVelocity[level] > 0) steps = std::min(steps, maxSubsteps * this->maxAnglePerSubstep / this->levelAngularVelocity[level]);
+	}
+
+	for (unsigned int level = 0; level < this->levelSubsteps.size(); level++) {
+		const double substeps = std::ceil(steps * this->levelAngularVelocity[level] / this->maxAnglePerSubstep);
+		this->levelSubsteps[level] = (unsigned int)std::max(1.0, substeps);
+	}
+
+	this->world.forEach(ComponentMaskOf<Orbit, Parent>::value, 0, [this, steps](Archetype& archetype) { this->advanceOrbits(archetype, steps); });
+	this->world.forEach(ComponentMaskOf<Spin>::value, 0, [this, steps](Archetype& archetype) { this->advanceSpins(archetype, steps); });
+
+	this->simulationTime += steps;
+	return steps;
+}
+
+/* Counts the integrated bodies of every hierarchy level and finds the fastest angular velocity around the parent among them,
+   in radians per simulation step */
+void TimeWarp::measureLevels(void)
+{
+	std::fill(this->levelAngularVelocity.begin(), this->levelAngularVelocity.end(), 0.0);
+	std::fill(this->levelBodies.begin(), this->levelBodies.end(), 0);
+
+	this->world.forEach(ComponentMaskOf<Orbit, Parent>::value, 0, [this](Archetype& archetype) {
+		const Orbit* orbits = archetype.column<Orbit>();
+		const Parent* parents = archetype.column<Parent>();
+
+		for (size_t i = 0; i < archetype.size(); i++) {
+			if (!orbits[i].integrate) continue;
+
+			const unsigned int level = parents[i].depth;
+			if (level >= this->levelBodies.size()) {
+				this->levelBodies.resize(level + 1, 0);
+				this->levelAngularVelocity.resize(level + 1, 0.0);
+				this->levelSubsteps.resize(level + 1, 0);
+			}
+
+			const Orbit& orbit = orbits[i];
+			const double r2 = std::max(orbit.position.x * orbit.position.x + orbit.position.z * orbit.position.z, 1e-24);
+			this->levelAngularVelocity[level] = std::max(this->levelAngularVelocity[level], std::sqrt(orbit.gravitationalParameter / (r2 * std::sqrt(r2))));
+			this->levelBodies[level]++;
+		}
+	});
+}
+
+/* Integrates the orbits of an archetype chunk by chunk and in parallel: each chunk gets gathered into arrays one level at a
+   time, sub-stepped with that level's sub-step count, and written back */
+void TimeWarp::advanceOrbits(Archetype& archetype, const double steps)
+{
+	Orbit* orbits = archetype.column<Orbit>();
+	const Parent* parents = archetype.column<Parent>();
+	const std::vector<unsigned int>& levelSubsteps = this->levelSubsteps;
+
+	ThreadPool::global().parallelFor(archetype.size(), CHUNK_SIZE, [orbits, parents, steps, &levelSubsteps](size_t begin, size_t end) {
+		double x[CHUNK_SIZE], z[CHUNK_SIZE], vx[CHUNK_SIZE], vz[CHUNK_SIZE], gm[CHUNK_SIZE];
+		size_t rows[CHUNK_SIZE];
+
+		for (unsigned int level = 1; level < levelSubsteps.size(); level++) {
+			size_t count = 0;
+			for (size_t i = begin; i < end; i++) {
+				const Orbit& orbit = orbits[i];
+				if (!orbit.integrate || parents[i].depth != level) continue;
+
+				x[count] = orbit.position.x; z[count] = orbit.position.z;
+				vx[count] = orbit.velocity.x; vz[count] = orbit.velocity.z;
+				gm[count] = orbit.gravitationalParameter;
+				rows[count++] = i;
+			}
+			if (count == 0) continue;
+
+			integrateOrbits(x, z, vx, vz, gm, count, steps / levelSubsteps[level], levelSubsteps[level]);
+
+			for (size_t k = 0; k < count; k++) {
+				Orbit& orbit = orbits[rows[k]];
+				orbit.position.x = x[k]; orbit.position.z = z[k];
+				orbit.velocity.x = vx[k]; orbit.velocity.z = vz[k];
+			}
+		}
+	});
+}
+
+/* Turns every spin of an archetype. Spinning has no error to control, it takes the whole step at once */
+void TimeWarp::advanceSpins(Archetype& archetype, const double steps)
+{
+	Spin* spins = archetype.column<Spin>();
+
+	ThreadPool::global().parallelFor(archetype.size(), CHUNK_SIZE, [spins, steps](size_t begin, size_t end) {
+		// The angle is wrapped so that it keeps its precision once cast to float
+		for (size_t i = begin; i < end; i++)
+			spins[i].angle = std::fmod(spins[i].angle + spins[i].velocity * steps, 2.0 * 3.14159265358979323846);
+	});
+}
+
+/* Leapfrog (drift-kick-drift) integration of bodies pulled towards the origin of their orbit plane. The inner loop has no
+   branches and works on plain arrays so that the compiler can vectorize it across bodies */
+void TimeWarp::integrateOrbits(double* x, double* z, double* vx, double* vz, const double* gm, const size_t count, const double stepSize, const unsigned int substeps)
+{
+	const double halfStep = 0.5 * stepSize;
+
+	for (unsigned int s = 0; s < substeps; s++)
+		for (size_t i = 0; i < count; i++) {
+			const double midX = x[i] + halfStep * vx[i];
+			const double midZ = z[i] + halfStep * vz[i];
+
+			const double r2 = std::max(midX * midX + midZ * midZ, 1e-24);
+			const double pull = gm[i] / (r2 * std::sqrt(r2));
+
+			vx[i] -= stepSize * pull * midX;
+			vz[i] -= stepSize * pull * midZ;
+
+			x[i] = midX + halfStep * vx[i];
+			z[i] = midZ + halfStep * vz[i];
+		}
+}
+
+#endif /* TIME_WARP_HEADER */
@@ -0,0 +1,103 @@
+/* Filename: transform_system.h */
+
+#ifndef TRANSFORM_SYSTEM_HEADER
+#define TRANSFORM_SYSTEM_HEADER
+
+#include <thread_pool.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "world.h"
+
+/* Class that turns the simulation state (orbits around parents, spins) into the world Transforms: rotations first, then the
+   world positions, parents before children */
+class TransformSystem {
+private:
+	static const unsigned int CHUNK_SIZE = 1024;
+
+	World& world;
+
+	void updateRotations(Archetype& archetype);
+	void updatePositions(Archetype& archetype, const unsigned int depth);
+
+public:
+	TransformSystem(World& world) : world(world) {}
+
+	void update(void);
+};
+
+/* Refreshes every Transform that the simulation drives */
+void TransformSystem::update(void)
+{
+	this->world.forEach(ComponentMaskOf<Transform, Spin>::value, 0, [this](Archetype& archetype) { this->updateRotations(archetype); });
+
+	// A body's world position needs its parent's, so the hierarchy gets walked one depth at a time
+	unsigned int maxDepth = 0;
+	this->world.forEach(ComponentMaskOf<Parent>::value, 0, [&maxDepth](Archetype& archetype) {
+		const Parent* parents = archetype.column<Parent>();
+		for (size_t i = 0; i < archetype.size(); i++) maxDepth = std::max(maxDepth, parents[i].depth);
+	});
+
+	for (unsigned int depth = 1; depth <= maxDepth; depth++)
+		this->world.forEach(ComponentMaskOf<Transform, Orbit, Parent>::value, 0, [this, depth](Archetype& archetype) { this->updatePositions(archetype, depth); });
+}
+
+/* Builds the rotation of every spinning body of an archetype */
+void TransformSystem::updateRotations(Archetype& archetype)
+{
+	Transform* transforms = archetype.column<Transform>();
+	const Spin* spins = archetype.column<Spin>();
+
+	ThreadPool::global().parallelFor(archetype.size(), CHUNK_SIZE, [transforms, spins](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const Spin& spin = spins[i];
+			glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), (float)spin.angle, glm::vec3(0.0f, 1.0f, 0.0f));
+
+			if (spin.fullSpin) {
+				rotation = glm::rotate(rotation, (float)spin.angle, glm::vec3(1.0f, 0.0f, 0.0f));
+				rotation = glm::rotate(rotation, (float)spin.angle, glm::vec3(0.0f, 0.0f, 1.0f));
+			}
+
+			// Fix the object's orientation
+			rotation = glm::rotate(rotation, (float)spin.orientation.x, glm::vec3(1.0f, 0.0f, 0.0f));
+			rotation = glm::rotate(rotation, (float)spin.orientation.y, glm::vec3(0.0f, 1.0f, 0.0f));
+			rotation = glm::rotate(rotation, (float)spin.orientation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+
+			transforms[i].rotation = glm::quat_cast(rotation);
+		}
+	});
+}
+
+/* Places the bodies of an archetype that sit at the given depth: their parent's world position plus their orbit position */
+void TransformSystem::updatePositions(Archetype& archetype, const unsigned int depth)
+{
+	World& world = this->world;
+	Transform* transforms = archetype.column<Transform>();
+	const Orbit* orbits = archetype.column<Orbit>();
+	const Parent* parents = archetype.column<Parent>();
+
+	ThreadPool::global().parallelFor(archetype.size(), CHUNK_SIZE, [&world, transforms, orbits, parents, depth](size_t begin, size_t end) {
+		// Most bodies share their parent with the previous one (every asteroid orbits the sun), so its position gets looked up once
+		Entity lastParent = { 0xFFFFFFFFu, 0 };
+		Point3D parentPosition = { 0, 0, 0 };
+
+		for (size_t i = begin; i < end; i++) {
+			if (parents[i].depth != depth) continue;
+
+			if (parents[i].entity != lastParent) {
+				lastParent = parents[i].entity;
+				parentPosition = world.get<Transform>(lastParent).position;
+			}
+
+			transforms[i].position.x = parentPosition.x + orbits[i].position.x;
+			transforms[i].position.y = parentPosition.y + orbits[i].position.y;
+			transforms[i].position.z = parentPosition.z + orbits[i].position.z;
+		}
+	});
+}
+
+#endif /* TRANSFORM_SYSTEM_HEADER */
@@ -0,0 +1,238 @@
+/* Filename: world.h */
+
+#ifndef WORLD_HEADER
+#define WORLD_HEADER
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "components.h"
+
+/* One bit per component type, an entity's set of components is the OR of its bits */
+typedef uint32_t ComponentMask;
+
+template<typename Component> struct ComponentBit;
+template<> struct ComponentBit<Transform> { static const ComponentMask value = 1u << 0; };
+template<> struct ComponentBit<Orbit> { static const ComponentMask value = 1u << 1; };
+template<> struct ComponentBit<Spin> { static const ComponentMask value = 1u << 2; };
+template<> struct ComponentBit<Renderable> { static const ComponentMask value = 1u << 3; };
+template<> struct ComponentBit<StaticTag> { static const ComponentMask value = 1u << 4; };
+template<> struct ComponentBit<Parent> { static const ComponentMask value = 1u << 5; };
+template<> struct ComponentBit<Collider> { static const ComponentMask value = 1u << 6; };
+
+/* The mask of a list of component types, e.g. ComponentMaskOf<Transform, Orbit>::value */
+template<typename... Components> struct ComponentMaskOf;
+template<> struct ComponentMaskOf<> { static const ComponentMask value = 0; };
+template<typename First, typename... Rest> struct ComponentMaskOf<First, Rest...> {
+	static const ComponentMask value = ComponentBit<First>::value | ComponentMaskOf<Rest...>::value;
+};
+
+/* Every entity with exactly the same set of components. Each component lives in its own contiguous column, so a system that
+   only needs positions walks an array of positions and nothing else */
+class Archetype {
+private:
+	ComponentMask mask;
+	std::vector<Entity> entities;
+
+	std::vector<Transform> transforms;
+	std::vector<Orbit> orbits;
+	std::vector<Spin> spins;
+	std::vector<Renderable> renderables;
+	std::vector<StaticTag> staticTags;
+	std::vector<Parent> parents;
+	std::vector<Collider> colliders;
+
+	template<typename Component> std::vector<Component>& storage(void);
+	template<typename Component> void pushComponent(void);
+	template<typename Component> void removeComponent(const size_t row);
+
+	size_t push(const Entity entity); // Appends a row of default components, returns its index
+	Entity removeRow(const size_t row); // Moves the last row into the removed one, returns the entity that moved
+
+	friend class World;
+
+public:
+	Archetype(const ComponentMask mask) : mask(mask) {}
+
+	ComponentMask inline getMask(void) const { return this->mask; }
+	size_t inline size(void) const { return this->entities.size(); }
+	const Entity* getEntities(void) const { return this->entities.data(); }
+
+	template<typename Component> bool inline has(void) const { return (this->mask & ComponentBit<Component>::value) != 0; }
+	template<typename Component> Component* column(void) { return this->has<Component>() ? this->storage<Component>().data() : NULL; }
+};
+
+template<> std::vector<Transform>& Archetype::storage<Transform>(void) { return this->transforms; }
+template<> std::vector<Orbit>& Archetype::storage<Orbit>(void) { return this->orbits; }
+template<> std::vector<Spin>& Archetype::storage<Spin>(void) { return this->spins; }
+template<> std::vector<Renderable>& Archetype::storage<Renderable>(void) { return this->renderables; }
+template<> std::vector<StaticTag>& Archetype::storage<StaticTag>(void) { return this->staticTags; }
+template<> std::vector<Parent>& Archetype::storage<Parent>(void) { return this->parents; }
+template<> std::vector<Collider>& Archetype::storage<Collider>(void) { return this->colliders; }
+
+/* Adds a default component to the end of a column, if the archetype has that component */
+template<typename Component>
+void Archetype::pushComponent(void)
+{
+	if (this->has<Component>()) this->storage<Component>().push_back(Component());
+}
+
+/* Swap-removes a row of a column, if the archetype has that component */
+template<typename Component>
+void Archetype::removeComponent(const size_t row)
+{
+	if (!this->has<Component>()) return;
+
+	std::vector<Component>& components = this->storage<Component>();
+	components[row] = components.back();
+	components.pop_back();
+}
+
+/* Appends a row of default components */
+size_t Archetype::push(const Entity entity)
+{
+	this->entities.push_back(entity);
+
+	this->pushComponent<Transform>(); this->pushComponent<Orbit>(); this->pushComponent<Spin>(); this->pushComponent<Renderable>();
+	this->pushComponent<StaticTag>(); this->pushComponent<Parent>(); this->pushComponent<Collider>();
+
+	return this->entities.size() - 1;
+}
+
+/* Removes a row by moving the last row into it */
+Entity Archetype::removeRow(const size_t row)
+{
+	this->removeComponent<Transform>(row); this->removeComponent<Orbit>(row); this->removeComponent<Spin>(row); this->removeComponent<Renderable>(row);
+	this->removeComponent<StaticTag>(row); this->removeComponent<Parent>(row); this->removeComponent<Collider>(row);
+
+	this->entities[row] = this->entities.back();
+	this->entities.pop_back();
+
+	return row < this->entities.size() ? this->entities[row] : Entity{ 0, 0 };
+}
+
+/* Class that owns every entity of the simulation, grouped by archetype. Systems ask for the archetypes holding the components
+   they need and iterate their columns, so a new kind of object is a new combination of components, not a new loop */
+class World {
+private:
+	typedef struct EntityRecord {
+		uint32_t archetype, row, generation;
+		bool alive;
+	} EntityRecord;
+
+	std::vector<Archetype> archetypes;
+	std::vector<EntityRecord> records; // Indexed by Entity::index
+	std::vector<uint32_t> freeIndices;
+
+	uint32_t findArchetype(const ComponentMask mask);
+
+public:
+	Entity create(const ComponentMask mask); // Creates an entity holding default values of the given components
+	void destroy(const Entity entity);
+	bool isAlive(const Entity entity) const;
+
+	template<typename Component> bool has(const Entity entity) const;
+	template<typename Component> Component& get(const Entity entity);
+
+	// Calls function(Archetype&) for every non empty archetype holding all the required components and none of the excluded ones
+	template<typename Function> void forEach(const ComponentMask required, const ComponentMask excluded, Function function);
+	size_t count(const ComponentMask required, const ComponentMask excluded = 0) const;
+
+	size_t inline getArchetypeCount(void) const { return this->archetypes.size(); }
+};
+
+/* Returns the index of the archetype of a component set, creating it the first time */
+uint32_t World::findArchetype(const ComponentMask mask)
+{
+	for (uint32_t i = 0; i < this->archetypes.size(); i++)
+		if (this->archetypes[i].mask == mask) return i;
+
+	this->archetypes.push_back(Archetype(mask));
+	return (uint32_t)this->archetypes.size() - 1;
+}
+
+/* Creates an entity with the given components, all holding their default values */
+Entity World::create(const ComponentMask mask)
+{
+	Entity entity;
+	if (!this->freeIndices.empty()) {
+		entity.index = this->freeIndices.back();
+		this->freeIndices.pop_back();
+	}
+	else {
+		entity.index = (uint32_t)this->records.size();
+		this->records.push_back(EntityRecord{ 0, 0, 0, false });
+	}
+
+	EntityRecord& record = this->records[entity.index];
+	entity.generation = record.generation;
+
+	record.archetype = this->findArchetype(mask);
+	record.row = (uint32_t)this->archetypes[record.archetype].push(entity);
+	record.alive = true;
+
+	return entity;
+}
+
+/* Destroys an entity. Its handle (and every copy of it) stops being alive */
+void World::destroy(const Entity entity)
+{
+	if (!this->isAlive(entity)) {
+		std::cout << "ERROR::WORLD:: Destroying an entity that is not alive" << std::endl;
+		return;
+	}
+
+	EntityRecord& record = this->records[entity.index];
+	const Entity moved = this->archetypes[record.archetype].removeRow(record.row);
+	if (moved != entity && record.row < this->archetypes[record.archetype].size()) this->records[moved.index].row = record.row;
+
+	record.alive = false;
+	record.generation++;
+	this->freeIndices.push_back(entity.index);
+}
+
+/* Returns whether a handle still refers to a living entity */
+bool World::isAlive(const Entity entity) const
+{
+	return entity.index < this->records.size() && this->records[entity.index].alive && this->records[entity.index].generation == entity.generation;
+}
+
+/* Returns whether an entity holds a component */
+template<typename Component>
+bool World::has(const Entity entity) const
+{
+	return this->isAlive(entity) && this->archetypes[this->records[entity.index].archetype].template has<Component>();
+}
+
+/* Returns a component of an entity, which must hold it */
+template<typename Component>
+Component& World::get(const Entity entity)
+{
+	const EntityRecord& record = this->records[entity.index];
+	return this->archetypes[record.archetype].template storage<Component>()[record.row];
+}
+
+/* Hands every matching archetype to the function, in creation order */
+template<typename Function>
+void World::forEach(const ComponentMask required, const ComponentMask excluded, Function function)
+{
+	for (size_t i = 0; i < this->archetypes.size(); i++) {
+		Archetype& archetype = this->archetypes[i];
+		if ((archetype.mask & required) == required && (archetype.mask & excluded) == 0 && archetype.size() > 0) function(archetype);
+	}
+}
+
+/* Counts the entities holding all the required components and none of the excluded ones */
+size_t World::count(const ComponentMask required, const ComponentMask excluded) const
+{
+	size_t total = 0;
+	for (size_t i = 0; i < this->archetypes.size(); i++) {
+		const Archetype& archetype = this->archetypes[i];
+		if ((archetype.mask & required) == required && (archetype.mask & excluded) == 0) total += archetype.size();
+	}
+
+	return total;
+}
+
+#endif /* WORLD_HEADER */